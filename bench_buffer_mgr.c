@@ -0,0 +1,449 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "dberror.h"
+#include "storage_mgr.h"
+#include "buffer_mgr.h"
+
+/* Latency of pinPage/unpinPage hits as the buffer pool grows: every frame holds a page
+   and the pinned pages are picked at random, so each pin is a page table lookup.
+   Then the latency of misses under LRU and LFU, random pins over twice as many pages as
+   frames, where each miss picks a victim and reads into its frame; LRU once more with
+   the frames on huge pages.
+   Then random pins over the whole file with and without prefetchPages announcing the next
+   pages, through the kernel page cache and with O_DIRECT.
+   Then forceFlushPool of a pool whose frames all hold dirty pages, read in random order.
+   Then pin latency percentiles of a write-heavy load, half of the pins dirtying their page,
+   with and without a background writer.
+   Then pin/unpin hit throughput of 1 to maxThreads threads on one pool, each thread on
+   its own pages: a plain pool behind one global mutex versus a thread-safe pool, the
+   latter also under the strategies that keep lists of the pages (LRU, LFU, ARC, 2Q).
+   Last the hit ratio of every replacement strategy on the same page reference traces.
+
+   usage: bench_buffer [maxFrames [numPins [maxThreads]]] */
+
+#define BENCHPF "bench_bufferfile.bin"
+#define THREAD_FRAMES 10000
+#define MAX_THREADS 64
+#define TRACE_FRAMES 1000
+#define TRACE_PAGES 10000
+#define TRACE_REFS 200000
+#define PREFETCH_PINS 100000
+
+// check the return code and stop the benchmark if it is an error
+#define BENCH_CHECK(code)						\
+		do {									\
+			int rc_internal = (code);						\
+			if (rc_internal != RC_OK)						\
+			{									\
+				printf("[%s-L%i] ERROR: %s returned %i\n", __FILE__, __LINE__, #code, rc_internal); \
+				exit(1);							\
+			}									\
+		} while(0)
+
+static double
+now (void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void
+benchPinHits (int numFrames, int numPins)
+{
+	BM_BufferPool bm;
+	BM_PageHandle h;
+	int *pages = malloc(sizeof(int) * numPins);
+	int i;
+
+	BENCH_CHECK(initBufferPool(&bm, BENCHPF, numFrames, RS_LRU, NULL));
+
+	// filling every frame
+	for (i = 0; i < numFrames; i++)
+	{
+		BENCH_CHECK(pinPage(&bm, &h, i));
+		BENCH_CHECK(unpinPage(&bm, &h));
+	}
+
+	srand(42);
+	for (i = 0; i < numPins; i++)
+		pages[i] = rand() % numFrames;
+
+	double start = now();
+	for (i = 0; i < numPins; i++)
+	{
+		BENCH_CHECK(pinPage(&bm, &h, pages[i]));
+		BENCH_CHECK(unpinPage(&bm, &h));
+	}
+	double seconds = now() - start;
+
+	printf("frames=%-8d %9d pin/unpin hits %8.3f s %10.1f ns/pin\n", numFrames, numPins, seconds, seconds * 1e9 / numPins);
+
+	BENCH_CHECK(shutdownBufferPool(&bm));
+	free(pages);
+}
+
+static void
+benchMisses (int numFrames, int numPins, ReplacementStrategy strategy, const char *name, bool hugePages)
+{
+	BM_BufferPool bm;
+	BM_PageHandle h;
+	BM_PoolOptions options;
+	int i;
+
+	initPoolOptions(&options);
+	options.hugePages = hugePages;
+	BENCH_CHECK(initBufferPoolWithOptions(&bm, BENCHPF, numFrames, strategy, NULL, &options));
+	srand(42);
+	double start = now();
+	for (i = 0; i < numPins; i++)
+	{
+		BENCH_CHECK(pinPage(&bm, &h, rand() % (2 * numFrames)));
+		BENCH_CHECK(unpinPage(&bm, &h));
+	}
+	double seconds = now() - start;
+
+	printf("%-5s %-5s frames=%-8d %9d pins %8d misses %8.3f s %10.1f ns/pin\n", name, hugePages ? "huge" : "", numFrames, numPins, getNumReadIO(&bm),
+			seconds, seconds * 1e9 / numPins);
+	BENCH_CHECK(shutdownBufferPool(&bm));
+}
+
+// pins pages picked at random; with a window, each batch of window pages is prefetched one
+// batch ahead of the pins, the way an index scan that knows its next RIDs would
+static void
+benchPrefetch (int numFrames, int numPins, int window, bool directIO)
+{
+	BM_BufferPool bm;
+	BM_PageHandle h;
+	BM_PoolOptions options;
+	int *pages = malloc(sizeof(int) * numPins);
+	int i;
+
+	initPoolOptions(&options);
+	options.directIO = directIO;
+	if (initBufferPoolWithOptions(&bm, BENCHPF, numFrames, RS_LRU, NULL, &options) != RC_OK)
+	{
+		printf("prefetch %-6s not available\n", directIO ? "direct" : "");
+		free(pages);
+		return;
+	}
+	srand(42);
+	for (i = 0; i < numPins; i++)
+		pages[i] = rand() % TRACE_PAGES;
+
+	double start = now();
+	for (i = 0; i < numPins; i++)
+	{
+		if (window > 0 && i % window == 0 && i + window < numPins)
+			BENCH_CHECK(prefetchPages(&bm, pages + i + window, numPins - i - window < window ? numPins - i - window : window));
+		BENCH_CHECK(pinPage(&bm, &h, pages[i]));
+		BENCH_CHECK(unpinPage(&bm, &h));
+	}
+	double seconds = now() - start;
+
+	printf("prefetch %-6s window=%-3d frames=%-6d %8d pins %8d misses %8.3f s %10.1f ns/pin\n", directIO ? "direct" : "",
+			window, numFrames, numPins, getNumReadIO(&bm), seconds, seconds * 1e9 / numPins);
+	BENCH_CHECK(shutdownBufferPool(&bm));
+	free(pages);
+}
+
+static void
+benchFlush (int numFrames, bool directIO)
+{
+	BM_BufferPool bm;
+	BM_PageHandle h;
+	BM_PoolOptions options;
+	int *pages = malloc(sizeof(int) * numFrames);
+	int i;
+
+	initPoolOptions(&options);
+	options.directIO = directIO;
+	if (initBufferPoolWithOptions(&bm, BENCHPF, numFrames, RS_LRU, NULL, &options) != RC_OK)
+	{
+		printf("flush    %-6s not available\n", directIO ? "direct" : "");
+		free(pages);
+		return;
+	}
+
+	// a random permutation of the first numFrames pages, so frame order is not file order
+	srand(42);
+	for (i = 0; i < numFrames; i++)
+		pages[i] = i;
+	for (i = numFrames - 1; i > 0; i--)
+	{
+		int j = rand() % (i + 1), t = pages[i];
+		pages[i] = pages[j];
+		pages[j] = t;
+	}
+	for (i = 0; i < numFrames; i++)
+	{
+		BENCH_CHECK(pinPage(&bm, &h, pages[i]));
+		h.data[0]++;
+		BENCH_CHECK(markDirty(&bm, &h));
+		BENCH_CHECK(unpinPage(&bm, &h));
+	}
+
+	double start = now();
+	BENCH_CHECK(forceFlushPool(&bm));
+	double seconds = now() - start;
+
+	printf("flush    %-6s frames=%-8d %8d writes %8.3f s %10.1f ns/page\n", directIO ? "direct" : "", numFrames,
+			getNumWriteIO(&bm), seconds, seconds * 1e9 / numFrames);
+	BENCH_CHECK(shutdownBufferPool(&bm));
+	free(pages);
+}
+
+static int
+compareDoubles (const void *a, const void *b)
+{
+	double x = *(const double *) a, y = *(const double *) b;
+	return (x > y) - (x < y);
+}
+
+static void
+benchWriter (int numFrames, int numPins, bool writer, bool directIO)
+{
+	BM_BufferPool bm;
+	BM_PageHandle h;
+	BM_PoolOptions options;
+	double *latency = malloc(sizeof(double) * numPins);
+	int i;
+
+	initPoolOptions(&options);
+	options.backgroundWriter = writer;
+	options.directIO = directIO;
+	if (initBufferPoolWithOptions(&bm, BENCHPF, numFrames, RS_LRU, NULL, &options) != RC_OK)
+	{
+		printf("writer   %-6s not available\n", directIO ? "direct" : "");
+		free(latency);
+		return;
+	}
+	srand(42);
+	double start = now();
+	for (i = 0; i < numPins; i++)
+	{
+		double t = now();
+		BENCH_CHECK(pinPage(&bm, &h, rand() % (2 * numFrames)));
+		latency[i] = now() - t;
+		if (rand() % 2 == 0)
+		{
+			h.data[0]++;
+			BENCH_CHECK(markDirty(&bm, &h));
+		}
+		BENCH_CHECK(unpinPage(&bm, &h));
+	}
+	double seconds = now() - start;
+	qsort(latency, numPins, sizeof(double), compareDoubles);
+
+	printf("writer   %-6s %-3s frames=%-6d %8d pins %8.3f s p50 %8.1f us p99 %8.1f us p99.9 %8.1f us\n", directIO ? "direct" : "",
+			writer ? "on" : "off", numFrames, numPins, seconds, latency[numPins / 2] * 1e6, latency[numPins / 100 * 99] * 1e6,
+			latency[numPins / 1000 * 999] * 1e6);
+	BENCH_CHECK(shutdownBufferPool(&bm));
+	free(latency);
+}
+
+typedef struct PinThread {
+	BM_BufferPool *bm;
+	pthread_mutex_t *mutex;  // taken around every call unless NULL
+	int firstPage;
+	int numPages;
+	int numPins;
+} PinThread;
+
+static void *
+pinThread (void *arg)
+{
+	PinThread *t = (PinThread *) arg;
+	BM_PageHandle h;
+	unsigned int seed = t->firstPage + 1;
+	int i;
+
+	for (i = 0; i < t->numPins; i++)
+	{
+		int pageNum = t->firstPage + rand_r(&seed) % t->numPages;
+		if (t->mutex != NULL)
+			pthread_mutex_lock(t->mutex);
+		BENCH_CHECK(pinPage(t->bm, &h, pageNum));
+		if (t->mutex != NULL)
+		{
+			pthread_mutex_unlock(t->mutex);
+			pthread_mutex_lock(t->mutex);
+		}
+		BENCH_CHECK(unpinPage(t->bm, &h));
+		if (t->mutex != NULL)
+			pthread_mutex_unlock(t->mutex);
+	}
+	return NULL;
+}
+
+static void
+benchThreads (int numFrames, int numPins, int numThreads, bool threadSafe, ReplacementStrategy strategy,
+		const char *strategyName)
+{
+	BM_BufferPool bm;
+	BM_PageHandle h;
+	BM_PoolOptions options;
+	pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+	PinThread threads[MAX_THREADS];
+	pthread_t ids[MAX_THREADS];
+	int i;
+
+	initPoolOptions(&options);
+	options.threadSafe = threadSafe;
+	BENCH_CHECK(initBufferPoolWithOptions(&bm, BENCHPF, numFrames, strategy, NULL, &options));
+	for (i = 0; i < numFrames; i++)
+	{
+		BENCH_CHECK(pinPage(&bm, &h, i));
+		BENCH_CHECK(unpinPage(&bm, &h));
+	}
+
+	double start = now();
+	for (i = 0; i < numThreads; i++)
+	{
+		threads[i].bm = &bm;
+		threads[i].mutex = threadSafe ? NULL : &mutex;
+		threads[i].numPages = numFrames / numThreads;
+		threads[i].firstPage = i * threads[i].numPages;
+		threads[i].numPins = numPins / numThreads;
+		pthread_create(&ids[i], NULL, pinThread, &threads[i]);
+	}
+	for (i = 0; i < numThreads; i++)
+		pthread_join(ids[i], NULL);
+	double seconds = now() - start;
+
+	printf("%-8s %-6s threads=%-3d %9d pin/unpin hits %8.3f s %10.2f M pins/s\n", threadSafe ? "latched" : "mutex",
+			strategyName, numThreads, numPins, seconds, numPins / seconds / 1e6);
+	BENCH_CHECK(shutdownBufferPool(&bm));
+}
+
+// a lookup on a skewed key set: 90% of the references go to the hottest 800 pages
+static int
+skewedPage (void)
+{
+	return rand() % 10 != 0 ? rand() % 800 : rand() % TRACE_PAGES;
+}
+
+// fills trace with TRACE_REFS page numbers of the named workload
+static void
+makeTrace (const char *name, int *trace)
+{
+	int i;
+
+	srand(42);
+	for (i = 0; i < TRACE_REFS; i++)
+	{
+		if (strcmp(name, "skewed") == 0)
+			trace[i] = skewedPage();
+		else if (strcmp(name, "loop") == 0)
+			trace[i] = i % (TRACE_FRAMES + TRACE_FRAMES / 5);  // a scan 20% larger than the pool, over and over
+		else if (i % 40000 < 5000)
+			trace[i] = 1000 + (i / 40000 * 5000 + i % 40000) % (TRACE_PAGES - 1000);  // a batch scan of cold pages
+		else
+			trace[i] = skewedPage();
+	}
+}
+
+static void
+benchPolicy (const char *traceName, int *trace, ReplacementStrategy strategy, const char *strategyName)
+{
+	BM_BufferPool bm;
+	BM_PageHandle h;
+	int i;
+
+	BENCH_CHECK(initBufferPool(&bm, BENCHPF, TRACE_FRAMES, strategy, NULL));
+	double start = now();
+	for (i = 0; i < TRACE_REFS; i++)
+	{
+		BENCH_CHECK(pinPage(&bm, &h, trace[i]));
+		BENCH_CHECK(unpinPage(&bm, &h));
+	}
+	double seconds = now() - start;
+	int misses = getNumReadIO(&bm);
+
+	printf("%-8s %-6s %9d refs %8d misses %7.2f%% hits %8.3f s\n", traceName, strategyName, TRACE_REFS, misses,
+			100.0 * (TRACE_REFS - misses) / TRACE_REFS, seconds);
+	BENCH_CHECK(shutdownBufferPool(&bm));
+}
+
+static void
+benchPolicies (void)
+{
+	const char *traces[] = { "skewed", "loop", "mixed" };
+	ReplacementStrategy strategies[] = { RS_FIFO, RS_LRU, RS_CLOCK, RS_LFU, RS_LRU_K, RS_ARC, RS_2Q };
+	const char *names[] = { "FIFO", "LRU", "CLOCK", "LFU", "LRU-2", "ARC", "2Q" };
+	int *trace = malloc(sizeof(int) * TRACE_REFS);
+	int t, s;
+
+	printf("%d frame pool, %d page file\n", TRACE_FRAMES, TRACE_PAGES);
+	for (t = 0; t < 3; t++)
+	{
+		makeTrace(traces[t], trace);
+		for (s = 0; s < 7; s++)
+			benchPolicy(traces[t], trace, strategies[s], names[s]);
+	}
+	free(trace);
+}
+
+int
+main (int argc, char **argv)
+{
+	int maxFrames = argc > 1 ? atoi(argv[1]) : 1000000;
+	int numPins = argc > 2 ? atoi(argv[2]) : 1000000;
+	int maxThreads = argc > 3 ? atoi(argv[3]) : (int) sysconf(_SC_NPROCESSORS_ONLN);
+	SM_FileHandle fh;
+	int numFrames, numThreads;
+
+	if (maxThreads > MAX_THREADS)
+		maxThreads = MAX_THREADS;
+
+	initStorageManager();
+	BENCH_CHECK(createPageFile(BENCHPF));
+	BENCH_CHECK(openPageFile(BENCHPF, &fh));
+	BENCH_CHECK(ensureCapacity(2 * maxFrames > TRACE_PAGES ? 2 * maxFrames : TRACE_PAGES, &fh));
+	BENCH_CHECK(closePageFile(&fh));
+
+	for (numFrames = 10; numFrames <= maxFrames; numFrames *= 10)
+		benchPinHits(numFrames, numPins);
+	for (numFrames = 1000; numFrames <= maxFrames; numFrames *= 10)
+	{
+		benchMisses(numFrames, numPins, RS_LRU, "LRU", false);
+		benchMisses(numFrames, numPins, RS_LFU, "LFU", false);
+		benchMisses(numFrames, numPins, RS_LRU, "LRU", true);
+	}
+
+	benchPrefetch(TRACE_FRAMES, PREFETCH_PINS, 0, false);
+	benchPrefetch(TRACE_FRAMES, PREFETCH_PINS, 32, false);
+	benchPrefetch(TRACE_FRAMES, PREFETCH_PINS, 0, true);
+	benchPrefetch(TRACE_FRAMES, PREFETCH_PINS, 32, true);
+
+	for (numFrames = 1000; numFrames <= maxFrames; numFrames *= 10)
+	{
+		benchFlush(numFrames, false);
+		benchFlush(numFrames, true);
+	}
+
+	benchWriter(TRACE_FRAMES, PREFETCH_PINS, false, false);
+	benchWriter(TRACE_FRAMES, PREFETCH_PINS, true, false);
+	benchWriter(TRACE_FRAMES, PREFETCH_PINS, false, true);
+	benchWriter(TRACE_FRAMES, PREFETCH_PINS, true, true);
+
+	for (numThreads = 1; numThreads <= maxThreads; numThreads *= 2)
+	{
+		benchThreads(THREAD_FRAMES, numPins, numThreads, false, RS_CLOCK, "CLOCK");
+		benchThreads(THREAD_FRAMES, numPins, numThreads, true, RS_CLOCK, "CLOCK");
+		benchThreads(THREAD_FRAMES, numPins, numThreads, true, RS_LRU, "LRU");
+		benchThreads(THREAD_FRAMES, numPins, numThreads, true, RS_LFU, "LFU");
+		benchThreads(THREAD_FRAMES, numPins, numThreads, true, RS_ARC, "ARC");
+		benchThreads(THREAD_FRAMES, numPins, numThreads, true, RS_2Q, "2Q");
+	}
+
+	benchPolicies();
+
+	BENCH_CHECK(destroyPageFile(BENCHPF));
+	return 0;
+}
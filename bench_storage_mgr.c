@@ -0,0 +1,152 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "dberror.h"
+#include "storage_mgr.h"
+#include "storage_mgr_async.h"
+
+/* A sequential scan with readNextBlock with and without readahead, then random
+   single-page reads against the same page file: the synchronous readBlock path
+   versus the async queue at growing queue depths.
+
+   usage: bench_storage [numPages [numReads [direct]]]
+
+   With 'direct' the file is opened with O_DIRECT, so every read goes to the device. */
+
+#define BENCHPF "bench_pagefile.bin"
+#define MAX_DEPTH 64
+
+// check the return code and stop the benchmark if it is an error
+#define BENCH_CHECK(code)						\
+		do {									\
+			int rc_internal = (code);						\
+			if (rc_internal != RC_OK)						\
+			{									\
+				printf("[%s-L%i] ERROR: %s returned %i\n", __FILE__, __LINE__, #code, rc_internal); \
+				exit(1);							\
+			}									\
+		} while(0)
+
+static double
+now (void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void
+report (const char *path, int depth, int numReads, double seconds)
+{
+	printf("%-8s qd=%-3d %9d reads %8.3f s %12.0f IOPS\n", path, depth, numReads, seconds, numReads / seconds);
+}
+
+static void
+benchScan (SM_FileHandle *fh, SM_PageHandle page, int window)
+{
+	int i;
+	double start = now();
+
+	BENCH_CHECK(setReadAheadWindow(window, fh));
+	BENCH_CHECK(readFirstBlock(fh, page));
+	for (i = 1; i < fh->totalNumPages; i++)
+		BENCH_CHECK(readNextBlock(fh, page));
+
+	double seconds = now() - start;
+	printf("scan     ra=%-3d %9d pages %8.3f s %12.1f MB/s\n", window, fh->totalNumPages, seconds,
+			(double)fh->totalNumPages * PAGE_SIZE / seconds / 1e6);
+	BENCH_CHECK(setReadAheadWindow(0, fh));
+}
+
+static void
+benchSync (SM_FileHandle *fh, SM_PageHandle page, int numReads)
+{
+	int i;
+	double start = now();
+
+	srand(42);
+	for (i = 0; i < numReads; i++)
+		BENCH_CHECK(readBlock(rand() % fh->totalNumPages, fh, page));
+	report("sync", 1, numReads, now() - start);
+}
+
+static void
+benchAsync (SM_FileHandle *fh, SM_PageHandle *pages, SM_AsyncEngine engine, int depth, int numReads)
+{
+	SM_AsyncQueue queue;
+	SM_AsyncCompletion done[MAX_DEPTH];
+	int submitted = 0, completed = 0, i;
+
+	if (initAsyncQueue(&queue, depth, engine) != RC_OK)
+	{
+		printf("%-8s qd=%-3d not available\n", engine == SM_ASYNC_URING ? "io_uring" : "threads", depth);
+		return;
+	}
+
+	double start = now();
+
+	// keeping depth reads in flight; each completion frees its buffer for the next read
+	srand(42);
+	for (i = 0; i < depth && submitted < numReads; i++, submitted++)
+		BENCH_CHECK(submitReadBlock(&queue, rand() % fh->totalNumPages, fh, pages[i], pages[i]));
+
+	while (completed < numReads)
+	{
+		int n = waitCompletions(&queue, done, 1, depth);
+		for (i = 0; i < n; i++)
+		{
+			BENCH_CHECK(done[i].rc);
+			if (submitted < numReads)
+			{
+				BENCH_CHECK(submitReadBlock(&queue, rand() % fh->totalNumPages, fh, done[i].tag, done[i].tag));
+				submitted++;
+			}
+		}
+		completed += n;
+	}
+
+	report(queue.engine == SM_ASYNC_URING ? "io_uring" : "threads", depth, numReads, now() - start);
+	BENCH_CHECK(shutdownAsyncQueue(&queue));
+}
+
+int
+main (int argc, char **argv)
+{
+	int numPages = argc > 1 ? atoi(argv[1]) : 16384;
+	int numReads = argc > 2 ? atoi(argv[2]) : 200000;
+	int direct = argc > 3 && strcmp(argv[3], "direct") == 0;
+	SM_FileHandle fh;
+	SM_PageHandle pages[MAX_DEPTH];
+	int depth, i;
+
+	for (i = 0; i < MAX_DEPTH; i++)
+		pages[i] = allocPageBuffers(1);
+
+	initStorageManager();
+	BENCH_CHECK(createPageFile(BENCHPF));
+	BENCH_CHECK(openPageFile(BENCHPF, &fh));
+	BENCH_CHECK(ensureCapacity(numPages, &fh));
+	if (direct)
+	{
+		BENCH_CHECK(closePageFile(&fh));
+		BENCH_CHECK(openPageFileDirect(BENCHPF, &fh));
+	}
+
+	printf("3 scans and %d random page reads from a %d page file (%s)\n", numReads, numPages, direct ? "O_DIRECT" : "warm page cache");
+	benchScan(&fh, pages[0], 0);
+	benchScan(&fh, pages[0], SM_DEFAULT_READAHEAD_PAGES);
+	benchScan(&fh, pages[0], 64);
+	benchSync(&fh, pages[0], numReads);
+	for (depth = 1; depth <= MAX_DEPTH; depth *= 2)
+		benchAsync(&fh, pages, SM_ASYNC_URING, depth, numReads);
+	for (depth = 1; depth <= MAX_DEPTH; depth *= 2)
+		benchAsync(&fh, pages, SM_ASYNC_THREADS, depth, numReads);
+
+	BENCH_CHECK(closePageFile(&fh));
+	BENCH_CHECK(destroyPageFile(BENCHPF));
+	for (i = 0; i < MAX_DEPTH; i++)
+		freePageBuffers(pages[i]);
+	return 0;
+}
@@ -1,26 +1,797 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "buffer_mgr.h"
 #include "storage_mgr.h"
+#include "storage_mgr_async.h"
 #include <math.h>
 #include <limits.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <stddef.h>
+
+// Size of the huge pages a pool with the hugePages option rounds its frame arena up to
+#define BM_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+// Prefetch reads a pool keeps in flight at most
+#define BM_PREFETCH_DEPTH 64
+
+// Dirty frames the background writer takes at a time, and how long it sleeps between looks (ms)
+#define BM_WRITER_BATCH 64
+// Pages the background writer writes at once at most, so a miss waits for little when it needs the file
+#define BM_WRITER_RUN 8
+#define BM_WRITER_DELAY 20
 
 typedef struct PageFrame {
-    SM_PageHandle data; // Actual data of the page
+    SM_PageHandle data; // Actual data of the page; the frame's own slot of an arena
     PageNumber pageNum; // An identification integer given to each page
-    int dirtyBit;       // Indicates if the page has been modified
-    int fixCount;       // Number of clients using this page
-    int hitNum;         // Used by LRU for least recently used page
+    int fileId;         // File of the pool the page belongs to
+    int dirtyBit;       // Indicates if the page has been modified; changed with dirtyFrame/cleanFrame
+    int fixCount;       // Number of clients using this page, always changed atomically
+    int hitNum;         // CLOCK's reference bit; LRU/LFU/ARC/2Q: hit since the frame last moved in its queue
     int refNum;         // Used by LFU for least frequently used page
+    int readPending;    // A prefetch read into data is in flight; the read holds one of the fixes
+    RC readError;       // Error of a prefetch read that failed, for the clients that pinned the page meanwhile
 } PageFrame;
 
-// Global variables related to buffer pool management
-int bufferSize = 0;           // Size of the buffer pool
-int numPagesReadCount = 0;    // Count of pages read from disk
-int totalDiskWriteCount = 0;  // Count of pages written to disk
-int hit = 0;                  // General count incremented for each added page frame
-int clockPointer = 0;         // Used by CLOCK algorithm
-int lfuPointer = 0;           // Used by LFU algorithm to speed up operations
+// A page of one of the pool's files: the file number in the high half, the page number in the low one
+typedef uint64_t PageKey;
+#define NO_KEY UINT64_MAX
+
+// One slot of the page table; slots with key NO_KEY are empty
+typedef struct PageTableEntry {
+    PageKey key;        // Page held in frameIndex
+    int frameIndex;     // Index of the frame in the pool's frame array
+} PageTableEntry;
+
+// Page key -> frame index table, open addressing with linear probing
+typedef struct PageTable {
+    PageTableEntry *slots;
+    int mask;                   // Slots minus one; the table is a power of two
+    int count;                  // Slots holding a page
+} PageTable;
+
+// One latch partition of the page table. A page always hashes to the same partition, which
+// holds its entry; a thread-safe pool changes the entries and fix counts of a partition's pages
+// only while holding its latch.
+typedef struct PageTablePartition {
+    pthread_mutex_t latch;      // Only used by thread-safe pools
+    PageTable table;
+    long hits;                  // Pins that found their page here, counted under the latch
+    long quickPins;             // Those of them that waited for nothing, and went untimed
+} __attribute__((aligned(64))) PageTablePartition; // One cache line per latch
+
+// A doubly linked list of frames or ghost entries threaded through prev/next index arrays. The
+// head is the most recently used end; -1 ends the list.
+typedef struct NodeList {
+    int head;
+    int tail;
+    int size;
+} NodeList;
+
+// A frequency bucket of the LFU strategy: the resident pages pinned freq times since they were read
+typedef struct LfuBucket {
+    int freq;
+    int members;                // Frames whose page is in the bucket, pinned or not
+    NodeList frames;            // The unpinned ones, linked through queuePrev/queueNext
+    int prev;                   // Neighbouring buckets in increasing freq order; -1 ends the list
+    int next;                   // Also links the free buckets
+} LfuBucket;
+
+// The frames an access strategy recycles, kept behind BM_AccessStrategy.mgmtData
+typedef struct AccessRing {
+    BM_BufferPool *bm;          // Pool the frames belong to
+    int *frames;                // Frame each slot last read a page into, -1 for an unused slot; a resize may move the page
+    PageNumber *pages;          // Page each slot read into its frame
+    int next;                   // Slot the next miss reuses
+} AccessRing;
+
+// A page file of the pool; its number is its index in the pool's files
+typedef struct PoolFile {
+    SM_FileHandle fileHandle;   // Open while the file is attached
+    bool attached;              // A detached file's slot is reused by the next file attached
+} PoolFile;
+
+// Bookkeeping kept behind BM_BufferPool.mgmtData, shared by the pools of the files of a shared pool
+typedef struct BufferPoolMgmt {
+    PageFrame *frames;          // The pool's page frames
+    PageTablePartition *partitions; // The page table, split into latch partitions
+    int numPartitions;          // Power of two; 1 unless the pool is thread-safe
+    int partitionShift;         // Hash bits below the partition number
+    bool threadSafe;            // Latches are taken; see initPoolOptions
+    pthread_mutex_t victimLatch; // Serializes misses, victim selection and the pool's file I/O
+    int framesUsed;             // Frames that hold a page; frames fill up in index order
+    PoolFile *files;            // The pool's page files: its own one, or those attached to a shared pool
+    int numFiles;
+    bool shared;                // Created by initSharedBufferPool; files come and go with attachBufferPool
+    BM_BufferPool *owner;       // The pool initialised with the frames, which the background writer works through
+    BM_PoolOptions options;     // Options the buffer pool was initialised with
+    int pageSize;               // Page size of the pool's page file, the size of every frame
+    char **arenas;              // The data of the frames: the arena of the first frames, then one per resize that grew the pool
+    size_t *arenaLengths;       // Bytes mapped for each arena with mmap, 0 if it came from allocPageBuffersOfSize
+    int numArenas;
+    SM_PageHandle *spareData;   // Arena slots of frames a shrinking resize gave up; a growing one reuses them first
+    int numSpare;
+    int bufferSize;             // Size of the buffer pool
+    int numPagesReadCount;      // Count of pages put into frames, less one; FIFO's hand is this modulo the frames
+    int totalDiskWriteCount;    // Count of pages written to disk
+    BM_PoolStats counters;      // Activity since init, counted atomically; hits are counted in the partitions
+    BM_PoolStats statsBase;     // The counts at the last resetPoolStats, under statsLatch
+    pthread_mutex_t statsLatch;
+    int clockPointer;           // Used by CLOCK algorithm
+    int lruK;                   // K of the LRU-K algorithm, from stratData
+    int *history;               // LRU-K: the K latest reference times of each frame's page, newest first; 0 for none
+    int referenceClock;         // LRU-K: logical time of the latest reference
+    PageTable retained;         // LRU-K: evicted page -> its slot in retainedHistory
+    PageKey *retainedPages;     // LRU-K: page whose history each retained slot keeps, NO_KEY if free
+    int *retainedHistory;       // LRU-K: K reference times per retained slot
+    int retainedSlots;          // LRU-K: histories kept for evicted pages, one per frame
+    int retainedNext;           // LRU-K: slot reused next; the oldest retained history goes first
+    pthread_mutex_t listLatch;  // Guards the queues, ghost lists and LFU buckets in a thread-safe pool
+    NodeList queues[2];         // LRU: the frames in queue 0; ARC: T1 and T2; 2Q: A1in and Am
+    int *queuePrev;             // LRU/LFU/ARC/2Q: links of each frame in its queue or LFU bucket
+    int *queueNext;
+    signed char *queueOf;       // LRU/LFU/ARC/2Q: queue each frame is in (0 for an LFU bucket), -1 for none
+    LfuBucket *buckets;         // LFU: one bucket per pin count among resident pages, and a spare
+    int *bucketOf;              // LFU: bucket of each frame's page, -1 for none
+    int firstBucket;            // LFU: bucket of the lowest pin count, -1 if the pool is empty
+    int freeBucket;             // LFU: first unused bucket
+    NodeList ghosts[2];         // ARC: B1 and B2; 2Q: A1out. Page numbers of recently evicted pages
+    PageTable ghostTable;       // ARC/2Q: ghost page -> its ghost entry
+    PageKey *ghostPage;         // ARC/2Q: page of each ghost entry
+    int *ghostPrev;             // ARC/2Q: links of each ghost entry in its ghost list, or in the free chain
+    int *ghostNext;
+    signed char *ghostOf;       // ARC/2Q: ghost list each entry is in, -1 if free
+    int ghostFree;              // ARC/2Q: first free ghost entry
+    int arcTarget;              // ARC: p, the size T1 adapts towards
+    int inTarget;               // 2Q: Kin, the size A1in may keep before it gives up frames
+    int outTarget;              // 2Q: Kout, the ghosts A1out remembers
+    SM_AsyncQueue readQueue;    // Prefetch reads in flight; set up by the first prefetchPages, used under the victim latch
+    bool hasReadQueue;
+    int numDirty;               // Frames whose dirtyBit is set
+    pthread_mutex_t ioLatch;    // Serializes the use of the files between the victim latch holder and the background writer
+    pthread_t writerThread;     // The background writer, if the options ask for one
+    pthread_mutex_t writerLock; // Guards writerStop and writerWake
+    pthread_cond_t writerWake;  // Signalled when numDirty reaches the high watermark, and at shutdown
+    bool writerStop;
+    int writerPos;              // Frame the background writer looks at first next time, for strategies without an order
+} BufferPoolMgmt;
+
+
+// Returns the frame array of an initialised pool
+static PageFrame *getFrames(BM_BufferPool *const bm)
+{
+    return ((BufferPoolMgmt *)bm->mgmtData)->frames;
+}
+
+static PageKey pageKey(int fileId, PageNumber pageNum)
+{
+    return (PageKey)(uint32_t)fileId << 32 | (uint32_t)pageNum;
+}
+
+// The key of the page frame idx holds
+static PageKey frameKey(BufferPoolMgmt *mgmt, int idx)
+{
+    return pageKey(mgmt->frames[idx].fileId, mgmt->frames[idx].pageNum);
+}
+
+// The handle of file fileId of the pool; the files may move while one is attached, see latchIO
+static SM_FileHandle *fileOf(BufferPoolMgmt *mgmt, int fileId)
+{
+    return &mgmt->files[fileId].fileHandle;
+}
+
+
+// LATCHES //
+
+// Fix counts and replacement counters of a thread-safe pool change while victim selection scans
+// them; the scan reads them atomically and only claimFrame's check under the latch is decisive.
+#define FRAME_LOAD(field) __atomic_load_n(&(field), __ATOMIC_RELAXED)
+#define FRAME_STORE(field, value) __atomic_store_n(&(field), (value), __ATOMIC_RELAXED)
+
+// Adds n to one of the pool's activity counters; several threads may count at once
+#define COUNT_STAT(mgmt, field, n) __atomic_add_fetch(&(mgmt)->counters.field, (n), __ATOMIC_RELAXED)
+
+static void latchPartition(BufferPoolMgmt *mgmt, PageTablePartition *part)
+{
+    if (mgmt->threadSafe) pthread_mutex_lock(&part->latch);
+}
+
+static void unlatchPartition(BufferPoolMgmt *mgmt, PageTablePartition *part)
+{
+    if (mgmt->threadSafe) pthread_mutex_unlock(&part->latch);
+}
+
+// The victim latch is always taken before a partition latch, never the other way round
+static void latchVictim(BufferPoolMgmt *mgmt)
+{
+    if (mgmt->threadSafe) pthread_mutex_lock(&mgmt->victimLatch);
+}
+
+static void unlatchVictim(BufferPoolMgmt *mgmt)
+{
+    if (mgmt->threadSafe) pthread_mutex_unlock(&mgmt->victimLatch);
+}
+
+// The background writer writes through the pool's file handle without the victim latch, so with a
+// writer every use of the handle also takes the I/O latch
+static void latchIO(BufferPoolMgmt *mgmt)
+{
+    if (mgmt->options.backgroundWriter) pthread_mutex_lock(&mgmt->ioLatch);
+}
+
+static void unlatchIO(BufferPoolMgmt *mgmt)
+{
+    if (mgmt->options.backgroundWriter) pthread_mutex_unlock(&mgmt->ioLatch);
+}
+
+// Sets the dirty bit of frame idx and counts the frame among the dirty ones; wakes the background
+// writer when the dirty frames reach its high watermark
+static void dirtyFrame(BufferPoolMgmt *mgmt, int idx)
+{
+    if (__atomic_exchange_n(&mgmt->frames[idx].dirtyBit, 1, __ATOMIC_ACQ_REL) != 0) return;
+
+    int dirty = __atomic_add_fetch(&mgmt->numDirty, 1, __ATOMIC_RELAXED);
+    if (mgmt->options.backgroundWriter && dirty * 100 >= mgmt->options.writerHighWatermark * mgmt->bufferSize
+        && (dirty - 1) * 100 < mgmt->options.writerHighWatermark * mgmt->bufferSize) {
+        pthread_mutex_lock(&mgmt->writerLock);
+        pthread_cond_signal(&mgmt->writerWake);
+        pthread_mutex_unlock(&mgmt->writerLock);
+    }
+}
+
+// Clears the dirty bit of frame idx; returns whether it was set, so the caller writes the page
+static bool cleanFrame(BufferPoolMgmt *mgmt, int idx)
+{
+    if (__atomic_exchange_n(&mgmt->frames[idx].dirtyBit, 0, __ATOMIC_ACQ_REL) == 0) return false;
+    __atomic_sub_fetch(&mgmt->numDirty, 1, __ATOMIC_RELAXED);
+    return true;
+}
+
+
+// PAGE TABLE FUNCTIONS //
+
+// Fibonacci hashing spreads consecutive page numbers, and the files, apart
+static uint32_t pageHash(PageKey key)
+{
+    return (uint32_t)((key * 11400714819323198485ull) >> 32);
+}
+
+// The partition holding a page's entry, picked by the top bits of its hash
+static PageTablePartition *partitionOf(BufferPoolMgmt *mgmt, PageKey key)
+{
+    if (mgmt->numPartitions == 1) return mgmt->partitions;
+    return &mgmt->partitions[pageHash(key) >> mgmt->partitionShift];
+}
+
+// Home slot of a page within its table
+static int pageTableSlot(PageTable *table, PageKey key)
+{
+    uint32_t hash = pageHash(key);
+    return (int)((hash ^ (hash >> 16)) & table->mask);
+}
+
+// Returns the frame holding the page, or -1 if the page is not in the pool
+static int lookupFrame(PageTable *table, PageKey key)
+{
+    int slot = pageTableSlot(table, key);
+
+    // Probing until the page or an empty slot turns up; the table is never full
+    while (table->slots[slot].key != NO_KEY) {
+        if (table->slots[slot].key == key)
+            return table->slots[slot].frameIndex;
+        slot = (slot + 1) & table->mask;
+    }
+    return -1;
+}
+
+// Allocates an empty table of the given number of slots (a power of two)
+static PageTableEntry *newTableSlots(int numSlots)
+{
+    PageTableEntry *slots = malloc(sizeof(PageTableEntry) * numSlots);
+    if (slots != NULL)
+        for (int i = 0; i < numSlots; i++)
+            slots[i].key = NO_KEY;
+    return slots;
+}
+
+// Records that the page now lives in frameIndex
+static void insertPageTable(PageTable *table, PageKey key, int frameIndex)
+{
+    // Doubling a table that would become more than half full. A single partition is sized for
+    // every frame up front; partitions only grow when pages pile up in one of them.
+    if (2 * (table->count + 1) > table->mask + 1) {
+        PageTableEntry *old = table->slots;
+        int oldSize = table->mask + 1;
+        PageTableEntry *slots = newTableSlots(2 * oldSize);
+        if (slots != NULL) {
+            table->slots = slots;
+            table->mask = 2 * oldSize - 1;
+            table->count = 0;
+            for (int i = 0; i < oldSize; i++)
+                if (old[i].key != NO_KEY)
+                    insertPageTable(table, old[i].key, old[i].frameIndex);
+            free(old);
+        }
+    }
+
+    int slot = pageTableSlot(table, key);
+
+    while (table->slots[slot].key != NO_KEY && table->slots[slot].key != key)
+        slot = (slot + 1) & table->mask;
+    if (table->slots[slot].key == NO_KEY)
+        table->count++;
+    table->slots[slot].key = key;
+    table->slots[slot].frameIndex = frameIndex;
+}
+
+// Forgets the page. Later entries of the probe chain are shifted back into the hole, so
+// lookups never need tombstones.
+static void removePageTable(PageTable *table, PageKey key)
+{
+    int hole = pageTableSlot(table, key);
+
+    while (table->slots[hole].key != key) {
+        if (table->slots[hole].key == NO_KEY)
+            return; // Page not in the table
+        hole = (hole + 1) & table->mask;
+    }
+
+    int next = hole;
+    while (true) {
+        next = (next + 1) & table->mask;
+        if (table->slots[next].key == NO_KEY)
+            break;
+
+        // An entry may move into the hole unless its home slot lies cyclically after the hole
+        int home = pageTableSlot(table, table->slots[next].key);
+        bool homeAfterHole = (next > hole) ? (home > hole && home <= next) : (home > hole || home <= next);
+        if (!homeAfterHole) {
+            table->slots[hole] = table->slots[next];
+            hole = next;
+        }
+    }
+    table->slots[hole].key = NO_KEY;
+    table->count--;
+}
+
+// Frees the page table partitions and their latches
+static void freePageTable(BufferPoolMgmt *mgmt)
+{
+    for (int i = 0; i < mgmt->numPartitions; i++) {
+        free(mgmt->partitions[i].table.slots);
+        pthread_mutex_destroy(&mgmt->partitions[i].latch);
+    }
+    free(mgmt->partitions);
+}
+
+// LRU-K HISTORY //
+
+// Reference times of the page in frame idx, newest first
+static int *frameHistory(BufferPoolMgmt *mgmt, int idx)
+{
+    return &mgmt->history[idx * mgmt->lruK];
+}
+
+// Records a reference to the page in frame idx at the next logical time
+static void recordReference(BufferPoolMgmt *mgmt, int idx)
+{
+    int *hist = frameHistory(mgmt, idx);
+    int now = __atomic_add_fetch(&mgmt->referenceClock, 1, __ATOMIC_RELAXED);
+
+    for (int k = mgmt->lruK - 1; k > 0; k--)
+        FRAME_STORE(hist[k], FRAME_LOAD(hist[k - 1]));
+    FRAME_STORE(hist[0], now);
+}
+
+// Keeps the history of the page leaving claimed frame idx, so a page that is read again soon
+// after its eviction does not start over as a page seen once
+static void retainHistory(BufferPoolMgmt *mgmt, int idx)
+{
+    if (mgmt->frames[idx].pageNum == NO_PAGE) return;
+    PageKey key = frameKey(mgmt, idx);
+
+    // Dropping the oldest retained history to make room
+    int slot = mgmt->retainedNext;
+    mgmt->retainedNext = (slot + 1) % mgmt->retainedSlots;
+    if (mgmt->retainedPages[slot] != NO_KEY)
+        removePageTable(&mgmt->retained, mgmt->retainedPages[slot]);
+
+    mgmt->retainedPages[slot] = key;
+    memcpy(&mgmt->retainedHistory[slot * mgmt->lruK], frameHistory(mgmt, idx), sizeof(int) * mgmt->lruK);
+    insertPageTable(&mgmt->retained, key, slot);
+}
+
+// Starts the history of the page with key, about to be put into claimed frame idx, from its
+// retained history if it has one, and records the reference that reads it
+static void restoreHistory(BufferPoolMgmt *mgmt, int idx, PageKey key)
+{
+    int *hist = frameHistory(mgmt, idx);
+    int slot = lookupFrame(&mgmt->retained, key);
+
+    if (slot >= 0) {
+        memcpy(hist, &mgmt->retainedHistory[slot * mgmt->lruK], sizeof(int) * mgmt->lruK);
+        removePageTable(&mgmt->retained, key);
+        mgmt->retainedPages[slot] = NO_KEY;
+    } else {
+        memset(hist, 0, sizeof(int) * mgmt->lruK);
+    }
+    recordReference(mgmt, idx);
+}
+
+// Allocates the LRU-K history; K comes from stratData (an int *), BM_DEFAULT_LRU_K if NULL
+static RC initLruK(BufferPoolMgmt *mgmt, int numPages, void *stratData)
+{
+    mgmt->lruK = stratData != NULL ? *(int *)stratData : BM_DEFAULT_LRU_K;
+    if (mgmt->lruK < 1) return RC_ERROR;
+
+    int tableSize = 2;
+    while (tableSize < 2 * numPages) tableSize *= 2;
+    mgmt->history = calloc((size_t)numPages * mgmt->lruK, sizeof(int));
+    mgmt->retained.slots = newTableSlots(tableSize);
+    mgmt->retained.mask = tableSize - 1;
+    mgmt->retainedPages = malloc(sizeof(PageKey) * numPages);
+    mgmt->retainedHistory = malloc(sizeof(int) * (size_t)numPages * mgmt->lruK);
+    mgmt->retainedSlots = numPages;
+    if (mgmt->history == NULL || mgmt->retained.slots == NULL || mgmt->retainedPages == NULL || mgmt->retainedHistory == NULL)
+        return RC_ERROR;
+    for (int i = 0; i < numPages; i++)
+        mgmt->retainedPages[i] = NO_KEY;
+    return RC_OK;
+}
+
+static void freeLruK(BufferPoolMgmt *mgmt)
+{
+    free(mgmt->history);
+    free(mgmt->retained.slots);
+    free(mgmt->retainedPages);
+    free(mgmt->retainedHistory);
+}
+
+
+// ARC AND 2Q QUEUES //
+
+static void listPushHead(NodeList *list, int *prev, int *next, int idx)
+{
+    prev[idx] = -1;
+    next[idx] = list->head;
+    if (list->head != -1) prev[list->head] = idx;
+    else list->tail = idx;
+    list->head = idx;
+    list->size++;
+}
+
+static void listRemove(NodeList *list, int *prev, int *next, int idx)
+{
+    if (prev[idx] != -1) next[prev[idx]] = next[idx];
+    else list->head = next[idx];
+    if (next[idx] != -1) prev[next[idx]] = prev[idx];
+    else list->tail = prev[idx];
+    list->size--;
+}
+
+static void latchList(BufferPoolMgmt *mgmt)
+{
+    if (mgmt->threadSafe) pthread_mutex_lock(&mgmt->listLatch);
+}
+
+static void unlatchList(BufferPoolMgmt *mgmt)
+{
+    if (mgmt->threadSafe) pthread_mutex_unlock(&mgmt->listLatch);
+}
+
+// Puts frame idx at the most recently used end of queue q
+static void queueFrame(BufferPoolMgmt *mgmt, int q, int idx)
+{
+    listPushHead(&mgmt->queues[q], mgmt->queuePrev, mgmt->queueNext, idx);
+    mgmt->queueOf[idx] = q;
+}
+
+static void dequeueFrame(BufferPoolMgmt *mgmt, int idx)
+{
+    if (mgmt->queueOf[idx] < 0) return;
+    listRemove(&mgmt->queues[mgmt->queueOf[idx]], mgmt->queuePrev, mgmt->queueNext, idx);
+    mgmt->queueOf[idx] = -1;
+}
+
+// Forgets ghost entry e
+static void dropGhost(BufferPoolMgmt *mgmt, int e)
+{
+    listRemove(&mgmt->ghosts[mgmt->ghostOf[e]], mgmt->ghostPrev, mgmt->ghostNext, e);
+    removePageTable(&mgmt->ghostTable, mgmt->ghostPage[e]);
+    mgmt->ghostOf[e] = -1;
+    mgmt->ghostNext[e] = mgmt->ghostFree;
+    mgmt->ghostFree = e;
+}
+
+static void dropOldestGhost(BufferPoolMgmt *mgmt, int g)
+{
+    if (mgmt->ghosts[g].tail != -1)
+        dropGhost(mgmt, mgmt->ghosts[g].tail);
+}
+
+// Remembers an evicted page at the most recently used end of ghost list g
+static void addGhost(BufferPoolMgmt *mgmt, int g, PageKey key)
+{
+    // Making room by forgetting the oldest ghost of the list when every entry is taken
+    if (mgmt->ghostFree == -1)
+        dropOldestGhost(mgmt, mgmt->ghosts[g].size > 0 ? g : 1 - g);
+
+    int e = mgmt->ghostFree;
+    mgmt->ghostFree = mgmt->ghostNext[e];
+    mgmt->ghostPage[e] = key;
+    mgmt->ghostOf[e] = g;
+    listPushHead(&mgmt->ghosts[g], mgmt->ghostPrev, mgmt->ghostNext, e);
+    insertPageTable(&mgmt->ghostTable, key, e);
+}
+
+// The strategies that keep their frames in queues: LRU, LFU (in its buckets), ARC and 2Q
+static bool usesQueues(ReplacementStrategy strategy)
+{
+    return strategy == RS_LRU || strategy == RS_LFU || strategy == RS_ARC || strategy == RS_2Q;
+}
+
+// Allocates the frame queues of a pool whose strategy usesQueues, the buckets of an LFU pool and
+// the ghost lists of an ARC or 2Q pool; ghost entries are twice the frames
+static RC initQueues(BufferPoolMgmt *mgmt, ReplacementStrategy strategy, int numPages)
+{
+    mgmt->queuePrev = malloc(sizeof(int) * numPages);
+    mgmt->queueNext = malloc(sizeof(int) * numPages);
+    mgmt->queueOf = malloc(numPages);
+    if (mgmt->queuePrev == NULL || mgmt->queueNext == NULL || mgmt->queueOf == NULL)
+        return RC_ERROR;
+    for (int q = 0; q < 2; q++) {
+        mgmt->queues[q].head = mgmt->queues[q].tail = -1;
+        mgmt->ghosts[q].head = mgmt->ghosts[q].tail = -1;
+    }
+    for (int i = 0; i < numPages; i++)
+        mgmt->queueOf[i] = -1;
+
+    if (strategy == RS_LFU) {
+        // A frame joins a new bucket before it leaves its old one, so one bucket more than frames
+        mgmt->buckets = malloc(sizeof(LfuBucket) * (numPages + 1));
+        mgmt->bucketOf = malloc(sizeof(int) * numPages);
+        if (mgmt->buckets == NULL || mgmt->bucketOf == NULL)
+            return RC_ERROR;
+        for (int b = 0; b <= numPages; b++)
+            mgmt->buckets[b].next = b < numPages ? b + 1 : -1;
+        for (int i = 0; i < numPages; i++)
+            mgmt->bucketOf[i] = -1;
+        mgmt->firstBucket = -1;
+        mgmt->freeBucket = 0;
+    }
+    if (strategy != RS_ARC && strategy != RS_2Q)
+        return RC_OK;
+
+    int numGhosts = 2 * numPages;
+    int tableSize = 2;
+    while (tableSize < 2 * numGhosts) tableSize *= 2;
+
+    mgmt->ghostTable.slots = newTableSlots(tableSize);
+    mgmt->ghostTable.mask = tableSize - 1;
+    mgmt->ghostPage = malloc(sizeof(PageKey) * numGhosts);
+    mgmt->ghostPrev = malloc(sizeof(int) * numGhosts);
+    mgmt->ghostNext = malloc(sizeof(int) * numGhosts);
+    mgmt->ghostOf = malloc(numGhosts);
+    if (mgmt->ghostTable.slots == NULL || mgmt->ghostPage == NULL || mgmt->ghostPrev == NULL ||
+        mgmt->ghostNext == NULL || mgmt->ghostOf == NULL)
+        return RC_ERROR;
+
+    for (int e = 0; e < numGhosts; e++) {
+        mgmt->ghostOf[e] = -1;
+        mgmt->ghostNext[e] = e + 1 < numGhosts ? e + 1 : -1;
+    }
+    mgmt->ghostFree = 0;
+
+    // 2Q's tuning from its paper: A1in a quarter of the frames, A1out ghosts for half of them
+    mgmt->inTarget = numPages / 4 > 0 ? numPages / 4 : 1;
+    mgmt->outTarget = numPages / 2 > 0 ? numPages / 2 : 1;
+    return RC_OK;
+}
+
+static void freeQueues(BufferPoolMgmt *mgmt)
+{
+    free(mgmt->queuePrev);
+    free(mgmt->queueNext);
+    free(mgmt->queueOf);
+    free(mgmt->buckets);
+    free(mgmt->bucketOf);
+    free(mgmt->ghostTable.slots);
+    free(mgmt->ghostPage);
+    free(mgmt->ghostPrev);
+    free(mgmt->ghostNext);
+    free(mgmt->ghostOf);
+}
+
+// LRU LIST AND LFU BUCKETS //
+
+// Takes an unused bucket for pin count freq and links it after bucket prev, or first if prev is -1
+static int newBucket(BufferPoolMgmt *mgmt, int freq, int prev)
+{
+    int b = mgmt->freeBucket;
+    LfuBucket *bucket = &mgmt->buckets[b];
+    mgmt->freeBucket = bucket->next;
+
+    bucket->freq = freq;
+    bucket->members = 0;
+    bucket->frames.head = bucket->frames.tail = -1;
+    bucket->frames.size = 0;
+    bucket->prev = prev;
+    bucket->next = prev != -1 ? mgmt->buckets[prev].next : mgmt->firstBucket;
+    if (bucket->next != -1) mgmt->buckets[bucket->next].prev = b;
+    if (prev != -1) mgmt->buckets[prev].next = b;
+    else mgmt->firstBucket = b;
+    return b;
+}
+
+// Takes frame idx out of its bucket, giving the bucket back once no frame is left in it
+static void leaveBucket(BufferPoolMgmt *mgmt, int idx)
+{
+    int b = mgmt->bucketOf[idx];
+    LfuBucket *bucket = &mgmt->buckets[b];
+
+    if (mgmt->queueOf[idx] >= 0)
+        listRemove(&bucket->frames, mgmt->queuePrev, mgmt->queueNext, idx);
+    mgmt->queueOf[idx] = -1;
+    mgmt->bucketOf[idx] = -1;
+    if (--bucket->members > 0) return;
+
+    if (bucket->prev != -1) mgmt->buckets[bucket->prev].next = bucket->next;
+    else mgmt->firstBucket = bucket->next;
+    if (bucket->next != -1) mgmt->buckets[bucket->next].prev = bucket->prev;
+    bucket->next = mgmt->freeBucket;
+    mgmt->freeBucket = b;
+}
+
+// Moves frame idx, out of any bucket's frame list, to the bucket of pin count freq. Pin counts only
+// grow while a page stays resident, so the search starts from the frame's own bucket and is one
+// step for a single pin.
+static void moveToBucket(BufferPoolMgmt *mgmt, int idx, int freq)
+{
+    int from = mgmt->bucketOf[idx];
+    int prev = -1, b = from != -1 && mgmt->buckets[from].freq <= freq ? from : mgmt->firstBucket;
+    while (b != -1 && mgmt->buckets[b].freq <= freq) {
+        prev = b;
+        b = mgmt->buckets[b].next;
+    }
+
+    // Joining the new bucket first keeps prev alive while the frame leaves the old one
+    int to = prev != -1 && mgmt->buckets[prev].freq == freq ? prev : newBucket(mgmt, freq, prev);
+    if (to == from) return;
+    if (from != -1)
+        leaveBucket(mgmt, idx);
+    mgmt->bucketOf[idx] = to;
+    mgmt->buckets[to].members++;
+}
+
+// Puts frame idx, out of its LFU bucket's frame list, at the head of that list
+static void listInBucket(BufferPoolMgmt *mgmt, int idx)
+{
+    listPushHead(&mgmt->buckets[mgmt->bucketOf[idx]].frames, mgmt->queuePrev, mgmt->queueNext, idx);
+    mgmt->queueOf[idx] = 0;
+}
+
+// Moves frame idx the way the hits on its page since it last moved ask for, and clears the mark
+// they left (hitNum): to the most recently used end of the LRU list, to the bucket of its pin count
+// under LFU, or to the head of T2 (ARC) or of Am (2Q, where a hit in the A1in FIFO changes nothing).
+// Called with the list latch held.
+static void requeueFrame(BM_BufferPool *const bm, int idx)
+{
+    BufferPoolMgmt *mgmt = (BufferPoolMgmt *)bm->mgmtData;
+    int q = mgmt->queueOf[idx];
+
+    FRAME_STORE(mgmt->frames[idx].hitNum, 0);
+    if (bm->strategy == RS_LFU) {
+        if (q >= 0) {
+            listRemove(&mgmt->buckets[mgmt->bucketOf[idx]].frames, mgmt->queuePrev, mgmt->queueNext, idx);
+            mgmt->queueOf[idx] = -1;
+        }
+        int freq = FRAME_LOAD(mgmt->frames[idx].refNum);
+        if (mgmt->buckets[mgmt->bucketOf[idx]].freq != freq)
+            moveToBucket(mgmt, idx, freq);
+        listInBucket(mgmt, idx);
+    } else if (q >= 0 && (bm->strategy != RS_2Q || q == 1)) {
+        dequeueFrame(mgmt, idx);
+        queueFrame(mgmt, bm->strategy == RS_LRU ? 0 : 1, idx);
+    }
+}
+
+// Moves frame idx after an unpin, if its page has been hit since the frame last moved and no client
+// has it pinned any more. Called without a partition latch held. A pin never waits for the list
+// latch: if another thread holds it the frame keeps its mark, and the victim search that passes
+// the frame moves it first (see oldestUnpinned and LFU).
+static void syncFrame(BM_BufferPool *const bm, int idx)
+{
+    BufferPoolMgmt *mgmt = (BufferPoolMgmt *)bm->mgmtData;
+    PageFrame *pageFrame = mgmt->frames;
+    if (!usesQueues(bm->strategy) || FRAME_LOAD(pageFrame[idx].hitNum) == 0
+        || FRAME_LOAD(pageFrame[idx].fixCount) != 0)
+        return;
+
+    if (mgmt->threadSafe && pthread_mutex_trylock(&mgmt->listLatch) != 0)
+        return; // Left to the victim search
+    if (FRAME_LOAD(pageFrame[idx].fixCount) == 0)
+        requeueFrame(bm, idx);
+    unlatchList(mgmt);
+}
+
+// Queues the page with key, read into free frame idx, the way a miss does: at the most recently used
+// end of the LRU list; under LFU in the bucket of pages never pinned again; a page ARC or 2Q still
+// remembers as a ghost goes to T2/Am, any other page to T1/A1in. Frames stay queued while pinned.
+static void admitFrame(BM_BufferPool *const bm, int idx, PageKey key)
+{
+    BufferPoolMgmt *mgmt = (BufferPoolMgmt *)bm->mgmtData;
+    if (bm->strategy == RS_LRU) {
+        latchList(mgmt);
+        queueFrame(mgmt, 0, idx);
+        unlatchList(mgmt);
+    }
+    if (bm->strategy == RS_LFU) {
+        latchList(mgmt);
+        moveToBucket(mgmt, idx, 0);
+        listInBucket(mgmt, idx);
+        unlatchList(mgmt);
+    }
+    if (bm->strategy != RS_ARC && bm->strategy != RS_2Q) return;
+
+    latchList(mgmt);
+    int e = lookupFrame(&mgmt->ghostTable, key);
+    if (e >= 0)
+        dropGhost(mgmt, e);
+    queueFrame(mgmt, e >= 0 ? 1 : 0, idx);
+    unlatchList(mgmt);
+}
+
+// The least recently used frame of queue q whose page is not pinned, -1 if there is none. Frames
+// passed on the way that are marked as hit are moved first, see syncFrame. Called with the list
+// latch held.
+static int oldestUnpinned(BM_BufferPool *const bm, int q)
+{
+    BufferPoolMgmt *mgmt = (BufferPoolMgmt *)bm->mgmtData;
+    int idx = mgmt->queues[q].tail;
+
+    while (idx != -1) {
+        int prev = mgmt->queuePrev[idx];
+        if (FRAME_LOAD(mgmt->frames[idx].fixCount) != 0) {
+            idx = prev;
+            continue;
+        }
+        if (FRAME_LOAD(mgmt->frames[idx].hitNum) == 0)
+            return idx;
+
+        // A frame that stays where it is, or comes round to the head of q, is looked at again
+        int at = mgmt->queues[q].head;
+        requeueFrame(bm, idx);
+        if (mgmt->queueOf[idx] == q && (prev == -1 || mgmt->queues[q].head == at))
+            continue;
+        idx = prev;
+    }
+    return -1;
+}
+
+// Takes frame idx away from its page if no client has the page pinned. The page leaves the page
+// table, so no later pin can find it; a thread-safe pool checks the fix count under the page's
+// partition latch, the same latch a hit increments it under. The claimed frame counts as pinned by
+// the thread loading the new page, so late syncFrame calls for the old page leave it alone.
+static bool claimFrame(BufferPoolMgmt *mgmt, int idx)
+{
+    PageFrame *pageFrame = mgmt->frames;
+    if (pageFrame[idx].pageNum == NO_PAGE) // Clients that pinned a page whose read failed may still hold it
+        return __atomic_load_n(&pageFrame[idx].fixCount, __ATOMIC_ACQUIRE) == 0;
+
+    PageTablePartition *part = partitionOf(mgmt, frameKey(mgmt, idx));
+    latchPartition(mgmt, part);
+    bool unpinned = __atomic_load_n(&pageFrame[idx].fixCount, __ATOMIC_ACQUIRE) == 0;
+    if (unpinned) {
+        removePageTable(&part->table, frameKey(mgmt, idx));
+        FRAME_STORE(pageFrame[idx].fixCount, 1);
+    }
+    unlatchPartition(mgmt, part);
+    return unpinned;
+}
 
 
 // Replacement Strategy Functions //
@@ -28,153 +799,1249 @@ int lfuPointer = 0;           // Used by LFU algorithm to speed up operations
 // Writes a page frame's data to disk and updates write count
 bool writeBlockToDisk(BM_BufferPool *const bm, PageFrame *pageFrame, int pageFrameIndex)
 {
-    SM_FileHandle fh;
-    RC openStatus, writeStatus;
-     
-    // Attempt to open the page file associated with the buffer pool 
-    openStatus = openPageFile(bm->pageFile, &fh);
-    if (openStatus != RC_OK) return false; // Check if the file opened correctly
+    BufferPoolMgmt *mgmt = (BufferPoolMgmt *)bm->mgmtData;
+    RC writeStatus;
 
-    writeStatus = writeBlock(pageFrame[pageFrameIndex].pageNum, &fh, pageFrame[pageFrameIndex].data);
+    // Attempt to write the page frame's data to the pool's page file on disk
+    latchIO(mgmt);
+    writeStatus = writeBlock(pageFrame[pageFrameIndex].pageNum, fileOf(mgmt, pageFrame[pageFrameIndex].fileId), pageFrame[pageFrameIndex].data);
+    unlatchIO(mgmt);
     if (writeStatus != RC_OK) return false; // Check if the block was written correctly
 
-    // Attempt to write the page frame's data to the page file on disk
-    totalDiskWriteCount++; // Increment the count of disk writes
+    __atomic_add_fetch(&mgmt->totalDiskWriteCount, 1, __ATOMIC_RELAXED); // Increment the count of disk writes
     return true; // Confirm successful execution of the function
 }
 
 
-bool setNewPageToPageFrame(PageFrame *pageFrame, PageFrame *page, int pageFrameIndex)
+// Reads page pageNum of file fileId into data; a page past the end of the file is added to it,
+// zeroed, the way a client appending to a table expects
+static RC readPage(BufferPoolMgmt *mgmt, int fileId, PageNumber pageNum, SM_PageHandle data)
+{
+    RC status = RC_OK;
+
+    latchIO(mgmt);
+    SM_FileHandle *fileHandle = fileOf(mgmt, fileId);
+    if (pageNum >= fileHandle->totalNumPages)
+        status = ensureCapacity(pageNum + 1, fileHandle);
+    if (status == RC_OK)
+        status = readBlock(pageNum, fileHandle, data);
+    unlatchIO(mgmt);
+    if (status == RC_OK)
+        COUNT_STAT(mgmt, pagesRead, 1);
+    return status;
+}
+
+// Reaps finished prefetch reads, waiting for at least minReads of them. Each frame gives up the fix
+// its read held and, unless a client pinned it meanwhile, becomes a candidate victim. A frame whose
+// read failed leaves the page table empty, keeping the error for the clients that pinned the page
+// (see awaitRead). Called with the victim latch held.
+static void completeReads(BM_BufferPool *const bm, int minReads)
+{
+    BufferPoolMgmt *mgmt = (BufferPoolMgmt *)bm->mgmtData;
+    SM_AsyncCompletion done[BM_PREFETCH_DEPTH];
+
+    if (!mgmt->hasReadQueue || mgmt->readQueue.inFlight == 0) return;
+    int n = minReads > 0 ? waitCompletions(&mgmt->readQueue, done, minReads, BM_PREFETCH_DEPTH)
+                         : pollCompletions(&mgmt->readQueue, done, BM_PREFETCH_DEPTH);
+    for (int k = 0; k < n; k++) {
+        PageFrame *frame = (PageFrame *)done[k].tag;
+        int idx = (int)(frame - mgmt->frames);
+
+        if (done[k].rc != RC_OK) {
+            PageTablePartition *part = partitionOf(mgmt, frameKey(mgmt, idx));
+            latchPartition(mgmt, part);
+            removePageTable(&part->table, frameKey(mgmt, idx));
+            frame->pageNum = NO_PAGE;
+            unlatchPartition(mgmt, part);
+            frame->readError = done[k].rc;
+            FRAME_STORE(frame->hitNum, 0);
+            FRAME_STORE(frame->refNum, 0);
+            COUNT_STAT(mgmt, pagesRead, -1); // Counted when the read was started
+        }
+        __atomic_store_n(&frame->readPending, 0, __ATOMIC_RELEASE);
+        __atomic_sub_fetch(&frame->fixCount, 1, __ATOMIC_RELEASE);
+        syncFrame(bm, idx);
+    }
+}
+
+// Reads the new page of frame idx. A prefetch (page->readPending set) only submits the read to the
+// pool's queue; if the queue cannot take it the page is read at once and page->readPending cleared.
+// Returns the error of a read that could not be done or started.
+static RC startRead(BM_BufferPool *const bm, PageFrame *page, int idx)
+{
+    BufferPoolMgmt *mgmt = (BufferPoolMgmt *)bm->mgmtData;
+    SM_PageHandle data = mgmt->frames[idx].data;
+
+    if (page->readPending) {
+        // Asynchronous reads only reach existing pages, so the file grows first
+        if (mgmt->readQueue.inFlight == mgmt->readQueue.depth)
+            completeReads(bm, 1);
+        latchIO(mgmt);
+        SM_FileHandle *fileHandle = fileOf(mgmt, page->fileId);
+        RC status = RC_OK;
+        if (page->pageNum >= fileHandle->totalNumPages)
+            status = ensureCapacity(page->pageNum + 1, fileHandle);
+        RC submitted = status == RC_OK ? submitReadBlock(&mgmt->readQueue, page->pageNum, fileHandle, data, &mgmt->frames[idx])
+                                       : status;
+        unlatchIO(mgmt);
+        page->readPending = submitted == RC_OK;
+        if (submitted == RC_OK) {
+            COUNT_STAT(mgmt, pagesRead, 1);
+            return RC_OK;
+        }
+        if (status != RC_OK)
+            return status;
+    }
+    return readPage(mgmt, page->fileId, page->pageNum, data);
+}
+
+// Waits until the prefetch read of frame idx, which the caller has pinned, is complete. If the read
+// failed the caller's pin is dropped and the read's error returned.
+static RC awaitRead(BM_BufferPool *const bm, int idx)
+{
+    BufferPoolMgmt *mgmt = (BufferPoolMgmt *)bm->mgmtData;
+    PageFrame *frame = &mgmt->frames[idx];
+
+    if (__atomic_load_n(&frame->readPending, __ATOMIC_ACQUIRE) != 0) {
+        latchVictim(mgmt);
+        while (__atomic_load_n(&frame->readPending, __ATOMIC_ACQUIRE) != 0)
+            completeReads(bm, 1);
+        unlatchVictim(mgmt);
+    }
+    RC status = frame->readError;
+    if (status != RC_OK) {
+        FRAME_STORE(frame->hitNum, 0);
+        __atomic_sub_fetch(&frame->fixCount, 1, __ATOMIC_RELEASE); // The frame is free once every such pin is gone
+    }
+    return status;
+}
+
+// Waits for the prefetch reads in flight and releases the pool's read queue
+static void freeReadQueue(BM_BufferPool *const bm)
+{
+    BufferPoolMgmt *mgmt = (BufferPoolMgmt *)bm->mgmtData;
+
+    if (!mgmt->hasReadQueue) return;
+    latchVictim(mgmt);
+    while (mgmt->readQueue.inFlight > 0)
+        completeReads(bm, 1);
+    unlatchVictim(mgmt);
+    shutdownAsyncQueue(&mgmt->readQueue);
+    mgmt->hasReadQueue = false;
+}
+
+// Puts the new page into a frame taken with claimFrame and publishes it in the page table
+bool setNewPageToPageFrame(BM_BufferPool *const bm, PageFrame *page, int pageFrameIndex)
 {
-    // Verify that the pageFrame and page pointers are valid
-    if (pageFrame == NULL || page == NULL) return false; // Ensure the pointers are not null
+    // Verify that the pool and page pointers are valid
+    if (bm == NULL || bm->mgmtData == NULL || page == NULL) return false; // Ensure the pointers are not null
+
+    BufferPoolMgmt *mgmt = (BufferPoolMgmt *)bm->mgmtData;
+    PageFrame *pageFrame = mgmt->frames;
 
     // Copy the page content and its attributes to the target page frame
-    pageFrame[pageFrameIndex].dirtyBit = page->dirtyBit;
+    __atomic_store_n(&pageFrame[pageFrameIndex].dirtyBit, page->dirtyBit, __ATOMIC_RELAXED);
     pageFrame[pageFrameIndex].pageNum = page->pageNum;
-    pageFrame[pageFrameIndex].data = page->data;
-    pageFrame[pageFrameIndex].hitNum = page->hitNum;
-    pageFrame[pageFrameIndex].fixCount = page->fixCount;
+    pageFrame[pageFrameIndex].fileId = page->fileId;
+    FRAME_STORE(pageFrame[pageFrameIndex].hitNum, page->hitNum);
+    FRAME_STORE(pageFrame[pageFrameIndex].refNum, page->refNum);
+    FRAME_STORE(pageFrame[pageFrameIndex].fixCount, page->fixCount);
+    pageFrame[pageFrameIndex].readError = RC_OK;
+    __atomic_store_n(&pageFrame[pageFrameIndex].readPending, page->readPending, __ATOMIC_RELEASE);
+
+    // The page becomes visible to other pins only once the frame is filled in
+    PageTablePartition *part = partitionOf(mgmt, pageKey(page->fileId, page->pageNum));
+    latchPartition(mgmt, part);
+    insertPageTable(&part->table, pageKey(page->fileId, page->pageNum), pageFrameIndex);
+    unlatchPartition(mgmt, part);
 
     return true; // Confirm successful execution of the function
 }
 
+// Writes back the old page of a claimed frame, then reads the new page straight into the frame and
+// puts it there; page->data is set to the frame's data. If the read fails the frame is left empty
+// and unpinned, where the strategy can hand it out again, and the error is returned.
+static RC replaceFrame(BM_BufferPool *const bm, PageFrame *page, int idx)
+{
+    BufferPoolMgmt *mgmt = (BufferPoolMgmt *)bm->mgmtData;
+    PageFrame *pageFrame = mgmt->frames;
+
+    if (pageFrame[idx].pageNum != NO_PAGE)
+        COUNT_STAT(mgmt, evictions, 1);
+    if (cleanFrame(mgmt, idx)) { // Check if the page has been modified
+        if (writeBlockToDisk(bm, pageFrame, idx)) // Write modified page back to disk
+            COUNT_STAT(mgmt, evictionWrites, 1);
+    }
+
+    // Reading the page from disk into the frame the old page leaves
+    RC status = startRead(bm, page, idx);
+    if (status != RC_OK) {
+        pageFrame[idx].pageNum = NO_PAGE;
+        FRAME_STORE(pageFrame[idx].hitNum, 0);
+        FRAME_STORE(pageFrame[idx].refNum, 0);
+        __atomic_store_n(&pageFrame[idx].fixCount, 0, __ATOMIC_RELEASE); // Releasing the claim
+        syncFrame(bm, idx);
+        return status;
+    }
+    page->data = pageFrame[idx].data;
+
+    setNewPageToPageFrame(bm, page, idx); // Set new page to the claimed page frame
+    return RC_OK;
+}
+
+
+// Claims the least recently used unpinned frame of queue q, or of the other queue when every page
+// in q is pinned, and takes it out of its queue. Returns the frame and the queue it came from in
+// *from, or -1 when every page is pinned. Called with the list latch held.
+static int claimFromQueues(BM_BufferPool *const bm, int q, int *from)
+{
+    BufferPoolMgmt *mgmt = (BufferPoolMgmt *)bm->mgmtData;
+
+    while (true) {
+        *from = q;
+        int victim = oldestUnpinned(bm, q);
+        if (victim == -1) {
+            *from = 1 - q;
+            victim = oldestUnpinned(bm, *from);
+        }
+        if (victim == -1) return -1;
+
+        // Looking again if the page got pinned in the meantime
+        if (claimFrame(mgmt, victim)) {
+            dequeueFrame(mgmt, victim);
+            return victim;
+        }
+    }
+}
+
  
-void FIFO(BM_BufferPool *const bm, PageFrame *page) {
-    PageFrame *pageFrame = (PageFrame *)bm->mgmtData;
-    int currentIndex = numPagesReadCount % bufferSize; // Calculate the current index based on the number of pages read
+RC FIFO(BM_BufferPool *const bm, PageFrame *page) {
+    BufferPoolMgmt *mgmt = (BufferPoolMgmt *)bm->mgmtData;
+    int currentIndex = mgmt->numPagesReadCount % mgmt->bufferSize; // Calculate the current index based on the number of pages read
 
     // Loop through the buffer pool to find a suitable page frame for replacement
-    for (int iter = 0; iter < bufferSize; iter++) {
-        if (pageFrame[currentIndex].fixCount == 0) { // Page frame not in use
-            if (pageFrame[currentIndex].dirtyBit == 1) { // Check if the page has been modified
-                writeBlockToDisk(bm, pageFrame, currentIndex); // Write modified page back to disk
+    for (int iter = 0; iter < mgmt->bufferSize; iter++) {
+        if (claimFrame(mgmt, currentIndex)) { // Page frame not in use
+            return replaceFrame(bm, page, currentIndex); // Set new page to the current page frame
+        }
+
+        // Move to the next page frame and wrap around if at the end of the buffer
+        currentIndex = (currentIndex + 1) % mgmt->bufferSize;
+    }
+    return RC_BUFFER_POOL_FULL; // Every page is pinned
+}
+
+
+
+
+// Implementation of Least Frequently Used (LFU) page replacement algorithm: the victim is the least
+// recently unpinned page of the lowest bucket holding an unpinned page. Pinned pages are stepped
+// over, and pages hit since they last moved go to the bucket of their pin count first, so the search
+// costs at most one step per pinned or hit page.
+RC LFU(BM_BufferPool *const bm, PageFrame *page) {
+    BufferPoolMgmt *mgmt = (BufferPoolMgmt *)bm->mgmtData;
+    PageFrame *pageFrame = mgmt->frames;
+    int victim = -1;
+
+    latchList(mgmt);
+    for (int b = mgmt->firstBucket; b != -1 && victim == -1; ) {
+        // A hit page leaving b may free it, and the bucket it joins comes after b
+        int next = mgmt->buckets[b].next;
+        int idx = mgmt->buckets[b].frames.tail;
+        while (idx != -1 && victim == -1) {
+            int prev = mgmt->queuePrev[idx];
+            if (FRAME_LOAD(pageFrame[idx].fixCount) == 0 && FRAME_LOAD(pageFrame[idx].hitNum) != 0) {
+                requeueFrame(bm, idx);
+                if (mgmt->bucketOf[idx] == b && prev == -1)
+                    continue; // Back at the head of b, where it is looked at again
+            } else if (FRAME_LOAD(pageFrame[idx].fixCount) == 0 && claimFrame(mgmt, idx)) {
+                victim = idx; // Looking again if the page got pinned in the meantime
             }
-            
-            // Libera la memoria de la página actual antes de reemplazarla
-            if (pageFrame[currentIndex].data != NULL) {
-                free(pageFrame[currentIndex].data);
-                pageFrame[currentIndex].data = NULL; // Evitar punteros colgantes
+            idx = prev;
+        }
+        b = next;
+    }
+    if (victim == -1) {
+        unlatchList(mgmt);
+        return RC_BUFFER_POOL_FULL; // Every page is pinned
+    }
+
+    // The new page starts with no pins counted
+    leaveBucket(mgmt, victim);
+    FRAME_STORE(pageFrame[victim].refNum, 0);
+    moveToBucket(mgmt, victim, 0);
+    listInBucket(mgmt, victim);
+    unlatchList(mgmt);
+
+    return replaceFrame(bm, page, victim); // Replace the least frequently used page frame
+}
+
+// Implementation of Least Recently Used (LRU) page replacement algorithm: the victim is the unpinned
+// frame nearest the tail of the list, the page unpinned longest ago
+RC LRU(BM_BufferPool *const bm, PageFrame *page) {
+    BufferPoolMgmt *mgmt = (BufferPoolMgmt *)bm->mgmtData;
+    int from;
+
+    latchList(mgmt);
+    int victim = claimFromQueues(bm, 0, &from);
+    if (victim != -1)
+        queueFrame(mgmt, 0, victim); // The new page starts as the most recently used
+    unlatchList(mgmt);
+    if (victim == -1) return RC_BUFFER_POOL_FULL; // Every page is pinned
+
+    return replaceFrame(bm, page, victim); // Set new page to the least recently used page frame
+}
+
+// Implementation of CLOCK page replacement algorithm
+RC CLOCK(BM_BufferPool *const bm, PageFrame *page) {
+    BufferPoolMgmt *mgmt = (BufferPoolMgmt *)bm->mgmtData;
+    PageFrame *pageFrame = mgmt->frames;
+
+    // Hits advance the clock pointer too, so it is wrapped before use
+    mgmt->clockPointer %= mgmt->bufferSize;
+
+    // Loop around the clock once until a suitable page frame is found
+    for (int iter = 0; iter < mgmt->bufferSize; iter++) {
+        if (claimFrame(mgmt, mgmt->clockPointer)) { // Check if the current page frame is not in use
+            RC status = replaceFrame(bm, page, mgmt->clockPointer); // Set new page to the current page frame
+            mgmt->clockPointer = (mgmt->clockPointer + 1) % mgmt->bufferSize; // Move the clock pointer to the next page frame
+            return status; // Exit the loop after setting the new page
+        } else {
+            FRAME_STORE(pageFrame[mgmt->clockPointer].hitNum, 0); // Reset the hit number for the current page frame
+            mgmt->clockPointer = (mgmt->clockPointer + 1) % mgmt->bufferSize; // Move to the next page frame
+        }
+    }
+    return RC_BUFFER_POOL_FULL; // Every page is pinned
+}
+
+// Implementation of LRU-K page replacement algorithm: the victim is the unpinned page whose K-th
+// latest reference is oldest. Pages referenced fewer than K times count as infinitely old and go
+// first, the least recently used of them first, so a one-off scan cannot push out pages in use.
+RC LRU_K(BM_BufferPool *const bm, PageFrame *page) {
+    BufferPoolMgmt *mgmt = (BufferPoolMgmt *)bm->mgmtData;
+    PageFrame *pageFrame = mgmt->frames;
+    int k = mgmt->lruK;
+
+    // Searching again if the chosen frame gets pinned before it is claimed
+    while (true) {
+        int victim = -1, victimKth = INT_MAX, victimLast = INT_MAX;
+
+        for (int i = 0; i < mgmt->bufferSize; i++) {
+            if (FRAME_LOAD(pageFrame[i].fixCount) != 0) continue;
+
+            int *hist = frameHistory(mgmt, i);
+            int kth = FRAME_LOAD(hist[k - 1]), last = FRAME_LOAD(hist[0]);
+            if (kth < victimKth || (kth == victimKth && last < victimLast)) {
+                victim = i;
+                victimKth = kth;
+                victimLast = last;
             }
+        }
+        if (victim == -1) return RC_BUFFER_POOL_FULL; // Every page is pinned
 
-            setNewPageToPageFrame(pageFrame, page, currentIndex); // Set new page to the current page frame
-            break; // Exit the loop after setting the new page
+        if (claimFrame(mgmt, victim)) {
+            // Moving the histories before the new page becomes visible to hits
+            retainHistory(mgmt, victim);
+            restoreHistory(mgmt, victim, pageKey(page->fileId, page->pageNum));
+            return replaceFrame(bm, page, victim);
         }
+    }
+}
 
-        // Move to the next page frame and wrap around if at the end of the buffer
-        currentIndex = (currentIndex + 1) % bufferSize;
+// Implementation of ARC (adaptive replacement cache) page replacement algorithm. T1 holds pages
+// seen once lately and T2 pages seen at least twice; the ghost lists B1 and B2 remember the pages
+// last evicted from each. A miss on a B1 ghost grows p, the share of the frames T1 aims for, and a
+// miss on a B2 ghost shrinks it, so the split between recency and frequency follows the workload.
+RC ARC(BM_BufferPool *const bm, PageFrame *page) {
+    BufferPoolMgmt *mgmt = (BufferPoolMgmt *)bm->mgmtData;
+    NodeList *t1 = &mgmt->queues[0], *t2 = &mgmt->queues[1];
+    NodeList *b1 = &mgmt->ghosts[0], *b2 = &mgmt->ghosts[1];
+    int c = mgmt->bufferSize, from;
+    bool keepGhost = true;
+
+    latchList(mgmt);
+    int e = lookupFrame(&mgmt->ghostTable, pageKey(page->fileId, page->pageNum));
+    int ghost = e >= 0 ? mgmt->ghostOf[e] : -1;
+
+    // Adapting p on a ghost hit; on a complete miss keeping T1+B1 within c and all lists within 2c
+    if (ghost == 0) {
+        int delta = b2->size / b1->size > 1 ? b2->size / b1->size : 1;
+        mgmt->arcTarget = mgmt->arcTarget + delta < c ? mgmt->arcTarget + delta : c;
+    } else if (ghost == 1) {
+        int delta = b1->size / b2->size > 1 ? b1->size / b2->size : 1;
+        mgmt->arcTarget = mgmt->arcTarget - delta > 0 ? mgmt->arcTarget - delta : 0;
+    } else if (t1->size + b1->size >= c) {
+        if (b1->size > 0)
+            dropOldestGhost(mgmt, 0);
+        else
+            keepGhost = false; // T1 fills the pool: its oldest page leaves without a ghost
+    } else if (t1->size + t2->size + b1->size + b2->size >= 2 * c) {
+        dropOldestGhost(mgmt, 1);
+    }
+    if (e >= 0)
+        dropGhost(mgmt, e);
+
+    // Replacing from T1 while it is above p (or at p on a B2 hit), from T2 otherwise
+    int q = (t1->size > 0 && (t1->size > mgmt->arcTarget || (ghost == 1 && t1->size == mgmt->arcTarget))) || !keepGhost ? 0 : 1;
+    int victim = claimFromQueues(bm, q, &from);
+    if (victim == -1) {
+        unlatchList(mgmt);
+        return RC_BUFFER_POOL_FULL; // Every page is pinned
+    }
+    if (keepGhost && mgmt->frames[victim].pageNum != NO_PAGE)
+        addGhost(mgmt, from, frameKey(mgmt, victim));
+    queueFrame(mgmt, ghost >= 0 ? 1 : 0, victim); // A page remembered by a ghost has been seen twice
+    unlatchList(mgmt);
+
+    return replaceFrame(bm, page, victim); // Only the victim latch holder can reach the claimed frame
+}
+
+// Implementation of 2Q page replacement algorithm. A page seen once waits in the A1in FIFO; one
+// asked for again after leaving A1in, while the A1out ghosts still remember it, joins Am, an LRU
+// queue of the pages in real use. A scan only passes through A1in and leaves Am alone.
+RC TWO_Q(BM_BufferPool *const bm, PageFrame *page) {
+    BufferPoolMgmt *mgmt = (BufferPoolMgmt *)bm->mgmtData;
+    int from;
+
+    latchList(mgmt);
+    int e = lookupFrame(&mgmt->ghostTable, pageKey(page->fileId, page->pageNum));
+    if (e >= 0)
+        dropGhost(mgmt, e);
+
+    // Taking the frame from A1in while it holds more than Kin pages, from Am otherwise
+    int victim = claimFromQueues(bm, mgmt->queues[0].size > mgmt->inTarget ? 0 : 1, &from);
+    if (victim == -1) {
+        unlatchList(mgmt);
+        return RC_BUFFER_POOL_FULL; // Every page is pinned
+    }
+    if (from == 0 && mgmt->frames[victim].pageNum != NO_PAGE) {
+        // Pages leaving A1in are remembered in A1out
+        addGhost(mgmt, 0, frameKey(mgmt, victim));
+        if (mgmt->ghosts[0].size > mgmt->outTarget)
+            dropOldestGhost(mgmt, 0);
     }
+    queueFrame(mgmt, e >= 0 ? 1 : 0, victim);
+    unlatchList(mgmt);
+
+    return replaceFrame(bm, page, victim); // Only the victim latch holder can reach the claimed frame
 }
 
+// Puts the new page into frame idx, one an access strategy read a page into before, if that page is
+// unpinned, and moves the frame in the bookkeeping of the pool's strategy the way a replacement
+// does: a ring page starts over at the head of the LRU list, in the lowest LFU bucket, or in T1/A1in
+// under ARC/2Q.
+// Returns RC_BUFFER_POOL_FULL if the page is pinned, and the read's error if it fails.
+static RC reuseFrame(BM_BufferPool *const bm, PageFrame *page, int idx)
+{
+    BufferPoolMgmt *mgmt = (BufferPoolMgmt *)bm->mgmtData;
+
+    latchList(mgmt);
+    if (!claimFrame(mgmt, idx)) {
+        unlatchList(mgmt);
+        return RC_BUFFER_POOL_FULL; // Pinned by another client, which keeps the page
+    }
+    switch (bm->strategy) {
+    case RS_LRU:
+        dequeueFrame(mgmt, idx);
+        queueFrame(mgmt, 0, idx);
+        break;
+    case RS_LFU:
+        leaveBucket(mgmt, idx);
+        FRAME_STORE(mgmt->frames[idx].refNum, 0);
+        moveToBucket(mgmt, idx, 0);
+        listInBucket(mgmt, idx);
+        break;
+    case RS_LRU_K:
+        retainHistory(mgmt, idx);
+        restoreHistory(mgmt, idx, pageKey(page->fileId, page->pageNum));
+        break;
+    case RS_ARC:
+    case RS_2Q:
+        dequeueFrame(mgmt, idx);
+        queueFrame(mgmt, 0, idx);
+        break;
+    default:
+        break;
+    }
+    unlatchList(mgmt);
+
+    COUNT_STAT(mgmt, ringEvictions, 1);
+    return replaceFrame(bm, page, idx);
+}
+
+// Fills in the default pool options: buffered I/O through the kernel page cache
+void initPoolOptions(BM_PoolOptions *options)
+{
+    options->directIO = false;
+    options->threadSafe = false;
+    options->latchPartitions = BM_DEFAULT_LATCH_PARTITIONS;
+    options->hugePages = false;
+    options->backgroundWriter = false;
+    options->writerHighWatermark = BM_DEFAULT_WRITER_HIGH_WATERMARK;
+    options->writerLowWatermark = BM_DEFAULT_WRITER_LOW_WATERMARK;
+    options->warmStart = false;
+}
+
+// Allocates the data of numPages frames as one more arena of the pool. With the hugePages option the
+// arena is mapped from the reserved huge pages (MAP_HUGETLB) and, when there are none, from ordinary
+// memory the kernel is asked to back with transparent huge pages; otherwise it is one aligned buffer.
+// The new arena is the last of mgmt->arenas.
+static RC addArena(BufferPoolMgmt *mgmt, int numPages)
+{
+    size_t length = (size_t)numPages * mgmt->pageSize;
+
+    char **arenas = realloc(mgmt->arenas, sizeof(char *) * (mgmt->numArenas + 1));
+    if (arenas != NULL) mgmt->arenas = arenas;
+    size_t *lengths = realloc(mgmt->arenaLengths, sizeof(size_t) * (mgmt->numArenas + 1));
+    if (lengths != NULL) mgmt->arenaLengths = lengths;
+    if (arenas == NULL || lengths == NULL) return RC_ERROR;
+
+    if (!mgmt->options.hugePages) {
+        char *buffers = allocPageBuffersOfSize(numPages, mgmt->pageSize);
+        if (buffers == NULL) return RC_ERROR;
+        mgmt->arenas[mgmt->numArenas] = buffers;
+        mgmt->arenaLengths[mgmt->numArenas++] = 0;
+        return RC_OK;
+    }
+
+    length = (length + BM_HUGE_PAGE_SIZE - 1) / BM_HUGE_PAGE_SIZE * BM_HUGE_PAGE_SIZE;
+    void *arena = MAP_FAILED;
+#ifdef MAP_HUGETLB
+    arena = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif
+    if (arena == MAP_FAILED) {
+        // Mapping a huge page more than needed and trimming it to a huge page boundary, where
+        // the kernel can back the arena with transparent huge pages
+        char *mapped = mmap(NULL, length + BM_HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (mapped == MAP_FAILED) return RC_ERROR;
+        size_t head = (BM_HUGE_PAGE_SIZE - (uintptr_t)mapped % BM_HUGE_PAGE_SIZE) % BM_HUGE_PAGE_SIZE;
+        if (head > 0)
+            munmap(mapped, head);
+        munmap(mapped + head + length, BM_HUGE_PAGE_SIZE - head);
+        arena = mapped + head;
+#ifdef MADV_HUGEPAGE
+        madvise(arena, length, MADV_HUGEPAGE); // Only a hint; the arena works without it
+#endif
+    }
+    mgmt->arenas[mgmt->numArenas] = arena;
+    mgmt->arenaLengths[mgmt->numArenas++] = length;
+    return RC_OK;
+}
 
+static void freeArenas(BufferPoolMgmt *mgmt)
+{
+    for (int i = 0; i < mgmt->numArenas; i++) {
+        if (mgmt->arenaLengths[i] > 0)
+            munmap(mgmt->arenas[i], mgmt->arenaLengths[i]);
+        else
+            freePageBuffers(mgmt->arenas[i]);
+    }
+    free(mgmt->arenas);
+    free(mgmt->arenaLengths);
+    free(mgmt->spareData);
+}
 
+// Allocates the page table: one partition holding every frame, or for a thread-safe pool
+// latchPartitions of them (rounded up to a power of two) sharing the frames between them.
+static RC initPageTable(BufferPoolMgmt *mgmt, int numPages)
+{
+    int numPartitions = 1, shift = 32;
+    if (mgmt->threadSafe)
+        while (numPartitions < mgmt->options.latchPartitions && numPartitions < (1 << 16)) {
+            numPartitions *= 2;
+            shift--;
+        }
 
-// Implementation of Least Frequently Used (LFU) page replacement algorithm
-void LFU(BM_BufferPool *const bm, PageFrame *page) {
-    PageFrame *pageFrame = (PageFrame *)bm->mgmtData;
-    int leastFreqIndex = lfuPointer, leastFreqRef = pageFrame[lfuPointer].refNum;
+    // Size each partition to keep it at most half full when pages spread evenly
+    int perPartition = (numPages + numPartitions - 1) / numPartitions;
+    int tableSize = 2;
+    while (tableSize < 2 * perPartition) tableSize *= 2;
 
-    // Iterate through all page frames to find the least frequently used one
-    for (int i = 0; i < bufferSize; i++) {
-        int currentIndex = (lfuPointer + i) % bufferSize; // Calculate the current index
-        if (pageFrame[currentIndex].fixCount == 0 && pageFrame[currentIndex].refNum < leastFreqRef) {
-            leastFreqIndex = currentIndex; // Update the least frequently used index
-            leastFreqRef = pageFrame[currentIndex].refNum; // Update the least frequency
+    void *partitions;
+    if (posix_memalign(&partitions, sizeof(PageTablePartition), sizeof(PageTablePartition) * numPartitions) != 0)
+        return RC_ERROR;
+    mgmt->partitions = partitions;
+    mgmt->numPartitions = numPartitions;
+    mgmt->partitionShift = shift;
+
+    for (int i = 0; i < numPartitions; i++) {
+        PageTablePartition *part = &mgmt->partitions[i];
+        pthread_mutex_init(&part->latch, NULL);
+        part->table.slots = newTableSlots(tableSize);
+        part->table.mask = tableSize - 1;
+        part->table.count = 0;
+        part->hits = 0;
+        part->quickPins = 0;
+        if (part->table.slots == NULL) {
+            mgmt->numPartitions = i + 1;
+            freePageTable(mgmt);
+            mgmt->partitions = NULL;
+            return RC_ERROR;
         }
     }
+    return RC_OK;
+}
 
-    // Replace the least frequently used page frame if it's not in use
-    if (pageFrame[leastFreqIndex].dirtyBit == 1) {
-        writeBlockToDisk(bm, pageFrame, leastFreqIndex); // Write modified page back to disk
+
+// BACKGROUND WRITER //
+
+// A dirty frame to flush and the page it holds
+typedef struct DirtyFrame {
+    PageNumber pageNum;
+    int fileId;
+    int frameIndex;
+} DirtyFrame;
+
+// Orders dirty frames by file, then by page
+static int compareDirtyFrames(const void *a, const void *b)
+{
+    const DirtyFrame *x = a, *y = b;
+    if (x->fileId != y->fileId)
+        return (x->fileId > y->fileId) - (x->fileId < y->fileId);
+    return (x->pageNum > y->pageNum) - (x->pageNum < y->pageNum);
+}
+
+// Whether dirty frame b holds the page after that of a in the same file, so one write takes both
+static bool followsDirtyFrame(const DirtyFrame *a, const DirtyFrame *b)
+{
+    return b->fileId == a->fileId && b->pageNum == a->pageNum + 1;
+}
+
+
+// Fixes frame idx for the background writer and adds it to the batch if it holds a dirty page no
+// client has pinned. The fix keeps the frame from being replaced while its page is written, without
+// moving it in the LRU list or the LFU buckets. Called with the victim latch held.
+static void fixForWriter(BufferPoolMgmt *mgmt, int idx, DirtyFrame *batch, int *n)
+{
+    PageFrame *pageFrame = mgmt->frames;
+    if (pageFrame[idx].pageNum == NO_PAGE || FRAME_LOAD(pageFrame[idx].dirtyBit) == 0
+        || FRAME_LOAD(pageFrame[idx].fixCount) != 0)
+        return;
+
+    PageTablePartition *part = partitionOf(mgmt, frameKey(mgmt, idx));
+    latchPartition(mgmt, part);
+    if (__atomic_load_n(&pageFrame[idx].fixCount, __ATOMIC_ACQUIRE) == 0) {
+        __atomic_store_n(&pageFrame[idx].fixCount, 1, __ATOMIC_RELAXED);
+        batch[*n].pageNum = pageFrame[idx].pageNum;
+        batch[*n].fileId = pageFrame[idx].fileId;
+        batch[*n].frameIndex = idx;
+        (*n)++;
     }
+    unlatchPartition(mgmt, part);
+}
+
+// Fixes up to BM_WRITER_BATCH dirty unpinned frames in the order the pool's strategy is going to
+// replace them: from the cold end of the LRU list, or from the hand of FIFO and CLOCK. Other
+// strategies have no cheap order, so the writer sweeps their frames round. Called with the victim
+// latch held; returns the number of frames fixed.
+static int collectForWriter(BM_BufferPool *const bm, DirtyFrame *batch)
+{
+    BufferPoolMgmt *mgmt = (BufferPoolMgmt *)bm->mgmtData;
+    int n = 0;
+
+    if (bm->strategy == RS_LRU) {
+        latchList(mgmt);
+        for (int idx = mgmt->queues[0].tail; idx != -1 && n < BM_WRITER_BATCH; idx = mgmt->queuePrev[idx])
+            fixForWriter(mgmt, idx, batch, &n);
+        unlatchList(mgmt);
+        return n;
+    }
+
+    int start = mgmt->writerPos, k;
+    if (bm->strategy == RS_FIFO)
+        start = mgmt->numPagesReadCount % mgmt->bufferSize;
+    else if (bm->strategy == RS_CLOCK)
+        start = mgmt->clockPointer % mgmt->bufferSize;
+    for (k = 0; k < mgmt->bufferSize && n < BM_WRITER_BATCH; k++)
+        fixForWriter(mgmt, (start + k) % mgmt->bufferSize, batch, &n);
+    mgmt->writerPos = (start + k) % mgmt->bufferSize;
+    return n;
+}
+
+// Writes the fixed frames of the batch in file order, runs of consecutive pages at once, then
+// gives up the fixes. Dirty bits are cleared before the write, so a client changing a page meanwhile
+// marks it dirty again and the change is written later. Called without the victim latch.
+static void writeBatch(BM_BufferPool *const bm, DirtyFrame *batch, int n)
+{
+    BufferPoolMgmt *mgmt = (BufferPoolMgmt *)bm->mgmtData;
+    PageFrame *pageFrame = mgmt->frames;
+    SM_PageHandle run[BM_WRITER_BATCH];
+
+    qsort(batch, n, sizeof(DirtyFrame), compareDirtyFrames);
+    for (int i = 0; i < n; ) {
+        int length = 0;
+        do {
+            cleanFrame(mgmt, batch[i + length].frameIndex);
+            run[length] = pageFrame[batch[i + length].frameIndex].data;
+            length++;
+        } while (i + length < n && length < BM_WRITER_RUN && followsDirtyFrame(&batch[i + length - 1], &batch[i + length]));
+
+        latchIO(mgmt);
+        RC status = writeBlocks(batch[i].pageNum, length, fileOf(mgmt, batch[i].fileId), run);
+        unlatchIO(mgmt);
+        if (status == RC_OK) {
+            __atomic_add_fetch(&mgmt->totalDiskWriteCount, length, __ATOMIC_RELAXED);
+            COUNT_STAT(mgmt, writerWrites, length);
+        } else
+            for (int k = i; k < i + length; k++)
+                dirtyFrame(mgmt, batch[k].frameIndex); // Left for the next round or the replacement
+        i += length;
+    }
+
+    for (int i = 0; i < n; i++) {
+        int idx = batch[i].frameIndex;
+        PageTablePartition *part = partitionOf(mgmt, pageKey(batch[i].fileId, batch[i].pageNum));
+        latchPartition(mgmt, part);
+        __atomic_sub_fetch(&pageFrame[idx].fixCount, 1, __ATOMIC_RELEASE);
+        unlatchPartition(mgmt, part);
+        syncFrame(bm, idx); // A client may have pinned and unpinned the page meanwhile
+    }
+}
+
+// Waits on the writer's condition variable for at most BM_WRITER_DELAY ms; writerLock is held
+static void writerSleep(BufferPoolMgmt *mgmt)
+{
+    struct timespec until;
+    clock_gettime(CLOCK_REALTIME, &until);
+    until.tv_nsec += BM_WRITER_DELAY * 1000000L;
+    if (until.tv_nsec >= 1000000000L) {
+        until.tv_sec++;
+        until.tv_nsec -= 1000000000L;
+    }
+    pthread_cond_timedwait(&mgmt->writerWake, &mgmt->writerLock, &until);
+}
+
+// The background writer of a pool. Once the dirty frames reach the high watermark it writes the ones
+// due for replacement first until only the low watermark is left dirty, so misses mostly find a
+// clean victim and do not wait for its write.
+static void *backgroundWriter(void *arg)
+{
+    BM_BufferPool *bm = (BM_BufferPool *)arg;
+    BufferPoolMgmt *mgmt = (BufferPoolMgmt *)bm->mgmtData;
+    DirtyFrame batch[BM_WRITER_BATCH];
+    int high = mgmt->options.writerHighWatermark * mgmt->bufferSize;
+    int low = mgmt->options.writerLowWatermark * mgmt->bufferSize;
+
+    pthread_mutex_lock(&mgmt->writerLock);
+    while (!mgmt->writerStop) {
+        if (__atomic_load_n(&mgmt->numDirty, __ATOMIC_RELAXED) * 100 < high) {
+            writerSleep(mgmt);
+            continue;
+        }
+        pthread_mutex_unlock(&mgmt->writerLock);
+
+        int written = 0;
+        while (__atomic_load_n(&mgmt->numDirty, __ATOMIC_RELAXED) * 100 > low
+               && !__atomic_load_n(&mgmt->writerStop, __ATOMIC_RELAXED)) {
+            latchVictim(mgmt);
+            int n = collectForWriter(bm, batch);
+            unlatchVictim(mgmt);
+            if (n == 0) break; // The dirty pages left are pinned
+            writeBatch(bm, batch, n);
+            written += n;
+        }
+
+        pthread_mutex_lock(&mgmt->writerLock);
+        if (written == 0 && !mgmt->writerStop)
+            writerSleep(mgmt); // Waiting for clients to unpin their pages
+    }
+    pthread_mutex_unlock(&mgmt->writerLock);
+    return NULL;
+}
+
+// Stops the background writer of a pool, if it has one, waiting for its last batch
+static void stopWriter(BufferPoolMgmt *mgmt)
+{
+    if (!mgmt->options.backgroundWriter) return;
+    pthread_mutex_lock(&mgmt->writerLock);
+    __atomic_store_n(&mgmt->writerStop, true, __ATOMIC_RELAXED);
+    pthread_cond_signal(&mgmt->writerWake);
+    pthread_mutex_unlock(&mgmt->writerLock);
+    pthread_join(mgmt->writerThread, NULL);
+}
+
+
+// Starts the background writer of a pool if its options ask for one. It works on the pool through
+// the pool that owns the frames, which must stay where it is.
+static RC startWriter(BufferPoolMgmt *mgmt)
+{
+    if (!mgmt->options.backgroundWriter)
+        return RC_OK;
+    mgmt->writerStop = false;
+    if (pthread_create(&mgmt->writerThread, NULL, backgroundWriter, mgmt->owner) != 0) {
+        mgmt->options.backgroundWriter = false;
+        return RC_ERROR;
+    }
+    return RC_OK;
+}
+
+// WARM START //
+
+// Magic number opening a warm start manifest, followed by the number of pages and the page numbers
+#define BM_WARM_START_MAGIC 0x424d5753
+
+// The frame of a resident page and how hot its strategy considers the page
+typedef struct HotPage {
+    int frameIndex;
+    int heat;
+} HotPage;
+
+static int compareHotPages(const void *a, const void *b)
+{
+    int x = ((const HotPage *)a)->heat, y = ((const HotPage *)b)->heat;
+    return (y > x) - (y < x);
+}
+
+static int comparePageNumbers(const void *a, const void *b)
+{
+    PageNumber x = *(const PageNumber *)a, y = *(const PageNumber *)b;
+    return (x > y) - (x < y);
+}
+
+// The name of the warm start manifest of a pool's page file; the caller frees it
+static char *manifestName(BM_BufferPool *const bm)
+{
+    char *name = malloc(strlen(bm->pageFile) + strlen(BM_WARM_START_SUFFIX) + 1);
+    if (name != NULL)
+        sprintf(name, "%s%s", bm->pageFile, BM_WARM_START_SUFFIX);
+    return name;
+}
+
+// Stores the frames holding a page in frames, hottest page first, and returns how many there are. LRU
+// orders them by recency; ARC and 2Q put T2/Am before T1/A1in; LFU orders by pin
+// count and LRU-K by latest reference. FIFO and CLOCK keep no order, so their frames come in order.
+static int hottestFrames(BM_BufferPool *const bm, int *frames)
+{
+    BufferPoolMgmt *mgmt = (BufferPoolMgmt *)bm->mgmtData;
+    PageFrame *pageFrame = mgmt->frames;
+    HotPage *hot = malloc(sizeof(HotPage) * mgmt->bufferSize);
+    int n = 0, rank = mgmt->bufferSize;
+
+    if (hot == NULL) return 0;
+    if (bm->strategy == RS_LRU || bm->strategy == RS_ARC || bm->strategy == RS_2Q) {
+        for (int q = bm->strategy == RS_LRU ? 0 : 1; q >= 0; q--)
+            for (int idx = mgmt->queues[q].head; idx != -1; idx = mgmt->queueNext[idx])
+                if (pageFrame[idx].pageNum != NO_PAGE) // A frame whose read failed is queued empty
+                    hot[n++] = (HotPage){ idx, rank-- };
+    } else {
+        for (int i = 0; i < mgmt->framesUsed; i++) {
+            if (pageFrame[i].pageNum == NO_PAGE) continue;
+            int heat = -i;
+            if (bm->strategy == RS_LFU)
+                heat = pageFrame[i].refNum;
+            else if (bm->strategy == RS_LRU_K)
+                heat = frameHistory(mgmt, i)[0];
+            hot[n++] = (HotPage){ i, heat };
+        }
+    }
+
+    qsort(hot, n, sizeof(HotPage), compareHotPages);
+    for (int i = 0; i < n; i++)
+        frames[i] = hot[i].frameIndex;
+    free(hot);
+    return n;
+}
+
+// Writes the warm start manifest of a pool's file: its resident pages, hottest first
+static RC saveManifest(BM_BufferPool *const bm)
+{
+    BufferPoolMgmt *mgmt = (BufferPoolMgmt *)bm->mgmtData;
+    PageNumber *pages = malloc(sizeof(PageNumber) * mgmt->bufferSize);
+    char *name = manifestName(bm);
+    FILE *file = NULL;
+    RC status = RC_WRITE_FAILED;
+
+    if (pages != NULL && name != NULL && (file = fopen(name, "wb")) != NULL) {
+        int header[2] = { BM_WARM_START_MAGIC, 0 };
+        int n = hottestFrames(bm, pages);
+        for (int i = 0; i < n; i++)
+            if (mgmt->frames[pages[i]].fileId == bm->fileId)
+                pages[header[1]++] = mgmt->frames[pages[i]].pageNum;
+        if (fwrite(header, sizeof(int), 2, file) == 2
+            && fwrite(pages, sizeof(PageNumber), header[1], file) == (size_t)header[1])
+            status = RC_OK;
+        if (fclose(file) != 0)
+            status = RC_WRITE_FAILED;
+    }
+    free(pages);
+    free(name);
+    return status;
+}
+
+// Reads the pages of the warm start manifest of a pool's file back into the free frames, as many as
+// fit, hottest first. Sorted by page number they go to consecutive frames, so each run of consecutive
+// pages is one vectored read. Then they join the strategy's lists coldest first, which leaves the
+// hottest page the most recently used. Without a readable manifest the file starts cold. Called with
+// the victim latch held.
+static void loadManifest(BM_BufferPool *const bm)
+{
+    BufferPoolMgmt *mgmt = (BufferPoolMgmt *)bm->mgmtData;
+    PageFrame *pageFrame = mgmt->frames;
+    SM_FileHandle *fileHandle = fileOf(mgmt, bm->fileId);
+    int start = mgmt->framesUsed;
+    char *name = manifestName(bm);
+    FILE *file = name != NULL ? fopen(name, "rb") : NULL;
+    int header[2];
+
+    free(name);
+    if (file == NULL) return;
+    if (fread(header, sizeof(int), 2, file) != 2 || header[0] != BM_WARM_START_MAGIC || header[1] < 0) {
+        fclose(file);
+        return;
+    }
+
+    // Keeping the hottest pages that exist and fit, each once
+    int count = header[1] < mgmt->bufferSize - start ? header[1] : mgmt->bufferSize - start;
+    PageNumber *hot = malloc(sizeof(PageNumber) * (count + 1));
+    PageNumber *sorted = malloc(sizeof(PageNumber) * (count + 1));
+    SM_PageHandle *run = malloc(sizeof(SM_PageHandle) * (count + 1));
+    bool *admitted = calloc(count + 1, sizeof(bool));
+    int n = 0;
+    if (hot != NULL && sorted != NULL && run != NULL && admitted != NULL)
+        n = (int)fread(hot, sizeof(PageNumber), count, file);
+    fclose(file);
+    for (int i = 0; i < n; i++)
+        sorted[i] = hot[i];
+    qsort(sorted, n, sizeof(PageNumber), comparePageNumbers);
+    int k = 0;
+    for (int i = 0; i < n; i++)
+        if (sorted[i] >= 0 && sorted[i] < fileHandle->totalNumPages && (k == 0 || sorted[k - 1] != sorted[i]))
+            sorted[k++] = sorted[i];
+
+    // Reading runs of consecutive pages into consecutive frames
+    int loaded = 0;
+    while (loaded < k) {
+        int length = 0;
+        do {
+            run[length] = pageFrame[start + loaded + length].data;
+            length++;
+        } while (loaded + length < k && sorted[loaded + length] == sorted[loaded] + length);
+        latchIO(mgmt);
+        RC status = readBlocks(sorted[loaded], length, fileHandle, run);
+        unlatchIO(mgmt);
+        if (status != RC_OK)
+            break; // The pages read so far are kept
+        COUNT_STAT(mgmt, pagesRead, length);
+        for (int j = loaded; j < loaded + length; j++) {
+            PageFrame frame = { pageFrame[start + j].data, sorted[j], bm->fileId, 0, 0, 0, 0, 0, RC_OK };
+            setNewPageToPageFrame(bm, &frame, start + j);
+        }
+        loaded += length;
+    }
+    mgmt->framesUsed = start + loaded;
+    if (loaded > 0) // As if the pages had been pinned one by one
+        mgmt->numPagesReadCount = start == 0 ? loaded - 1 : mgmt->numPagesReadCount + loaded;
+
+    // Admitting them the way misses do, coldest first
+    for (int i = n - 1; i >= 0; i--) {
+        PageKey key = pageKey(bm->fileId, hot[i]);
+        int idx = hot[i] >= 0 ? lookupFrame(&partitionOf(mgmt, key)->table, key) - start : -1;
+        if (idx < 0 || admitted[idx])
+            continue; // Not loaded, or listed twice
+        admitted[idx] = true;
+        if (bm->strategy == RS_LRU_K)
+            restoreHistory(mgmt, start + idx, key);
+        else
+            admitFrame(bm, start + idx, key);
+    }
+
+    free(hot);
+    free(sorted);
+    free(run);
+    free(admitted);
+}
+
+
+// RESIZING //
+
+#define SWAP_FIELD(a, b, field) \
+    do { __typeof__((a)->field) swapped = (a)->field; (a)->field = (b)->field; (b)->field = swapped; } while (0)
+
+// Exchanges the page table, LRU-K history, queues, buckets and ghost lists of two pools
+static void swapStructures(BufferPoolMgmt *mgmt, BufferPoolMgmt *other)
+{
+    SWAP_FIELD(mgmt, other, partitions);
+    SWAP_FIELD(mgmt, other, numPartitions);
+    SWAP_FIELD(mgmt, other, partitionShift);
+    SWAP_FIELD(mgmt, other, history);
+    SWAP_FIELD(mgmt, other, retained);
+    SWAP_FIELD(mgmt, other, retainedPages);
+    SWAP_FIELD(mgmt, other, retainedHistory);
+    SWAP_FIELD(mgmt, other, retainedSlots);
+    SWAP_FIELD(mgmt, other, retainedNext);
+    for (int q = 0; q < 2; q++) {
+        SWAP_FIELD(mgmt, other, queues[q]);
+        SWAP_FIELD(mgmt, other, ghosts[q]);
+    }
+    SWAP_FIELD(mgmt, other, queuePrev);
+    SWAP_FIELD(mgmt, other, queueNext);
+    SWAP_FIELD(mgmt, other, queueOf);
+    SWAP_FIELD(mgmt, other, buckets);
+    SWAP_FIELD(mgmt, other, bucketOf);
+    SWAP_FIELD(mgmt, other, firstBucket);
+    SWAP_FIELD(mgmt, other, freeBucket);
+    SWAP_FIELD(mgmt, other, ghostTable);
+    SWAP_FIELD(mgmt, other, ghostPage);
+    SWAP_FIELD(mgmt, other, ghostPrev);
+    SWAP_FIELD(mgmt, other, ghostNext);
+    SWAP_FIELD(mgmt, other, ghostOf);
+    SWAP_FIELD(mgmt, other, ghostFree);
+    SWAP_FIELD(mgmt, other, inTarget);
+    SWAP_FIELD(mgmt, other, outTarget);
+}
+
+static void freeStructures(BufferPoolMgmt *mgmt)
+{
+    if (mgmt->partitions != NULL)
+        freePageTable(mgmt);
+    freeLruK(mgmt);
+    freeQueues(mgmt);
+}
+
+// Gives the memory of an arena slot no frame uses back to the kernel; the slot reads as zeros later
+static void releaseSlot(BufferPoolMgmt *mgmt, SM_PageHandle data)
+{
+    long osPage = sysconf(_SC_PAGESIZE);
+    if (osPage > 0 && mgmt->pageSize % osPage == 0 && (uintptr_t)data % osPage == 0)
+        madvise(data, mgmt->pageSize, MADV_DONTNEED);
+}
+
+// Puts the pages of the frames marked in keep, in their order, into the first frames of a new array
+// of newNumPages frames; the others get the slots of the frames left over, then new arena slots. The
+// page table and the strategy's structures are built anew for the new frames, the kept pages joining
+// them coldest first from hot, the hottestFrames order of the old frames. Evicted pages become ghosts
+// under ARC and 2Q, the way a replacement leaves them, unless they belong to dropFile, a file leaving
+// the pool, whose ghosts go as well. Called with the pool paused; on failure the pool is left as it was.
+static RC rebuildFrames(BM_BufferPool *const bm, int newNumPages, const int *hot, int n, const bool *keep, int dropFile)
+{
+    BufferPoolMgmt *mgmt = (BufferPoolMgmt *)bm->mgmtData;
+    PageFrame *old = mgmt->frames;
+    int oldSize = mgmt->bufferSize, kept = 0;
+
+    for (int i = 0; i < oldSize; i++)
+        kept += keep[i];
+    int numSlots = oldSize - kept + mgmt->numSpare;
+    int newSlots = newNumPages - kept > numSlots ? newNumPages - kept - numSlots : 0;
+    int spareLeft = numSlots + newSlots - (newNumPages - kept);
+
+    // Allocating everything up front, so nothing has changed when an allocation fails
+    PageFrame *frames = malloc(sizeof(PageFrame) * newNumPages);
+    SM_PageHandle *slots = malloc(sizeof(SM_PageHandle) * (numSlots + newSlots + 1));
+    SM_PageHandle *spare = malloc(sizeof(SM_PageHandle) * (spareLeft + 1));
+    int *newIndex = malloc(sizeof(int) * oldSize);
+    BufferPoolMgmt *next = calloc(1, sizeof(BufferPoolMgmt));
+    RC status = frames != NULL && slots != NULL && spare != NULL && newIndex != NULL && next != NULL ? RC_OK : RC_ERROR;
+    if (status == RC_OK) {
+        next->options = mgmt->options;
+        next->threadSafe = mgmt->threadSafe;
+        status = initPageTable(next, newNumPages);
+    }
+    if (status == RC_OK && bm->strategy == RS_LRU_K)
+        status = initLruK(next, newNumPages, &mgmt->lruK);
+    if (status == RC_OK && usesQueues(bm->strategy))
+        status = initQueues(next, bm->strategy, newNumPages);
+    if (status == RC_OK && newSlots > 0)
+        status = addArena(mgmt, newSlots);
+    if (status != RC_OK) {
+        if (next != NULL)
+            freeStructures(next);
+        free(frames);
+        free(slots);
+        free(spare);
+        free(newIndex);
+        free(next);
+        return RC_ERROR;
+    }
+
+    // The kept pages keep their data where it is, so the handles of pinned pages stay valid
+    int j = 0, k = 0;
+    for (int i = 0; i < oldSize; i++) {
+        if (keep[i]) {
+            newIndex[i] = j;
+            frames[j++] = old[i];
+        } else {
+            slots[k++] = old[i].data;
+        }
+    }
+    for (int s = 0; s < mgmt->numSpare; s++)
+        slots[k++] = mgmt->spareData[s];
+    for (int s = 0; s < newSlots; s++)
+        slots[k++] = mgmt->arenas[mgmt->numArenas - 1] + (size_t)s * mgmt->pageSize;
+    for (; j < newNumPages; j++)
+        frames[j] = (PageFrame){ slots[--k], NO_PAGE, NO_FILE, 0, 0, 0, 0, 0, RC_OK };
+    for (int s = 0; s < k; s++) {
+        releaseSlot(mgmt, slots[s]);
+        spare[s] = slots[s];
+    }
+    free(mgmt->spareData);
+    mgmt->spareData = spare;
+    mgmt->numSpare = k;
+
+    // The CLOCK hand stays on the frame it pointed to, or the next one kept
+    int hand = mgmt->clockPointer % oldSize;
+    mgmt->clockPointer = 0;
+    for (int i = 0; i < oldSize; i++)
+        if (keep[(hand + i) % oldSize]) {
+            mgmt->clockPointer = newIndex[(hand + i) % oldSize];
+            break;
+        }
+
+    swapStructures(mgmt, next);
+    mgmt->frames = frames;
+    mgmt->bufferSize = newNumPages;
+    mgmt->framesUsed = kept;
+    mgmt->writerPos = 0;
+    mgmt->arcTarget = (int)((long)mgmt->arcTarget * newNumPages / oldSize);
+    for (int i = 0; i < oldSize; i++)
+        if (keep[i])
+            insertPageTable(&partitionOf(mgmt, frameKey(mgmt, newIndex[i]))->table, frameKey(mgmt, newIndex[i]), newIndex[i]);
+
+    // The ghosts remembered so far, oldest first, then the evicted pages, coldest first
+    if (bm->strategy == RS_ARC || bm->strategy == RS_2Q) {
+        for (int g = 0; g < 2; g++)
+            for (int e = next->ghosts[g].tail; e != -1; e = next->ghostPrev[e])
+                if ((int)(next->ghostPage[e] >> 32) != dropFile)
+                    addGhost(mgmt, g, next->ghostPage[e]);
+        for (int r = n - 1; r >= 0; r--) {
+            int q = next->queueOf[hot[r]];
+            if (!keep[hot[r]] && q >= 0 && (bm->strategy == RS_ARC || q == 0) && old[hot[r]].fileId != dropFile)
+                addGhost(mgmt, q, pageKey(old[hot[r]].fileId, old[hot[r]].pageNum));
+        }
+        while (bm->strategy == RS_2Q && mgmt->ghosts[0].size > mgmt->outTarget)
+            dropOldestGhost(mgmt, 0);
+    }
+    for (int r = n - 1; r >= 0; r--) {
+        if (!keep[hot[r]]) continue;
+        int idx = newIndex[hot[r]];
+        if (bm->strategy == RS_LRU_K)
+            memcpy(frameHistory(mgmt, idx), &next->history[hot[r] * mgmt->lruK], sizeof(int) * mgmt->lruK);
+        else if (bm->strategy == RS_ARC || bm->strategy == RS_2Q)
+            queueFrame(mgmt, next->queueOf[hot[r]] >= 0 ? next->queueOf[hot[r]] : 0, idx);
+        else
+            admitFrame(bm, idx, frameKey(mgmt, idx));
+        if (bm->strategy == RS_LFU)
+            requeueFrame(bm, idx); // To the bucket of its pin count
+    }
+
+    // The hits counted in the old partitions
+    for (int p = 0; p < next->numPartitions; p++) {
+        COUNT_STAT(mgmt, hits, next->partitions[p].hits);
+        COUNT_STAT(mgmt, pinLatency[0], next->partitions[p].quickPins);
+    }
+
+    freeStructures(next);
+    free(next);
+    free(old);
+    free(slots);
+    free(newIndex);
+    return RC_OK;
+}
+
+// Gives a rebuild of the frames, or a change of the files, the pool to itself: stops the background
+// writer, takes the victim latch and completes the prefetch reads, whose completions point into the
+// frames and whose reads into the files
+static void pausePool(BM_BufferPool *const bm)
+{
+    BufferPoolMgmt *mgmt = (BufferPoolMgmt *)bm->mgmtData;
+
+    stopWriter(mgmt);
+    latchVictim(mgmt);
+    while (mgmt->hasReadQueue && mgmt->readQueue.inFlight > 0)
+        completeReads(bm, 1);
+}
+
+// Lets go of a pool pausePool paused and starts its writer again, which sizes its watermarks from
+// the frames it finds
+static RC resumePool(BufferPoolMgmt *mgmt)
+{
+    RC status = startWriter(mgmt);
+    unlatchVictim(mgmt);
+    return status;
+}
 
-    if (pageFrame[leastFreqIndex].data != NULL) {
-    free(pageFrame[leastFreqIndex].data);
-    pageFrame[leastFreqIndex].data = NULL; // Evitar punteros colgantes
+// Rebuilds the frames of a paused pool without the pages of file fileId
+static RC dropFilePages(BM_BufferPool *const bm, int fileId)
+{
+    BufferPoolMgmt *mgmt = (BufferPoolMgmt *)bm->mgmtData;
+    int *hot = malloc(sizeof(int) * mgmt->bufferSize);
+    bool *keep = calloc(mgmt->bufferSize, sizeof(bool));
+    RC status = RC_ERROR;
+
+    if (hot != NULL && keep != NULL) {
+        int n = hottestFrames(bm, hot);
+        for (int r = 0; r < n; r++)
+            keep[hot[r]] = mgmt->frames[hot[r]].fileId != fileId;
+        status = rebuildFrames(bm, mgmt->bufferSize, hot, n, keep, fileId);
     }
-
-    setNewPageToPageFrame(pageFrame, page, leastFreqIndex); // Set new page to the least frequently used page frame
-    lfuPointer = (leastFreqIndex + 1) % bufferSize; // Update the LFU pointer for next use
+    free(hot);
+    free(keep);
+    return status;
 }
 
-// Implementation of Least Recently Used (LRU) page replacement algorithm
-void LRU(BM_BufferPool *const bm, PageFrame *page) {
-    PageFrame *pageFrame = (PageFrame *)bm->mgmtData;
-    int leastHitIndex = -1, leastHitNum = INT_MAX; // Initialize with maximum possible values
-
-    // Loop through the buffer pool to find the least recently used page frame
-    for (int i = 0; i < bufferSize; i++) {
-        if (pageFrame[i].fixCount == 0 && pageFrame[i].hitNum < leastHitNum) { // Page frame is not in use and has the least hit number
-            leastHitIndex = i; // Update the least recently used index
-            leastHitNum = pageFrame[i].hitNum; // Update the least hit number
-        }
+// Grows or shrinks a live pool to newNumPages frames. Growing leaves the resident pages where they
+// are. Shrinking keeps the pinned pages and as many of the others as fit, hottest first by the pool's
+// strategy; the pages that leave are written back if dirty. Page handles of pinned pages stay valid.
+// No other client may use the pool meanwhile; its background writer is paused and its prefetch
+// reads completed. Called on a file of a shared pool it resizes the shared pool.
+RC resizeBufferPool(BM_BufferPool *const bm, int newNumPages)
+{
+    if (bm == NULL || bm->mgmtData == NULL || newNumPages < 1) {
+        return RC_ERROR;
+    }
+    BufferPoolMgmt *mgmt = (BufferPoolMgmt *)bm->mgmtData;
+    if (newNumPages == mgmt->bufferSize) {
+        return RC_OK;
     }
 
-    // Replace the least recently used page frame if found
-    if (leastHitIndex != -1) {
-        if (pageFrame[leastHitIndex].dirtyBit == 1) {
-            writeBlockToDisk(bm, pageFrame, leastHitIndex); // Write modified page back to disk
+    int *hot = malloc(sizeof(int) * mgmt->bufferSize);
+    bool *keep = calloc(mgmt->bufferSize, sizeof(bool));
+    if (hot == NULL || keep == NULL) {
+        free(hot);
+        free(keep);
+        return RC_ERROR;
+    }
+    pausePool(bm);
+
+    // Keeping the pinned pages, and the hottest of the others that fit beside them
+    int n = hottestFrames(bm, hot), room = newNumPages, resident = 0;
+    for (int i = 0; i < mgmt->framesUsed; i++)
+        resident += mgmt->frames[i].pageNum != NO_PAGE;
+    for (int r = 0; r < n; r++)
+        if (mgmt->frames[hot[r]].fixCount > 0) {
+            keep[hot[r]] = true;
+            room--;
         }
-
-        // Libera la memoria de la página actual antes de reemplazarla
-        if (pageFrame[leastHitIndex].data != NULL) {
-        free(pageFrame[leastHitIndex].data);
-        pageFrame[leastHitIndex].data = NULL; // Evitar punteros colgantes
+    RC status = n < resident ? RC_ERROR : room >= 0 ? RC_OK : RC_BUFFER_POOL_FULL;
+    for (int r = 0; r < n && room > 0; r++)
+        if (!keep[hot[r]]) {
+            keep[hot[r]] = true;
+            room--;
         }
-        setNewPageToPageFrame(pageFrame, page, leastHitIndex); // Set new page to the least recently used page frame
-    }
-}
-
-// Implementation of CLOCK page replacement algorithm
-void CLOCK(BM_BufferPool *const bm, PageFrame *page) {
-    PageFrame *pageFrame = (PageFrame *)bm->mgmtData;
-
-    // Continuously loop until a suitable page frame is found
-    while (true) {
-        if (pageFrame[clockPointer].fixCount == 0) { // Check if the current page frame is not in use
-            if (pageFrame[clockPointer].dirtyBit == 1) { // Check if the page has been modified
-                writeBlockToDisk(bm, pageFrame, clockPointer); // Write modified page back to disk
-            }
-
-            // Libera la memoria de la página actual antes de reemplazarla
-            if (pageFrame[clockPointer].data != NULL) {
-                free(pageFrame[clockPointer].data);
-                pageFrame[clockPointer].data = NULL; // Evitar punteros colgantes
-            }
 
-            setNewPageToPageFrame(pageFrame, page, clockPointer); // Set new page to the current page frame
-            clockPointer = (clockPointer + 1) % bufferSize; // Move the clock pointer to the next page frame
-            break; // Exit the loop after setting the new page
+    // Writing back the dirty pages that leave; after a failed write every page stays
+    for (int r = 0; r < n && status == RC_OK; r++) {
+        if (keep[hot[r]] || !cleanFrame(mgmt, hot[r]))
+            continue;
+        if (!writeBlockToDisk(bm, mgmt->frames, hot[r])) {
+            dirtyFrame(mgmt, hot[r]);
+            status = RC_WRITE_FAILED;
         } else {
-            pageFrame[clockPointer].hitNum = 0; // Reset the hit number for the current page frame
-            clockPointer = (clockPointer + 1) % bufferSize; // Move to the next page frame
+            COUNT_STAT(mgmt, evictionWrites, 1);
         }
     }
+    if (status == RC_OK)
+        status = rebuildFrames(bm, newNumPages, hot, n, keep, NO_FILE);
+    if (status == RC_OK)
+        COUNT_STAT(mgmt, evictions, n - (newNumPages - room)); // The pages that left
+    if (status == RC_OK)
+        bm->numPages = mgmt->owner->numPages = newNumPages;
+
+    RC resumed = resumePool(mgmt);
+    free(hot);
+    free(keep);
+    return status == RC_OK ? resumed : status;
 }
 
-PageFrame *newPage;
-PageFrame *page;
-
 
 // BUFFER POOL FUNCTIONS //
 /*
@@ -188,37 +2055,362 @@ PageFrame *page;
 RC initBufferPool(BM_BufferPool *const bm, const char *const pageFileName,
                          const int numPages, ReplacementStrategy strategy,
                          void *stratData)
-{   // Assign the page file, number of pages, and strategy to the buffer pool
-    bm->pageFile = (char *)pageFileName;
+{
+    // A plain buffer pool uses the default options
+    return initBufferPoolWithOptions(bm, pageFileName, numPages, strategy, stratData, NULL);
+}
+
+// Opens a page file for a pool, the way its options ask for
+static RC openPoolFile(const char *pageFileName, const BM_PoolOptions *options, SM_FileHandle *fileHandle)
+{
+    RC status = options->directIO ? openPageFileDirect((char *)pageFileName, fileHandle)
+                                  : openPageFile((char *)pageFileName, fileHandle);
+    // The pool is the cache and prefetches on its own; a second readahead below it only
+    // copies pages that are never asked for
+    if (status != RC_OK)
+        return status;
+    status = setReadAheadWindow(0, fileHandle);
+    if (status != RC_OK)
+        closePageFile(fileHandle);
+    return status;
+}
+
+// Releases the frames, arenas and strategy structures of a pool and its control block; the files
+// must be closed already
+static void freePool(BM_BufferPool *const bm)
+{
+    BufferPoolMgmt *mgmt = (BufferPoolMgmt *)bm->mgmtData;
+
+    free(mgmt->frames);
+    freeArenas(mgmt);
+    freePageTable(mgmt);
+    freeLruK(mgmt);
+    if (usesQueues(bm->strategy))
+        freeQueues(mgmt);
+    pthread_mutex_destroy(&mgmt->victimLatch);
+    pthread_mutex_destroy(&mgmt->listLatch);
+    pthread_mutex_destroy(&mgmt->ioLatch);
+    pthread_mutex_destroy(&mgmt->writerLock);
+    pthread_cond_destroy(&mgmt->writerWake);
+    pthread_mutex_destroy(&mgmt->statsLatch);
+    free(mgmt->files);
+    free(mgmt);
+    bm->mgmtData = NULL; // To avoid dangling pointer
+}
+
+// Creates the frames of a pool of numPages frames of pageSize bytes and its bookkeeping, without any
+// file or background writer yet
+static RC initPool(BM_BufferPool *const bm, int numPages, int pageSize, ReplacementStrategy strategy,
+                   void *stratData, const BM_PoolOptions *options)
+{
+    // Assign the number of pages and strategy to the buffer pool; it has no file of its own yet
+    bm->pageFile = NULL;
     bm->numPages = numPages;
     bm->strategy = strategy;
-    bufferSize = numPages;
+    bm->mgmtData = NULL;
+    bm->fileId = NO_FILE;
+    if (numPages < 1 || pageSize < 1) {
+        return RC_ERROR;
+    }
 
-    // Allocate memory for page frames in the buffer pool
+    // Allocate memory for the pool's control block and its page frames
     PageFrame *pageFrames = malloc(sizeof(PageFrame) * numPages);
+    BufferPoolMgmt *mgmt = calloc(1, sizeof(BufferPoolMgmt));
+
     // Check if memory allocation was successful
-    if (pageFrames == NULL) return RC_ERROR;
+    if (pageFrames == NULL || mgmt == NULL) {
+        free(pageFrames);
+        free(mgmt);
+        return RC_ERROR;
+    }
+
+    // Remember the options, falling back to the defaults
+    if (options != NULL)
+        mgmt->options = *options;
+    else
+        initPoolOptions(&mgmt->options);
+    mgmt->threadSafe = mgmt->options.threadSafe || mgmt->options.backgroundWriter; // The writer runs alongside the clients
+
+    // The background writer cleans down to its low watermark from its high one
+    if (mgmt->options.backgroundWriter && (mgmt->options.writerLowWatermark < 0
+        || mgmt->options.writerLowWatermark >= mgmt->options.writerHighWatermark || mgmt->options.writerHighWatermark > 100)) {
+        free(pageFrames);
+        free(mgmt);
+        return RC_ERROR;
+    }
+
+    mgmt->pageSize = pageSize; // Frames are as large as the files' pages
+    RC status;
+    if ((status = addArena(mgmt, numPages)) != RC_OK) {
+        freeArenas(mgmt);
+    }
+    else if ((status = initPageTable(mgmt, numPages)) != RC_OK) {
+        freeArenas(mgmt);
+    }
+    else if (strategy == RS_LRU_K && (status = initLruK(mgmt, numPages, stratData)) != RC_OK) {
+        freeLruK(mgmt);
+        freePageTable(mgmt);
+        freeArenas(mgmt);
+    }
+    else if (usesQueues(strategy) && (status = initQueues(mgmt, strategy, numPages)) != RC_OK) {
+        freeQueues(mgmt);
+        freePageTable(mgmt);
+        freeArenas(mgmt);
+    }
+    if (status != RC_OK) {
+        free(pageFrames);
+        free(mgmt);
+        return status;
+    }
+    pthread_mutex_init(&mgmt->victimLatch, NULL);
+    pthread_mutex_init(&mgmt->listLatch, NULL);
+    pthread_mutex_init(&mgmt->ioLatch, NULL);
+    pthread_mutex_init(&mgmt->writerLock, NULL);
+    pthread_cond_init(&mgmt->writerWake, NULL);
+    pthread_mutex_init(&mgmt->statsLatch, NULL);
+    mgmt->bufferSize = numPages;
 
     // Initialize all page frames in the buffer pool
-    for (int i = 0; i < bufferSize; i++)
+    for (int i = 0; i < mgmt->bufferSize; i++)
     {
         PageFrame *currentPageFrame = &pageFrames[i];
-        currentPageFrame->data = NULL;
+        currentPageFrame->data = mgmt->arenas[0] + (size_t)i * mgmt->pageSize;
         currentPageFrame->pageNum = -1;
+        currentPageFrame->fileId = NO_FILE;
         currentPageFrame->dirtyBit = 0;
         currentPageFrame->fixCount = 0;
         currentPageFrame->hitNum = 0;        // Reset hit number for replacement strategy
         currentPageFrame->refNum = 0;        // Reset reference number for replacement strategy
+        currentPageFrame->readPending = 0;
+        currentPageFrame->readError = RC_OK;
     
     }
     // Set the management data for the buffer pool
-    bm->mgmtData = pageFrames;
-    // Reset counters and pointers used in replacement strategies
-    totalDiskWriteCount = clockPointer = lfuPointer = 0;
+    mgmt->frames = pageFrames;
+    mgmt->framesUsed = 0;
+    mgmt->owner = bm;
+    bm->mgmtData = mgmt; // Counters and pointers used in replacement strategies start at zero
+    return RC_OK;
+}
+
+// Gives an open page file a number in the pool, reusing the slot of a detached file if there is one;
+// returns NO_FILE if the files cannot grow. Called with the I/O latch held, the files may move.
+static int addFile(BufferPoolMgmt *mgmt, const SM_FileHandle *fileHandle)
+{
+    int fileId = 0;
+    while (fileId < mgmt->numFiles && mgmt->files[fileId].attached)
+        fileId++;
+    if (fileId == mgmt->numFiles) {
+        PoolFile *files = realloc(mgmt->files, sizeof(PoolFile) * (mgmt->numFiles + 1));
+        if (files == NULL) return NO_FILE;
+        mgmt->files = files;
+        mgmt->numFiles++;
+    }
+    mgmt->files[fileId].fileHandle = *fileHandle;
+    mgmt->files[fileId].attached = true;
+    return fileId;
+}
+
+// Same as initBufferPool, with options for how the pool does its I/O (NULL for the defaults)
+RC initBufferPoolWithOptions(BM_BufferPool *const bm, const char *const pageFileName,
+                         const int numPages, ReplacementStrategy strategy,
+                         void *stratData, const BM_PoolOptions *options)
+{
+    BM_PoolOptions defaults;
+    SM_FileHandle fileHandle;
+
+    if (options == NULL) {
+        initPoolOptions(&defaults);
+        options = &defaults;
+    }
+    bm->mgmtData = NULL;
+
+    // Opening the page file once for the lifetime of the pool; frames are as large as its pages
+    RC status = openPoolFile(pageFileName, options, &fileHandle);
+    if (status != RC_OK)
+        return status;
+    status = initPool(bm, numPages, getPageSize(&fileHandle), strategy, stratData, options);
+    if (status != RC_OK) {
+        closePageFile(&fileHandle);
+        return status;
+    }
+    BufferPoolMgmt *mgmt = (BufferPoolMgmt *)bm->mgmtData;
+    bm->fileId = addFile(mgmt, &fileHandle);
+    if (bm->fileId == NO_FILE) {
+        closePageFile(&fileHandle);
+        freePool(bm);
+        return RC_ERROR;
+    }
+    bm->pageFile = (char *)pageFileName;
+
+    // Reading the pages the pool held when it was last shut down
+    if (mgmt->options.warmStart)
+        loadManifest(bm);
+
+    if (startWriter(mgmt) != RC_OK) {
+        shutdownBufferPool(bm);
+        return RC_ERROR;
+    }
+    return RC_OK;
+}
+
+// Creates a pool of numPages frames of pageSize bytes that the page files attached to it with
+// attachBufferPool share
+RC initSharedBufferPool(BM_BufferPool *const bm, const int numPages, const int pageSize,
+                        ReplacementStrategy strategy, void *stratData, const BM_PoolOptions *options)
+{
+    RC status = initPool(bm, numPages, pageSize, strategy, stratData, options);
+    if (status != RC_OK)
+        return status;
+    ((BufferPoolMgmt *)bm->mgmtData)->shared = true;
+    if (startWriter(bm->mgmtData) != RC_OK) {
+        shutdownBufferPool(bm);
+        return RC_ERROR;
+    }
+    return RC_OK;
+}
+
+// Opens page file pageFileName in shared pool shared and sets bm up as its handle. The file's pages
+// compete with those of the other files for all of the shared pool's frames.
+RC attachBufferPool(BM_BufferPool *const bm, BM_BufferPool *const shared, const char *const pageFileName)
+{
+    if (bm == NULL || shared == NULL || shared->mgmtData == NULL) {
+        return RC_ERROR;
+    }
+    BufferPoolMgmt *mgmt = (BufferPoolMgmt *)shared->mgmtData;
+    if (!mgmt->shared || shared->fileId != NO_FILE) {
+        return RC_ERROR; // Not a shared pool, or a file's handle
+    }
+
+    SM_FileHandle fileHandle;
+    RC status = openPoolFile(pageFileName, &mgmt->options, &fileHandle);
+    if (status != RC_OK)
+        return status;
+    if (getPageSize(&fileHandle) != mgmt->pageSize) {
+        closePageFile(&fileHandle);
+        return RC_INVALID_PAGE_SIZE;
+    }
+
+    // Misses of the other files read through the files under the victim latch, the writer under the I/O one
+    latchVictim(mgmt);
+    latchIO(mgmt);
+    int fileId = addFile(mgmt, &fileHandle);
+    unlatchIO(mgmt);
+    if (fileId == NO_FILE) {
+        unlatchVictim(mgmt);
+        closePageFile(&fileHandle);
+        return RC_ERROR;
+    }
+    bm->pageFile = (char *)pageFileName;
+    bm->numPages = mgmt->bufferSize;
+    bm->strategy = shared->strategy;
+    bm->mgmtData = mgmt;
+    bm->fileId = fileId;
+
+    // Reading the pages the file had when it was last detached, into the frames no file uses
+    if (mgmt->options.warmStart)
+        loadManifest(bm);
+    unlatchVictim(mgmt);
     return RC_OK;
 }
 
+// Writes back the dirty pages no client has pinned, of every file of the pool, or only bm's one if
+// bm is the handle of a file of a shared pool. Called with the victim latch held, so no frame changes
+// page meanwhile.
+static RC flushFrames(BM_BufferPool *const bm)
+{
+	BufferPoolMgmt *mgmt = (BufferPoolMgmt *)bm->mgmtData;
+	PageFrame *pageFrame = mgmt->frames;
+	DirtyFrame *dirty = malloc(sizeof(DirtyFrame) * mgmt->bufferSize);
+	SM_PageHandle *run = malloc(sizeof(SM_PageHandle) * mgmt->bufferSize);
+	RC status = RC_OK;
+	int i, numDirty = 0;
+
+	if (dirty == NULL || run == NULL) {
+		free(dirty);
+		free(run);
+		return RC_ERROR;
+	}
+
+	// Collecting the dirty pages (modified pages) no client has pinned
+	for (i = 0; i < mgmt->bufferSize; i++)
+	{
+		if (__atomic_load_n(&pageFrame[i].fixCount, __ATOMIC_ACQUIRE) == 0 && __atomic_load_n(&pageFrame[i].dirtyBit, __ATOMIC_ACQUIRE) == 1
+			&& (bm->fileId == NO_FILE || pageFrame[i].fileId == bm->fileId))
+		{
+			dirty[numDirty].pageNum = pageFrame[i].pageNum;
+			dirty[numDirty].fileId = pageFrame[i].fileId;
+			dirty[numDirty].frameIndex = i;
+			numDirty++;
+		}
+	}
+
+	// Writing them in file order, each run of consecutive pages with one vectored write. Dirty bits
+	// are cleared before the write, so a client pinning and changing a page meanwhile marks it dirty
+	// again and its change is not lost.
+	qsort(dirty, numDirty, sizeof(DirtyFrame), compareDirtyFrames);
+	for (i = 0; i < numDirty && status == RC_OK; )
+	{
+		int length = 0;
+		do {
+			cleanFrame(mgmt, dirty[i + length].frameIndex);
+			run[length] = pageFrame[dirty[i + length].frameIndex].data;
+			length++;
+		} while (i + length < numDirty && followsDirtyFrame(&dirty[i + length - 1], &dirty[i + length]));
+
+		latchIO(mgmt);
+		status = writeBlocks(dirty[i].pageNum, length, fileOf(mgmt, dirty[i].fileId), run);
+		unlatchIO(mgmt);
+		if (status == RC_OK)
+		{
+			// Count the pages in totalDiskWriteCount, the number of pages written by the buffer manager.
+			__atomic_add_fetch(&mgmt->totalDiskWriteCount, length, __ATOMIC_RELAXED);
+			COUNT_STAT(mgmt, flushWrites, length);
+		}
+		else
+		{
+			for (int k = i; k < i + length; k++)
+				dirtyFrame(mgmt, dirty[k].frameIndex); // Still to be written
+		}
+		i += length;
+	}
+
+	free(dirty);
+	free(run);
+	return status == RC_OK ? RC_OK : RC_WRITE_FAILED;
+}
+
+// Detaches the file of handle bm from its shared pool: writes back its dirty pages, saves its warm
+// start manifest, drops its pages from the frames and closes it
+static RC detachBufferPool(BM_BufferPool *const bm)
+{
+    BufferPoolMgmt *mgmt = (BufferPoolMgmt *)bm->mgmtData;
+
+    pausePool(bm);
+    RC status = flushFrames(bm);
+    if (status == RC_OK && mgmt->options.warmStart)
+        status = saveManifest(bm);
+
+    // Without the memory to rebuild the frames the file has to stay, its pages pointing into it
+    if (dropFilePages(bm, bm->fileId) != RC_OK) {
+        resumePool(mgmt);
+        return RC_ERROR;
+    }
+    latchIO(mgmt);
+    RC closeStatus = closePageFile(fileOf(mgmt, bm->fileId));
+    mgmt->files[bm->fileId].attached = false;
+    unlatchIO(mgmt);
+    if (status == RC_OK)
+        status = closeStatus;
+
+    RC resumed = resumePool(mgmt);
+    bm->mgmtData = NULL;
+    return status == RC_OK ? resumed : status;
+}
+
 // Shutdown i.e. close the buffer pool, thereby removing all the pages from the memory and freeing up all resources and releasing some memory space.
+// On the handle of a file of a shared pool it only detaches that file; shutting the shared pool
+// itself down closes the files still attached, whose handles are then unusable.
 RC shutdownBufferPool(BM_BufferPool *const bm) {
     
     // Check if buffer pool is initialized
@@ -226,40 +2418,34 @@ RC shutdownBufferPool(BM_BufferPool *const bm) {
         return RC_ERROR;
     }
 
-    PageFrame *pageFrame = (PageFrame *)bm->mgmtData;
+    BufferPoolMgmt *mgmt = (BufferPoolMgmt *)bm->mgmtData;
+    if (mgmt->shared && bm->fileId != NO_FILE)
+        return detachBufferPool(bm);
+
+    // Letting the background writer and prefetch reads finish before their frames go away
+    stopWriter(mgmt);
+    freeReadQueue(bm);
     // Write all dirty pages (modified pages) back to disk
-    RC status = forceFlushPool(bm);
-
-    // Handle potential errors during flushing
-    if(status != RC_OK) {
-        free(pageFrame);
-        free(newPage);
-        bm->mgmtData = NULL;
-        // If flushing fails, return the error status
-        return status;
+    RC status = flushFrames(bm);
+
+    // Saving the resident pages of each file for the next warm start; if flushing failed, returning its error
+    for (int f = 0; f < mgmt->numFiles && status == RC_OK && mgmt->options.warmStart; f++) {
+        if (!mgmt->files[f].attached) continue;
+        BM_BufferPool file = *bm;
+        file.pageFile = mgmt->files[f].fileHandle.fileName;
+        file.fileId = f;
+        status = saveManifest(&file);
     }
 
-    int i = 0 ;
-    // Free allocated memory for each page frame
-    while (i < bufferSize){
-        // Free the data for each page before freeing the pageFrame itself
-        if (pageFrame[i].data != NULL) {
-            free(pageFrame[i].data);
-            pageFrame[i].data = NULL; // To avoid dangling pointer
-        }
-         i++;
+    // Closing the page files and releasing space occupied by the frames, their arenas and the page table
+    for (int f = 0; f < mgmt->numFiles; f++) {
+        if (!mgmt->files[f].attached) continue;
+        RC closeStatus = closePageFile(&mgmt->files[f].fileHandle);
+        if (status == RC_OK)
+            status = closeStatus;
     }
-
-    // Releasing space occupied by the pageFrame
-    free(pageFrame);
-     // Luego liberamos la estructura de la página en sí
-    free(newPage);
-    newPage = NULL; // Evitamos un puntero colgante
-
-
-	//free(page);
-    bm->mgmtData = NULL; // To avoid dangling pointer
-    return RC_OK;
+    freePool(bm);
+    return status;
 }
 
 
@@ -267,40 +2453,16 @@ RC shutdownBufferPool(BM_BufferPool *const bm) {
 RC forceFlushPool(BM_BufferPool *const bm)
 {
     // Check if the buffer pool is initialized
-	if (bm == NULL) {
+	if (bm == NULL || bm->mgmtData == NULL) {
 			// If the buffer pool pointer is NULL, the buffer pool is not initialized
 			return RC_FILE_HANDLE_NOT_INIT;
 		}
 
-	PageFrame *pageFrame = (PageFrame *)bm->mgmtData;
-    
-    // Check if the page frame is initialized
-	if (pageFrame == NULL) {
-        return RC_FILE_HANDLE_NOT_INIT;
-    }
-
-	int i;
-	RC rc;
-	// Store all dirty pages (modified pages) in memory to page file on disk
-	for (i = 0; i < bufferSize; i++)
-	{
-		if (pageFrame[i].fixCount == 0 && pageFrame[i].dirtyBit == 1)
-		{
-			SM_FileHandle fh;
-			// Opening page file available on disk
-			rc = openPageFile(bm->pageFile, &fh);
-			if (rc != RC_OK) {
-                return rc; // Return the error code if opening the file fails
-            }
-			// Writing block of data to the page file on disk
-			writeBlock(pageFrame[i].pageNum, &fh, pageFrame[i].data);
-			// Mark the page not dirty.
-			pageFrame[i].dirtyBit = 0;
-			// Increase the totalDiskWriteCount which records the number of writes done by the buffer manager.
-			totalDiskWriteCount++;
-		}
-	}
-	return RC_OK;
+	BufferPoolMgmt *mgmt = (BufferPoolMgmt *)bm->mgmtData;
+	latchVictim(mgmt);
+	RC status = flushFrames(bm);
+	unlatchVictim(mgmt);
+	return status;
 }
 
 
@@ -315,18 +2477,20 @@ RC markDirty(BM_BufferPool *const bm, BM_PageHandle *const page) {
         return RC_ERROR; // Error code for uninitialized structures
     }
 
-    PageFrame *pageFrames = (PageFrame *)bm->mgmtData;
+    BufferPoolMgmt *mgmt = (BufferPoolMgmt *)bm->mgmtData;
+    PageKey key = pageKey(bm->fileId, page->pageNum);
+    PageTablePartition *part = partitionOf(mgmt, key);
 
     // Find the page with the given page number and mark it as dirty
-    for (int i = 0; i < bm->numPages; ++i) {
-        if (pageFrames[i].pageNum == page->pageNum) {
-            pageFrames[i].dirtyBit = 1;
-            return RC_OK;
-        }
+    latchPartition(mgmt, part);
+    int i = lookupFrame(&part->table, key);
+    if (i >= 0)
+        dirtyFrame(mgmt, i);
+    unlatchPartition(mgmt, part);
+    if (i < 0) {
+        return RC_ERROR; // Error code for page not found in buffer
     }
-
-    // If the page is not found, return an error
-    return RC_ERROR; // Error code for page not found in buffer
+    return RC_OK;
 }
 
 
@@ -339,22 +2503,23 @@ RC unpinPage(BM_BufferPool *const bm, BM_PageHandle *const page) {
         return RC_ERROR; // Error code for invalid input
     }
 
-    PageFrame *pageFrames = (PageFrame *)bm->mgmtData;
-    bool pageFound = false;
+    BufferPoolMgmt *mgmt = (BufferPoolMgmt *)bm->mgmtData;
+    PageFrame *pageFrames = mgmt->frames;
+    PageKey key = pageKey(bm->fileId, page->pageNum);
+    PageTablePartition *part = partitionOf(mgmt, key);
 
-    // Iterate through the buffer pool to find and unpin the page
-    for (int i = 0; i < bm->numPages; i++) { // Using bm->numPages for the loop
-        if (pageFrames[i].pageNum == page->pageNum) {
-            if (pageFrames[i].fixCount > 0) {
-                pageFrames[i].fixCount--;
-            }
-            pageFound = true;
-            break;// Exit loop once page is found and unpinned
-        }
+    // Look the page up in the page table and unpin it
+    latchPartition(mgmt, part);
+    int i = lookupFrame(&part->table, key);
+    if (i >= 0 && __atomic_load_n(&pageFrames[i].fixCount, __ATOMIC_RELAXED) > 0) {
+        __atomic_sub_fetch(&pageFrames[i].fixCount, 1, __ATOMIC_RELEASE);
     }
-    
-     // Return appropriate status based on whether the page was found
-    return pageFound ? RC_OK : RC_ERROR; // Return RC_PAGE_NOT_FOUND if page is not found in the buffer
+    unlatchPartition(mgmt, part);
+    if (i < 0) {
+        return RC_ERROR; // Page is not found in the buffer
+    }
+    syncFrame(bm, i); // An unpinned frame becomes a candidate victim again
+    return RC_OK;
 }
 
 
@@ -365,198 +2530,442 @@ RC forcePage(BM_BufferPool *const bm, BM_PageHandle *const page) {
         return RC_ERROR; // Error code for invalid inputs
     }
 
-    PageFrame *pageFrames = (PageFrame *)bm->mgmtData;
-    SM_FileHandle fileHandle;
-    bool pageWritten = false;
-
-   // Iterate through the buffer pool to find the page
-    int i = 0;
-    while (i < bm->numPages) {
-        if (pageFrames[i].pageNum == page->pageNum) {
-            // Open the page file
-            if (openPageFile(bm->pageFile, &fileHandle) != RC_OK) {
-                return RC_FILE_NOT_FOUND; // Error handling for file opening
-            }
-            
-
-            // Write the page back to disk
-            if (writeBlock(pageFrames[i].pageNum, &fileHandle, pageFrames[i].data) != RC_OK) {
-                return RC_WRITE_FAILED; // Error handling for writing to disk
-            }
-
-            pageFrames[i].dirtyBit = 0; // Clear the dirty bit after writing
-            pageWritten = true;
-            break; // Exiting loop after writing the page
+    BufferPoolMgmt *mgmt = (BufferPoolMgmt *)bm->mgmtData;
+    PageFrame *pageFrames = mgmt->frames;
+
+    PageKey key = pageKey(bm->fileId, page->pageNum);
+    PageTablePartition *part = partitionOf(mgmt, key);
+
+    // Look the page up in the page table; holding the victim latch keeps it in its frame
+    latchVictim(mgmt);
+    latchPartition(mgmt, part);
+    int i = lookupFrame(&part->table, key);
+    unlatchPartition(mgmt, part);
+    if (i >= 0) {
+        // A prefetched page is not there until its read is done, and is gone if the read failed
+        while (__atomic_load_n(&pageFrames[i].readPending, __ATOMIC_ACQUIRE) != 0)
+            completeReads(bm, 1);
+        if (pageFrames[i].readError != RC_OK) {
+            unlatchVictim(mgmt);
+            return RC_ERROR;
         }
-        i++;
-    }
 
-    // Finalize the operation
-    if (pageWritten) {
-        totalDiskWriteCount++; // Incrementing the disk write count
-        return RC_OK;
+        // Write the page back to disk if it was modified; the dirty bit is cleared first, so a client
+        // changing the page during the write marks it dirty again
+        if (!cleanFrame(mgmt, i)) {
+            unlatchVictim(mgmt);
+            return RC_OK; // The page on disk is up to date
+        }
+        latchIO(mgmt);
+        RC writeStatus = writeBlock(pageFrames[i].pageNum, fileOf(mgmt, bm->fileId), pageFrames[i].data);
+        unlatchIO(mgmt);
+        if (writeStatus != RC_OK) {
+            dirtyFrame(mgmt, i); // Still to be written
+        }
+        if (writeStatus == RC_OK) {
+            __atomic_add_fetch(&mgmt->totalDiskWriteCount, 1, __ATOMIC_RELAXED); // Incrementing the disk write count
+            COUNT_STAT(mgmt, flushWrites, 1);
+        }
+        unlatchVictim(mgmt);
+        return writeStatus == RC_OK ? RC_OK : RC_WRITE_FAILED; // Error handling for writing to disk
     }
 
+    unlatchVictim(mgmt);
     return RC_ERROR; // Return error if page not found
 }
 
+// Pins the page found in frame i for one more client. Called with the page's partition latch
+// held, which keeps the frame from being claimed while its fix count is raised.
+static void pinFrame(BM_BufferPool *const bm, BM_PageHandle *const page, int i)
+{
+    BufferPoolMgmt *mgmt = (BufferPoolMgmt *)bm->mgmtData;
+    PageFrame *pageFrame = mgmt->frames;
+
+    // Increase fixCount as another client is accessing this page
+    __atomic_add_fetch(&pageFrame[i].fixCount, 1, __ATOMIC_ACQUIRE);
+
+    // Update replacement strategy specific counters; the strategies with queues move the frame once
+    // it is unpinned, see syncFrame
+    if (bm->strategy == RS_LFU)
+        __atomic_add_fetch(&pageFrame[i].refNum, 1, __ATOMIC_RELAXED);
+    else if (bm->strategy == RS_LRU_K)
+        recordReference(mgmt, i);
+    if (bm->strategy == RS_CLOCK || usesQueues(bm->strategy))
+        FRAME_STORE(pageFrame[i].hitNum, 1);
+
+    // Set the page handle to the found page
+    page->pageNum = pageFrame[i].pageNum;
+    page->data = pageFrame[i].data;
+    if (!mgmt->threadSafe)
+        mgmt->clockPointer++; // Increment the clock pointer for CLOCK strategy; under the victim latch only when thread-safe
+}
+
 // This function pins a page with page number pageNum i.e. adds the page with page number pageNum to the buffer pool.
 // If the buffer pool is full, then it uses appropriate page replacement strategy to replace a page in memory with the new page being pinned.
+// In a thread-safe pool hits only take the page's partition latch; misses are loaded under the victim latch.
 
 RC pinPage(BM_BufferPool *const bm, BM_PageHandle *const page, const PageNumber pageNum) {
-    PageFrame *pageFrame = (PageFrame *)bm->mgmtData;
-
-    // Handling the case where the buffer pool is empty
-    if (pageFrame[0].pageNum == -1) {
-        // Check if buffer pool is empty and this is the first page to be pinned
-        // Read page from disk and initialize page frame's content in the buffer pool
-        SM_FileHandle fh;
-        openPageFile(bm->pageFile, &fh); // Open the page file corresponding to the buffer pool
-
-        pageFrame[0].data = (SM_PageHandle)malloc(PAGE_SIZE); // Allocate memory for the page's content
-        readBlock(pageNum, &fh, pageFrame[0].data);
-
-        pageFrame[0].pageNum = pageNum; // Set the page number and increment fix count
-        pageFrame[0].fixCount++;
-        numPagesReadCount = hit = 0;
-        pageFrame[0].hitNum = hit;
-        
-        pageFrame[0].refNum = 0; // Initialize the reference number for the page frame
-
-        page->pageNum = pageNum;  // Set the page handle's properties to reflect the pinned page
-        page->data = pageFrame[0].data;
+    return pinPageWithStrategy(bm, page, pageNum, NULL);
+}
+
+// Sets up an access strategy recycling ringSize frames of pool bm
+RC initAccessStrategy(BM_AccessStrategy *strategy, BM_BufferPool *const bm, int ringSize)
+{
+    if (strategy == NULL || bm == NULL || bm->mgmtData == NULL || ringSize < 1) {
+        return RC_ERROR;
+    }
+
+    AccessRing *ring = malloc(sizeof(AccessRing));
+    if (ring == NULL) return RC_ERROR;
+    ring->frames = malloc(sizeof(int) * ringSize);
+    ring->pages = malloc(sizeof(PageNumber) * ringSize);
+    if (ring->frames == NULL || ring->pages == NULL) {
+        free(ring->frames);
+        free(ring->pages);
+        free(ring);
+        return RC_ERROR;
+    }
+    for (int i = 0; i < ringSize; i++) {
+        ring->frames[i] = -1;
+        ring->pages[i] = NO_PAGE;
+    }
+    ring->bm = bm;
+    ring->next = 0;
+
+    strategy->ringSize = ringSize;
+    strategy->mgmtData = ring;
+    return RC_OK;
+}
+
+// Releases an access strategy; the pages it read stay in the pool
+RC freeAccessStrategy(BM_AccessStrategy *strategy)
+{
+    if (strategy == NULL || strategy->mgmtData == NULL) {
+        return RC_ERROR;
+    }
+
+    AccessRing *ring = (AccessRing *)strategy->mgmtData;
+    free(ring->frames);
+    free(ring->pages);
+    free(ring);
+    strategy->mgmtData = NULL;
+    return RC_OK;
+}
+
+// Brings page pageNum, not in the pool, into a frame for the caller, who holds the victim latch: a
+// free frame while there is one, else the ring's frame or the one the pool's strategy gives up. The
+// frame is fixed once, for a client pin, or with prefetch for the read, which is only started.
+// Sets *index to the frame; returns RC_BUFFER_POOL_FULL when every page is pinned, or the error of
+// a read that failed, in which case the page is not in the pool.
+static RC loadPage(BM_BufferPool *const bm, const PageNumber pageNum, BM_AccessStrategy *strategy, bool prefetch,
+                   int *index)
+{
+    BufferPoolMgmt *mgmt = (BufferPoolMgmt *)bm->mgmtData;
+    AccessRing *ring = strategy != NULL ? (AccessRing *)strategy->mgmtData : NULL;
+    int i;
+
+    // Handling the case where a buffer slot is still empty; frames are filled in index order
+    if (mgmt->framesUsed < mgmt->bufferSize) {
+        i = mgmt->framesUsed;
+
+        // Reading the specified page from disk straight into the frame
+        PageFrame frame;
+        frame.data = mgmt->frames[i].data;
+        frame.pageNum = pageNum; // Assigning page number
+        frame.fileId = bm->fileId;
+        frame.dirtyBit = 0;
+        frame.fixCount = 1;
+        frame.hitNum = 0;
+        frame.refNum = 0;
+        frame.readPending = prefetch;
+        RC status = startRead(bm, &frame, i);
+        if (status != RC_OK)
+            return status; // The frame stays free
+        mgmt->framesUsed++;
+
+        if (i == 0) {
+            // The first page read into an empty pool starts the counters
+            mgmt->numPagesReadCount = 0;
+        } else {
+            // Incrementing the count of pages read and setting the CLOCK reference bit
+            mgmt->numPagesReadCount++;
+            if (bm->strategy == RS_CLOCK)
+                frame.hitNum = 1;
+        }
+        if (bm->strategy == RS_LRU_K)
+            restoreHistory(mgmt, i, pageKey(bm->fileId, pageNum));
+        else
+            admitFrame(bm, i, pageKey(bm->fileId, pageNum));
+        setNewPageToPageFrame(bm, &frame, i); // Publishing the filled frame
+
+        // A free frame joins the ring like a replaced one
+        if (ring != NULL) {
+            ring->frames[ring->next] = i;
+            ring->pages[ring->next] = pageNum;
+            ring->next = (ring->next + 1) % strategy->ringSize;
+        }
+        *index = i;
         return RC_OK;
     }
-    else {
-        // Buffer pool has at least one page
-        bool isBufferFull = true;
-        int i;
-
-        for (i = 0; i < bufferSize; i++) {
-            // Check if current page frame is in use (i.e., not -1)
-            if (pageFrame[i].pageNum != -1) {
-                // Check if page is in memory
-                if (pageFrame[i].pageNum == pageNum) {
-                    // Increase fixCount as another client is accessing this page
-                    pageFrame[i].fixCount++;
-                    isBufferFull = false; // Buffer is not full as page is found
-                    hit++; // Increment the hit counter for replacement strategy
-                    // Update hitNum according to the replacement strategy
-                    
-                    // Update replacement strategy specific counters
-                    if (bm->strategy == RS_LRU)
-                        pageFrame[i].hitNum = hit;
-                    else if (bm->strategy == RS_CLOCK)
-                        pageFrame[i].hitNum = 1;
-                    else if (bm->strategy == RS_LFU)
-                        pageFrame[i].refNum++;
-                    
-                    // Set the page handle to the found page
-                    page->pageNum = pageNum;
-                    page->data = pageFrame[i].data;
-                    clockPointer++; // Increment the clock pointer for CLOCK strategy
-                    break; // Exit the loop as page is found and handled
-                }
-            }
-            else {
-                
-                // This section handles the case where a buffer slot is empty
-                // Opening the page file associated with the buffer pool
-                SM_FileHandle fh;
-                openPageFile(bm->pageFile, &fh);
-
-                // Allocating memory for the page's content
-                pageFrame[i].data = (SM_PageHandle)malloc(PAGE_SIZE);
-                // Reading the specified page from disk into the buffer pool// Reading the specified page from disk into the buffer pool
-                readBlock(pageNum, &fh, pageFrame[i].data);
-                pageFrame[i].pageNum = pageNum; // Assigning page numberv
-                pageFrame[i].fixCount = 1;
-                pageFrame[i].refNum = 0; // Initializing reference number
-                
-                // Incrementing counters for pages read and hits for replacement strategies
-                numPagesReadCount++;
-                hit++;
-
-                // Updating hit number based on the chosen replacement strategy
-                if (bm->strategy == RS_LRU)
-                    pageFrame[i].hitNum = hit;
-                else if (bm->strategy == RS_CLOCK)
-                    pageFrame[i].hitNum = 1;
-                // Setting the page handle properties to reflect the newly pinned page    
-                page->pageNum = pageNum;
-                page->data = pageFrame[i].data;
-                // Marking the buffer as not full since a page was successfully added
-                isBufferFull = false;
-                break; // Exiting the loop as the page has been handled
-            }
+
+    // Handling the full buffer pool case: the strategy reads the page into the frame it picks
+    PageFrame frame;
+    PageFrame *newPage = &frame;
+
+    // Initialize the properties of the new page frame
+    newPage->data = NULL;
+    newPage->pageNum = pageNum;
+    newPage->fileId = bm->fileId;
+    newPage->dirtyBit = 0;
+    newPage->fixCount = 1;
+    newPage->hitNum = 0;
+    newPage->refNum = 0;
+    newPage->readPending = prefetch;
+
+    // Update the count of pages read, which FIFO picks its frame from, and set the CLOCK reference bit
+    mgmt->numPagesReadCount++;
+    if (bm->strategy == RS_CLOCK)
+        newPage->hitNum = 1;
+
+    // Recycling the ring's frame if its page is still there and unpinned
+    RC status = RC_BUFFER_POOL_FULL;
+    if (ring != NULL) {
+        int idx = ring->frames[ring->next];
+        if (idx != -1 && idx < mgmt->bufferSize && mgmt->frames[idx].pageNum == ring->pages[ring->next]
+            && mgmt->frames[idx].fileId == bm->fileId)
+            status = reuseFrame(bm, newPage, idx);
+    }
+
+    // Implement the appropriate page replacement strategy otherwise
+    if (status == RC_BUFFER_POOL_FULL) {
+        switch (bm->strategy) {
+        case RS_FIFO:
+            status = FIFO(bm, newPage);
+            break;
+        case RS_LRU:
+            status = LRU(bm, newPage);
+            break;
+        case RS_CLOCK:
+            status = CLOCK(bm, newPage);
+            break;
+        case RS_LFU:
+            status = LFU(bm, newPage);
+            break;
+        case RS_LRU_K:
+            status = LRU_K(bm, newPage);
+            break;
+        case RS_ARC:
+            status = ARC(bm, newPage);
+            break;
+        case RS_2Q:
+            status = TWO_Q(bm, newPage);
+            break;
+        default:
+            printf("\n Not implementation of the algorithm");
+            break;
         }
+    }
+    if (status != RC_OK) {
+        mgmt->numPagesReadCount--; // Nothing was read
+        return status;
+    }
 
-        if (isBufferFull == true) {
-            // Handling the full buffer pool case
-            // Allocate memory for a new page frame
-            PageFrame *newPage = (PageFrame *)malloc(sizeof(PageFrame)); // reservar memoria si esta llena
-            SM_FileHandle fh;
-            openPageFile(bm->pageFile, &fh);
-
-            // Allocate memory for the page's content and read the page from disk
-            newPage->data = (SM_PageHandle)malloc(PAGE_SIZE);
-            readBlock(pageNum, &fh, newPage->data);
-
-            // Initialize the properties of the new page frame
-            newPage->pageNum = pageNum;
-            newPage->dirtyBit = 0;
-            newPage->fixCount = 1;
-            newPage->refNum = 0;
-
-            // Update counters for pages read and hits
-            numPagesReadCount++;
-            hit++;
-
-            // Set hit number based on the buffer pool's replacement strategy
-            if (bm->strategy == RS_LRU)
-                newPage->hitNum = hit;
-            else if (bm->strategy == RS_CLOCK)
-                newPage->hitNum = 1;
-                
-            // Set the page handle to the new page    
-            page->pageNum = pageNum;
-            page->data = newPage->data;
-            
-            // Implement the appropriate page replacement strategy
-            switch (bm->strategy) {
-            case RS_FIFO:
-                FIFO(bm, newPage);
-                free(newPage); 
-                break;
-            case RS_LRU:
-                LRU(bm, newPage);
-                free(newPage); 
-                break;
-            case RS_CLOCK:
-                CLOCK(bm, newPage);
-                free(newPage); 
-                break;
-            case RS_LFU:
-                LFU(bm, newPage);
-                free(newPage); 
-                break;
-            case RS_LRU_K:
-                break;
-            default:
-                printf("\n Not implementation of the algorithm");
-                break;
-            }
+    // The frame the page went to takes the ring's slot
+    PageKey key = pageKey(bm->fileId, pageNum);
+    PageTablePartition *part = partitionOf(mgmt, key);
+    latchPartition(mgmt, part);
+    i = lookupFrame(&part->table, key);
+    unlatchPartition(mgmt, part);
+    if (ring != NULL) {
+        ring->frames[ring->next] = i;
+        ring->pages[ring->next] = pageNum;
+        ring->next = (ring->next + 1) % strategy->ringSize;
+    }
+    *index = i;
+    return RC_OK;
+}
+
+// Takes a partition latch for a pin. If another thread holds it, the pin starts its clock at *start
+// and waits; returns whether it did.
+static bool latchPartitionForPin(BufferPoolMgmt *mgmt, PageTablePartition *part, struct timespec *start)
+{
+    if (!mgmt->threadSafe || pthread_mutex_trylock(&part->latch) == 0) return false;
+    clock_gettime(CLOCK_MONOTONIC, start);
+    pthread_mutex_lock(&part->latch);
+    return true;
+}
+
+// Same for the victim latch; the clock of a pin that gets this far has started already
+static bool latchVictimForPin(BufferPoolMgmt *mgmt)
+{
+    if (!mgmt->threadSafe || pthread_mutex_trylock(&mgmt->victimLatch) == 0) return false;
+    pthread_mutex_lock(&mgmt->victimLatch);
+    return true;
+}
+
+// Counts a hit on a page of partition part, whose latch is held
+static void countHit(PageTablePartition *part, bool quick)
+{
+    FRAME_STORE(part->hits, part->hits + 1);
+    if (quick)
+        FRAME_STORE(part->quickPins, part->quickPins + 1);
+}
+
+// Counts a timed pin, begun at *start, in the latency histogram, and among the waits if it waited
+static void countPin(BufferPoolMgmt *mgmt, const struct timespec *start, bool waited)
+{
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    long micros = (end.tv_sec - start->tv_sec) * 1000000L + (end.tv_nsec - start->tv_nsec) / 1000;
+    int bucket = 0;
+    while (bucket < BM_LATENCY_BUCKETS - 1 && micros >= 1L << bucket)
+        bucket++;
+    COUNT_STAT(mgmt, pinLatency[bucket], 1);
+    if (waited)
+        COUNT_STAT(mgmt, pinWaits, 1);
+}
+
+// Pins a page like pinPage. With an access strategy a miss first tries the frame its ring read a
+// page into ringSize misses ago; once the ring is full, a bulk reader or writer keeps replacing
+// its own pages and leaves the rest of the pool alone. Only when that page has been pinned or
+// replaced meanwhile does the pool's strategy pick the frame, which then joins the ring.
+// Hits that wait for nothing are only counted; the other pins are timed for getPoolStats.
+RC pinPageWithStrategy(BM_BufferPool *const bm, BM_PageHandle *const page, const PageNumber pageNum,
+                       BM_AccessStrategy *strategy) {
+    BufferPoolMgmt *mgmt = (BufferPoolMgmt *)bm->mgmtData;
+    AccessRing *ring = strategy != NULL ? (AccessRing *)strategy->mgmtData : NULL;
+    if (ring != NULL && ring->bm != bm) {
+        return RC_ERROR; // The strategy recycles frames of another pool
+    }
+    if (bm->fileId == NO_FILE) {
+        return RC_FILE_HANDLE_NOT_INIT; // A shared pool's pages are pinned through the handles of its files
+    }
+    PageKey key = pageKey(bm->fileId, pageNum);
+    PageTablePartition *part = partitionOf(mgmt, key);
+    struct timespec start;
+
+    // Handling the case where the page is already in memory: one page table lookup finds its frame
+    bool waited = latchPartitionForPin(mgmt, part, &start);
+    int i = lookupFrame(&part->table, key);
+    if (i >= 0) {
+        pinFrame(bm, page, i);
+        bool reading = __atomic_load_n(&mgmt->frames[i].readPending, __ATOMIC_ACQUIRE) != 0;
+        countHit(part, !waited && !reading);
+        unlatchPartition(mgmt, part);
+        if (reading && !waited)
+            clock_gettime(CLOCK_MONOTONIC, &start);
+        RC status = awaitRead(bm, i); // A prefetched page may still be on its way
+        if (waited || reading)
+            countPin(mgmt, &start, true);
+        return status;
+    }
+    unlatchPartition(mgmt, part);
+    if (!waited)
+        clock_gettime(CLOCK_MONOTONIC, &start);
+
+    // Another thread may have loaded the page while this one waited for the victim latch
+    waited = latchVictimForPin(mgmt) || waited;
+    if (mgmt->threadSafe) {
+        latchPartition(mgmt, part);
+        i = lookupFrame(&part->table, key);
+        if (i >= 0) {
+            pinFrame(bm, page, i);
+            countHit(part, false);
+        }
+        unlatchPartition(mgmt, part);
+        if (i >= 0) {
+            unlatchVictim(mgmt);
+            waited = __atomic_load_n(&mgmt->frames[i].readPending, __ATOMIC_ACQUIRE) != 0 || waited;
+            RC status = awaitRead(bm, i);
+            countPin(mgmt, &start, waited);
+            return status;
         }
-        return RC_OK;
     }
+
+    // Frames whose prefetch is done can be replaced again
+    completeReads(bm, 0);
+    RC status = loadPage(bm, pageNum, strategy, false, &i);
+    if (status == RC_BUFFER_POOL_FULL)
+        COUNT_STAT(mgmt, pinFailures, 1);
+    else if (status == RC_OK)
+        COUNT_STAT(mgmt, misses, 1);
+    unlatchVictim(mgmt);
+    countPin(mgmt, &start, waited);
+
+    if (status != RC_OK) {
+        return status; // No frame could take the page, or it could not be read
+    }
+
+    // Set the page handle to the new page
+    page->pageNum = pageNum;
+    page->data = mgmt->frames[i].data;
+    return RC_OK;
 }
 
+// Starts reading the pages of the list that are not in the pool into frames taken the way a miss
+// takes them, without pinning them. A later pinPage finds such a page in the pool and waits only for
+// what is left of its read. Pages for which no frame is free of pins are skipped.
+RC prefetchPages(BM_BufferPool *const bm, const PageNumber *pages, int n)
+{
+    if (bm == NULL || bm->mgmtData == NULL || (pages == NULL && n > 0)) {
+        return RC_ERROR;
+    }
+    BufferPoolMgmt *mgmt = (BufferPoolMgmt *)bm->mgmtData;
+    if (bm->fileId == NO_FILE) {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+
+    latchVictim(mgmt);
+    if (!mgmt->hasReadQueue) {
+        if (initAsyncQueue(&mgmt->readQueue, BM_PREFETCH_DEPTH, SM_ASYNC_AUTO) != RC_OK) {
+            unlatchVictim(mgmt);
+            return RC_ERROR;
+        }
+        mgmt->hasReadQueue = true;
+    }
+    completeReads(bm, 0);
 
+    for (int k = 0; k < n; k++) {
+        if (pages[k] < 0) {
+            unlatchVictim(mgmt);
+            return RC_READ_NON_EXISTING_PAGE;
+        }
 
+        // Pages already in the pool, or on their way, are left alone
+        PageKey key = pageKey(bm->fileId, pages[k]);
+        PageTablePartition *part = partitionOf(mgmt, key);
+        latchPartition(mgmt, part);
+        int i = lookupFrame(&part->table, key);
+        unlatchPartition(mgmt, part);
+        if (i >= 0) continue;
+
+        RC status = loadPage(bm, pages[k], NULL, true, &i);
+        if (status == RC_BUFFER_POOL_FULL) break; // Every page is pinned or being read
+        if (status != RC_OK) {
+            unlatchVictim(mgmt);
+            return status;
+        }
 
+        // A read the queue could not take was done at once; its fix goes straight away
+        if (__atomic_load_n(&mgmt->frames[i].readPending, __ATOMIC_ACQUIRE) == 0) {
+            __atomic_sub_fetch(&mgmt->frames[i].fixCount, 1, __ATOMIC_RELEASE);
+            syncFrame(bm, i);
+        }
+    }
+    unlatchVictim(mgmt);
+    return RC_OK;
+}
 
 // STATISTICS FUNCTIONS //
 
+// Whether frame i of the pool is reported through bm: every frame of a pool through the pool itself,
+// and the frames of its file through the handle of a file of a shared pool. Handles other than the
+// one resized may still count the frames the pool had before.
+static bool reportsFrame(BM_BufferPool *const bm, int i)
+{
+    BufferPoolMgmt *mgmt = (BufferPoolMgmt *)bm->mgmtData;
+    return i < mgmt->bufferSize && (bm->fileId == NO_FILE || !mgmt->shared || mgmt->frames[i].fileId == bm->fileId);
+}
 
 // This function returns an array of page numbers.
 PageNumber *getFrameContents(BM_BufferPool *const bm) {
@@ -564,14 +2973,14 @@ PageNumber *getFrameContents(BM_BufferPool *const bm) {
         return NULL; // Return NULL if buffer pool or its management data is not initialized
     }
 
-    PageFrame *pageFrame = (PageFrame *)bm->mgmtData;
+    PageFrame *pageFrame = getFrames(bm);
     // Allocate memory for an array of page numbers
     PageNumber *frameContents = (PageNumber *)malloc(sizeof(PageNumber) * bm->numPages);
 
     // Iterating through all the pages in the buffer pool
     for (int i = 0; i < bm->numPages; i++) {
         // Assign page number or NO_PAGE for empty frames
-        frameContents[i] = pageFrame[i].pageNum != -1 ? pageFrame[i].pageNum : NO_PAGE;
+        frameContents[i] = reportsFrame(bm, i) && pageFrame[i].pageNum != -1 ? pageFrame[i].pageNum : NO_PAGE;
     }
 
     return frameContents; // Return the array of page numbers
@@ -587,12 +2996,12 @@ bool *getDirtyFlags(BM_BufferPool *const bm) {
     }
     // Allocate memory for dirty flags array
     bool *dirtyFlags = (bool *)malloc(sizeof(bool) * bm->numPages);
-    PageFrame *pageFrame = (PageFrame *)bm->mgmtData;
+    PageFrame *pageFrame = getFrames(bm);
 
     // Iterate through all pages in the buffer pool
     for (int i = 0; i < bm->numPages; i++) {
         // Set dirty flag value based on the dirtyBit of the page
-        dirtyFlags[i] = pageFrame[i].dirtyBit == 1;
+        dirtyFlags[i] = reportsFrame(bm, i) && FRAME_LOAD(pageFrame[i].dirtyBit) == 1;
     }
 
     return dirtyFlags;// Return the array of dirty flags
@@ -608,12 +3017,12 @@ int *getFixCounts(BM_BufferPool *const bm) {
     }
     
     // Allocate memory for an array of fix counts
-    PageFrame *pageFrame = (PageFrame *)bm->mgmtData;
+    PageFrame *pageFrame = getFrames(bm);
     int *fixCounts = (int *)malloc(sizeof(int) * bm->numPages);
 
     // Iterate through all the pages in the buffer pool
     for (int i = 0; i < bm->numPages; i++) {
-        fixCounts[i] = pageFrame[i].fixCount != -1 ? pageFrame[i].fixCount : 0;
+        fixCounts[i] = reportsFrame(bm, i) && pageFrame[i].fixCount != -1 ? pageFrame[i].fixCount : 0;
     }
 
     return fixCounts;// Return the array of fix counts
@@ -621,24 +3030,83 @@ int *getFixCounts(BM_BufferPool *const bm) {
 
 
 
+// Returns the size of the pages the pool caches, the page size of its page file.
+int getPoolPageSize(BM_BufferPool *const bm)
+{
+    if (bm == NULL || bm->mgmtData == NULL) {
+        return 0; // Return 0 if buffer pool or its management data is not initialized
+    }
+    return ((BufferPoolMgmt *)bm->mgmtData)->pageSize;
+}
+
 // Returns the total number of page read operations from disk for the specified buffer pool.
 int getNumReadIO(BM_BufferPool *const bm)
 {
     // Check if buffer pool or its management data is initialized
     if (bm == NULL || bm->mgmtData == NULL) {
-        return NULL; // Return NULL if buffer pool or its management data is not initialized
+        return 0; // Return 0 if buffer pool or its management data is not initialized
     }
-	 // Incrementing by one as the initial count starts from 0.
-	return (numPagesReadCount + 1);
+	 // Every read is counted, by misses, prefetches and warm starts alike
+	return (int)__atomic_load_n(&((BufferPoolMgmt *)bm->mgmtData)->counters.pagesRead, __ATOMIC_RELAXED);
 }
 
 // Returns the total number of page write operations to disk for the specified buffer pool.
 int getNumWriteIO(BM_BufferPool *const bm)
 {       // Check if buffer pool or its management data is initialized
     if (bm == NULL || bm->mgmtData == NULL) {
-        return NULL; // Return NULL if buffer pool or its management data is not initialized
+        return 0; // Return 0 if buffer pool or its management data is not initialized
     }
 	 // Directly returning the count of pages written to disk.
-	return totalDiskWriteCount;
+	return __atomic_load_n(&((BufferPoolMgmt *)bm->mgmtData)->totalDiskWriteCount, __ATOMIC_RELAXED);
+}
+
+// Reads the pool's activity counters since init, with the hits and quick pins of the partitions. The
+// counts of BM_PoolStats, from hits on, are all longs.
+static void readCounters(BufferPoolMgmt *mgmt, BM_PoolStats *stats)
+{
+    const long *from = (const long *)&mgmt->counters.hits;
+    long *to = &stats->hits;
+    for (size_t k = 0; k < (sizeof(BM_PoolStats) - offsetof(BM_PoolStats, hits)) / sizeof(long); k++)
+        to[k] = __atomic_load_n(&from[k], __ATOMIC_RELAXED);
+    for (int p = 0; p < mgmt->numPartitions; p++) {
+        stats->hits += FRAME_LOAD(mgmt->partitions[p].hits);
+        stats->pinLatency[0] += FRAME_LOAD(mgmt->partitions[p].quickPins);
+    }
+}
+
+// Fills in a snapshot of the pool's activity since init or the last resetPoolStats. The counters
+// are read one by one while the pool runs on, so under load they may disagree by a few pins.
+RC getPoolStats(BM_BufferPool *const bm, BM_PoolStats *stats)
+{
+    if (bm == NULL || bm->mgmtData == NULL || stats == NULL) {
+        return RC_ERROR;
+    }
+    BufferPoolMgmt *mgmt = (BufferPoolMgmt *)bm->mgmtData;
+
+    readCounters(mgmt, stats);
+    pthread_mutex_lock(&mgmt->statsLatch);
+    const long *base = &mgmt->statsBase.hits;
+    long *count = &stats->hits;
+    for (size_t k = 0; k < (sizeof(BM_PoolStats) - offsetof(BM_PoolStats, hits)) / sizeof(long); k++)
+        count[k] -= base[k];
+    pthread_mutex_unlock(&mgmt->statsLatch);
+    stats->strategy = bm->strategy;
+    stats->numPages = mgmt->bufferSize;
+    return RC_OK;
 }
 
+// Starts the counts of later getPoolStats snapshots from now; getNumReadIO and getNumWriteIO go on
+RC resetPoolStats(BM_BufferPool *const bm)
+{
+    if (bm == NULL || bm->mgmtData == NULL) {
+        return RC_ERROR;
+    }
+    BufferPoolMgmt *mgmt = (BufferPoolMgmt *)bm->mgmtData;
+    BM_PoolStats now;
+
+    readCounters(mgmt, &now);
+    pthread_mutex_lock(&mgmt->statsLatch);
+    mgmt->statsBase = now;
+    pthread_mutex_unlock(&mgmt->statsLatch);
+    return RC_OK;
+}
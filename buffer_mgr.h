@@ -13,9 +13,14 @@ typedef enum ReplacementStrategy {
   RS_LRU = 1,
   RS_CLOCK = 2,
   RS_LFU = 3,
-  RS_LRU_K = 4
+  RS_LRU_K = 4,
+  RS_ARC = 5,
+  RS_2Q = 6
 } ReplacementStrategy;
 
+// K of RS_LRU_K when initBufferPool gets no stratData; otherwise stratData points to an int K
+#define BM_DEFAULT_LRU_K 2
+
 // Data Types and Structures
 typedef int PageNumber;
 #define NO_PAGE -1
@@ -26,7 +31,63 @@ typedef struct BM_BufferPool {
   ReplacementStrategy strategy;
   void *mgmtData; // use this one to store the bookkeeping info your buffer 
                   // manager needs for a buffer pool
+  int fileId;     // the page file's number among the files of the pool, NO_FILE for a shared pool itself
 } BM_BufferPool;
+#define NO_FILE -1
+
+// Latch partitions of a thread-safe pool's page table unless the options ask otherwise
+#define BM_DEFAULT_LATCH_PARTITIONS 16
+
+// Shares of a pool's frames, in percent, that wake its background writer and that it cleans down to
+#define BM_DEFAULT_WRITER_HIGH_WATERMARK 20
+#define BM_DEFAULT_WRITER_LOW_WATERMARK 10
+
+// Suffix of the file next to the page file in which a warmStart pool keeps its resident pages
+#define BM_WARM_START_SUFFIX ".warm"
+
+// Options for initBufferPoolWithOptions; initPoolOptions fills in the defaults
+typedef struct BM_PoolOptions {
+  bool directIO;        // open the page file with O_DIRECT so the pool is the only cache
+  bool threadSafe;      // allow concurrent calls on the pool from several threads
+  int latchPartitions;  // latches the page table is split into when threadSafe, rounded up to a power of two
+  bool hugePages;       // back the frames with huge pages: reserved ones (MAP_HUGETLB) if any, else transparent ones
+  bool backgroundWriter; // a thread writes dirty unpinned pages ahead of replacement; makes the pool thread-safe
+  int writerHighWatermark; // percent of the frames dirty that wakes the background writer
+  int writerLowWatermark;  // percent of the frames dirty the background writer cleans down to
+  bool warmStart;       // shutdown saves the resident pages, hottest first, and init reads them back in
+} BM_PoolOptions;
+
+// Frames a sequential scan or bulk insert recycles unless it asks for another ring size
+#define BM_DEFAULT_RING_SIZE 16
+
+// A ring of frames for sequential scans and bulk inserts, see pinPageWithStrategy; used by one
+// client at a time, with the pool initAccessStrategy was given
+typedef struct BM_AccessStrategy {
+  int ringSize;
+  void *mgmtData;
+} BM_AccessStrategy;
+
+// Buckets of the pin latency histogram: bucket b counts the pins that took less than 2^b microseconds
+// but not less than 2^(b-1), the last bucket also the slower ones
+#define BM_LATENCY_BUCKETS 20
+
+// Activity of a pool since it was initialised or since resetPoolStats, see getPoolStats. The counts
+// of a shared pool cover all of its files, whichever handle they are taken through.
+typedef struct BM_PoolStats {
+  ReplacementStrategy strategy;
+  int numPages;
+  long hits;            // pins that found their page in the pool
+  long misses;          // pins that read their page into a frame
+  long pinFailures;     // pins that found every frame pinned
+  long pinWaits;        // pins that waited for another thread: for a latch, or for the prefetch read of their page
+  long pinLatency[BM_LATENCY_BUCKETS]; // pins by time taken; hits that do not wait count as under 1us untimed
+  long pagesRead;       // pages read from the page files, by misses, prefetches and warm starts
+  long evictions;       // pages that gave up their frame to another page, or to a shrinking resize
+  long ringEvictions;   // those of them replaced through the ring of an access strategy
+  long evictionWrites;  // dirty pages written back as they were evicted
+  long flushWrites;     // dirty pages written back by forcePage, forceFlushPool, shutdown and detaching
+  long writerWrites;    // dirty pages written back by the background writer
+} BM_PoolStats;
 
 typedef struct BM_PageHandle {
   PageNumber pageNum;
@@ -44,8 +105,21 @@ typedef struct BM_PageHandle {
 RC initBufferPool(BM_BufferPool *const bm, const char *const pageFileName, 
 		  const int numPages, ReplacementStrategy strategy, 
 		  void *stratData);
+RC initBufferPoolWithOptions(BM_BufferPool *const bm, const char *const pageFileName,
+		  const int numPages, ReplacementStrategy strategy,
+		  void *stratData, const BM_PoolOptions *options);
+void initPoolOptions(BM_PoolOptions *options);
+// A shared pool caches the pages of every file attached to it in one set of numPages frames of
+// pageSize bytes, so the files compete for the frames through the pool's strategy. attachBufferPool
+// makes bm a pool of pageFileName's pages in shared; shutdownBufferPool on bm writes them back and
+// takes them out, on the shared pool it shuts down the pool and every file still attached. Attaching
+// and detaching, like resizing, is not done while other threads use the pool.
+RC initSharedBufferPool(BM_BufferPool *const bm, const int numPages, const int pageSize,
+		  ReplacementStrategy strategy, void *stratData, const BM_PoolOptions *options);
+RC attachBufferPool(BM_BufferPool *const bm, BM_BufferPool *const shared, const char *const pageFileName);
 RC shutdownBufferPool(BM_BufferPool *const bm);
 RC forceFlushPool(BM_BufferPool *const bm);
+RC resizeBufferPool(BM_BufferPool *const bm, int newNumPages); // not while other threads use the pool
 
 // Buffer Manager Interface Access Pages
 RC markDirty (BM_BufferPool *const bm, BM_PageHandle *const page);
@@ -53,6 +127,11 @@ RC unpinPage (BM_BufferPool *const bm, BM_PageHandle *const page);
 RC forcePage (BM_BufferPool *const bm, BM_PageHandle *const page);
 RC pinPage (BM_BufferPool *const bm, BM_PageHandle *const page, 
 	    const PageNumber pageNum);
+RC pinPageWithStrategy (BM_BufferPool *const bm, BM_PageHandle *const page,
+	    const PageNumber pageNum, BM_AccessStrategy *strategy);
+RC initAccessStrategy (BM_AccessStrategy *strategy, BM_BufferPool *const bm, int ringSize);
+RC freeAccessStrategy (BM_AccessStrategy *strategy);
+RC prefetchPages (BM_BufferPool *const bm, const PageNumber *pages, int n);
 
 // Statistics Interface
 PageNumber *getFrameContents (BM_BufferPool *const bm);
@@ -60,5 +139,8 @@ bool *getDirtyFlags (BM_BufferPool *const bm);
 int *getFixCounts (BM_BufferPool *const bm);
 int getNumReadIO (BM_BufferPool *const bm);
 int getNumWriteIO (BM_BufferPool *const bm);
+int getPoolPageSize (BM_BufferPool *const bm); // bytes in every page handed out by pinPage
+RC getPoolStats (BM_BufferPool *const bm, BM_PoolStats *stats);
+RC resetPoolStats (BM_BufferPool *const bm); // later snapshots count from now on
 
 #endif
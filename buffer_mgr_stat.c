@@ -6,6 +6,7 @@
 
 // local functions
 static void printStrat (BM_BufferPool *const bm);
+static const char *strategyName (ReplacementStrategy strategy);
 
 // external functions
 void 
@@ -51,6 +52,52 @@ sprintPoolContent (BM_BufferPool *const bm)
 }
 
 
+// Prints the pool's activity since init or its last resetPoolStats as one line of JSON
+void
+printPoolStats (BM_BufferPool *const bm)
+{
+	char *message = sprintPoolStats(bm);
+
+	if (message == NULL)
+		return;
+	printf("%s\n", message);
+	free(message);
+}
+
+// The same as a string the caller frees: counts of pins, reads, evictions and write-backs, with
+// pinLatencyUs holding the pins whose latency in microseconds is below 1, 2, 4, ... by bucket
+char *
+sprintPoolStats (BM_BufferPool *const bm)
+{
+	BM_PoolStats stats;
+	char *message;
+	int pos = 0;
+	int i;
+
+	if (getPoolStats(bm, &stats) != RC_OK)
+		return NULL;
+	message = (char *) malloc(512 + (22 * BM_LATENCY_BUCKETS));
+	if (message == NULL)
+		return NULL;
+
+	if (strategyName(stats.strategy) != NULL)
+		pos += sprintf(message + pos, "{\"strategy\":\"%s\"", strategyName(stats.strategy));
+	else
+		pos += sprintf(message + pos, "{\"strategy\":%i", stats.strategy);
+	pos += sprintf(message + pos, ",\"numPages\":%i,\"hits\":%ld,\"misses\":%ld,\"hitRatio\":%.4f",
+			stats.numPages, stats.hits, stats.misses,
+			stats.hits + stats.misses > 0 ? (double) stats.hits / (stats.hits + stats.misses) : 0.0);
+	pos += sprintf(message + pos, ",\"pinFailures\":%ld,\"pinWaits\":%ld,\"pinLatencyUs\":[", stats.pinFailures, stats.pinWaits);
+	for (i = 0; i < BM_LATENCY_BUCKETS; i++)
+		pos += sprintf(message + pos, "%s%ld", (i == 0) ? "" : ",", stats.pinLatency[i]);
+	pos += sprintf(message + pos, "],\"pagesRead\":%ld,\"evictions\":%ld,\"ringEvictions\":%ld", stats.pagesRead,
+			stats.evictions, stats.ringEvictions);
+	sprintf(message + pos, ",\"writes\":{\"eviction\":%ld,\"flush\":%ld,\"writer\":%ld}}", stats.evictionWrites,
+			stats.flushWrites, stats.writerWrites);
+
+	return message;
+}
+
 void
 printPageContent (BM_PageHandle *const page)
 {
@@ -81,25 +128,32 @@ sprintPageContent (BM_PageHandle *const page)
 void
 printStrat (BM_BufferPool *const bm)
 {
-	switch (bm->strategy)
+	if (strategyName(bm->strategy) != NULL)
+		printf("%s", strategyName(bm->strategy));
+	else
+		printf("%i", bm->strategy);
+}
+
+const char *
+strategyName (ReplacementStrategy strategy)
+{
+	switch (strategy)
 	{
 	case RS_FIFO:
-		printf("FIFO");
-		break;
+		return "FIFO";
 	case RS_LRU:
-		printf("LRU");
-		break;
+		return "LRU";
 	case RS_CLOCK:
-		printf("CLOCK");
-		break;
+		return "CLOCK";
 	case RS_LFU:
-		printf("LFU");
-		break;
+		return "LFU";
 	case RS_LRU_K:
-		printf("LRU-K");
-		break;
+		return "LRU-K";
+	case RS_ARC:
+		return "ARC";
+	case RS_2Q:
+		return "2Q";
 	default:
-		printf("%i", bm->strategy);
-		break;
+		return NULL;
 	}
 }
@@ -8,5 +8,7 @@ void printPoolContent (BM_BufferPool *const bm);
 void printPageContent (BM_PageHandle *const page);
 char *sprintPoolContent (BM_BufferPool *const bm);
 char *sprintPageContent (BM_PageHandle *const page);
+void printPoolStats (BM_BufferPool *const bm); // getPoolStats as JSON
+char *sprintPoolStats (BM_BufferPool *const bm);
 
 #endif
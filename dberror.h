@@ -4,7 +4,7 @@
 #include "stdio.h"
 
 /* module wide constants */
-#define PAGE_SIZE 4096
+#define PAGE_SIZE 4096  /* page size of files made by createPageFile, see createPageFileWithPageSize */
 
 /* return code definitions */
 typedef int RC;
@@ -15,6 +15,10 @@ typedef int RC;
 #define RC_WRITE_FAILED 3
 #define RC_READ_NON_EXISTING_PAGE 4
 #define RC_ERROR 5
+#define RC_IO_QUEUE_FULL 6
+#define RC_INVALID_PAGE_FILE 7
+#define RC_INVALID_PAGE_SIZE 8
+#define RC_BUFFER_POOL_FULL 9
 
 #define RC_RM_COMPARE_VALUE_OF_DIFFERENT_DATATYPE 200
 #define RC_RM_EXPR_RESULT_IS_NOT_BOOLEAN 201
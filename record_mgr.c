@@ -22,12 +22,42 @@ typedef struct RecordManager
 	int freePage;
 	// This variable stores the count of the number of records scanned
 	int scanCount;
+	// Ring of frames insertRecord recycles, so a bulk load does not evict the rest of the pool
+	BM_AccessStrategy bulkInsert;
+	// Name of the table, and the next one in the list of open tables
+	char *name;
+	struct RecordManager *next;
 } RecordManager;
 
+// Bookkeeping of a scan, kept behind RM_ScanHandle.mgmtData
+typedef struct ScanManager
+{
+	// Slot the scan looks at next
+	RID recordID;
+	// Condition the records returned satisfy, NULL for all of them
+	Expr *condition;
+	// Records of the table seen so far
+	int scanCount;
+	// Ring of frames the scan recycles, so one scan does not evict the rest of the pool
+	BM_AccessStrategy ring;
+} ScanManager;
+
+// A buffer pool the open tables of one page size share, in a list of such pools
+typedef struct SharedPool
+{
+	BM_BufferPool pool;
+	struct SharedPool *next;
+} SharedPool;
+
 const int MAX_NUMBER_OF_PAGES = 100;
 const int ATTRIBUTE_SIZE = 15; // Size of the name of the attribute
 
-RecordManager *recordManager;
+// Bytes of frames each shared buffer pool has, however many tables it caches
+#define RM_BUFFER_BUDGET (16 * 1024 * 1024)
+
+static SharedPool *sharedPools;
+// Tables open at the moment, each attached to the shared pool of its page size
+static RecordManager *openTables;
 
 #pragma region Table and Manager
 
@@ -41,22 +71,70 @@ RC initRecordManager(void *mgmtData) {
     return RC_OK;
 }
 
+// Shuts down the buffer pools the tables shared; the tables must be closed already
 RC shutdownRecordManager() {
-    return RC_OK;
+    RC result = RC_OK;
+    while (sharedPools != NULL) {
+        SharedPool *shared = sharedPools;
+        sharedPools = shared->next;
+        RC status = shutdownBufferPool(&shared->pool);
+        if (result == RC_OK) result = status;
+        free(shared);
+    }
+    return result;
 }
 
-#define MAX_NUMBER_OF_PAGES 100000 // Define tu máximo número de páginas
+// Attaches the page file of table name to the buffer pool shared by the tables of its page size,
+// which is created on first use; the tables' pages compete for its RM_BUFFER_BUDGET bytes of frames
+static RC attachTable(BM_BufferPool *bm, char *name) {
+    SM_FileHandle fileHandle;
+    RC result = openPageFile(name, &fileHandle);
+    if (result != RC_OK) return result;
+    int pageSize = getPageSize(&fileHandle);
+    closePageFile(&fileHandle);
+
+    SharedPool *shared = sharedPools;
+    while (shared != NULL && getPoolPageSize(&shared->pool) != pageSize)
+        shared = shared->next;
+    if (shared == NULL) {
+        shared = (SharedPool *) malloc(sizeof(SharedPool));
+        if (shared == NULL) return RC_ERROR;
+        int numPages = RM_BUFFER_BUDGET / pageSize > 0 ? RM_BUFFER_BUDGET / pageSize : 1;
+        result = initSharedBufferPool(&shared->pool, numPages, pageSize, RS_LRU, NULL, NULL);
+        if (result != RC_OK) {
+            free(shared);
+            return result;
+        }
+        shared->next = sharedPools;
+        sharedPools = shared;
+    }
+    return attachBufferPool(bm, &shared->pool, name);
+}
 #define ATTRIBUTE_SIZE 500       // Define el tamaño máximo para el nombre del atributo
 
 extern RC createTable(char *name, Schema *schema) {
-    recordManager = (RecordManager*) malloc(sizeof(RecordManager));
-
-    // Inicializando el buffer pool con la política de reemplazo LFU
-    initBufferPool(&recordManager->bufferPool, name, MAX_NUMBER_OF_PAGES, RS_LRU, NULL);
+    // Tables use the default page size unless created with createTableWithPageSize
+    return createTableWithPageSize(name, schema, PAGE_SIZE);
+}
 
-    char data[PAGE_SIZE];
-    memset(data, 0, PAGE_SIZE);
-    char *pageHandle = data;
+extern RC createTableWithPageSize(char *name, Schema *schema, int pageSize) {
+    // Crear un archivo de página con el nombre de la tabla
+    RC result = createPageFileWithPageSize(name, pageSize);
+    if (result != RC_OK) return result;
+
+    // Writing the schema page through an attachment to the shared pool of the page size, detached
+    // again before returning; openTable attaches the table for its own use
+    BM_BufferPool bufferPool;
+    BM_PageHandle page;
+    result = attachTable(&bufferPool, name);
+    if (result != RC_OK) return result;
+    result = pinPage(&bufferPool, &page, 0);
+    if (result != RC_OK) {
+        shutdownBufferPool(&bufferPool);
+        return result;
+    }
+    char *pageHandle = page.data;
+    memset(pageHandle, 0, pageSize);
 
     // Establecer el número de tuplas a 0
     *(int*)pageHandle = 0; 
@@ -89,39 +167,28 @@ extern RC createTable(char *name, Schema *schema) {
         pageHandle += sizeof(int);
     }
 
-    SM_FileHandle fileHandle;
-
-    // Crear un archivo de página con el nombre de la tabla
-    RC result;
-    if ((result = createPageFile(name)) != RC_OK) return result;
-
-    // Abrir el archivo recién creado
-    if ((result = openPageFile(name, &fileHandle)) != RC_OK) return result;
-
-    // Escribir el esquema en la primera ubicación del archivo
-    if ((result = writeBlock(0, &fileHandle, data)) != RC_OK) return result;
-
-    // Cerrar el archivo después de escribir
-    if ((result = closePageFile(&fileHandle)) != RC_OK) return result;
-
-    return RC_OK;
+    // Separar el archivo del buffer pool, escribiendo la página del esquema
+    markDirty(&bufferPool, &page);
+    unpinPage(&bufferPool, &page);
+    return shutdownBufferPool(&bufferPool);
 }
 
 extern RC deleteTable(char *name) {
-    // Asegurarse de que el buffer pool para esta tabla esté correctamente liberado
-    if (recordManager != NULL) {
-        RC status;
-
-        // Primero, cerrar el buffer pool asociado con esta tabla
-        status = shutdownBufferPool(&recordManager->bufferPool);
+    // Detaching the open handles of the table from their shared pool first; closeTable then only
+    // frees their bookkeeping
+    RecordManager **link = &openTables;
+    while (*link != NULL) {
+        RecordManager *rm = *link;
+        if (strcmp(rm->name, name) != 0) {
+            link = &rm->next;
+            continue;
+        }
+        *link = rm->next;
+        rm->next = NULL;
+        RC status = shutdownBufferPool(&rm->bufferPool);
         if (status != RC_OK) {
             return status;
         }
-
-        // Liberar la memoria asignada a la estructura RecordManager
-        free(recordManager);
-        recordManager = NULL; // Prevenir el uso de punteros colgantes
-        
     }
 
     // Finalmente, destruir el archivo de la tabla
@@ -135,36 +202,88 @@ extern RC openTable(RM_TableData *rel, char *name) {
         return RC_ERROR;
     }
 
-    // Asignar memoria para el esquema y datos de gestión (si es necesario)
-    rel->schema = (Schema *)calloc(1,sizeof(Schema));
-    if (rel->schema == NULL) {
+    // Each open table has its handle in the shared buffer pool, kept with its bookkeeping in rel->mgmtData
+    RecordManager *rm = (RecordManager *)calloc(1, sizeof(RecordManager));
+    if (rm == NULL) {
         return RC_ERROR;
     }
+    RC result = attachTable(&rm->bufferPool, name);
+    if (result != RC_OK) {
+        free(rm);
+        return result;
+    }
 
-    // Aquí debes cargar el esquema desde el archivo de la tabla
-    // Esto depende de cómo hayas implementado la serialización del esquema en createTable
+    // Leyendo el número de tuplas, la primera página libre y el esquema de la página 0
+    result = pinPage(&rm->bufferPool, &rm->pageHandle, 0);
+    if (result != RC_OK) {
+        shutdownBufferPool(&rm->bufferPool);
+        free(rm);
+        return result;
+    }
+    char *pageHandle = rm->pageHandle.data;
+    rm->tuplesCount = *(int *)pageHandle;
+    pageHandle += sizeof(int);
+    rm->freePage = *(int *)pageHandle;
+    pageHandle += sizeof(int);
 
-    // Inicializar el buffer pool para esta tabla
-    rel->mgmtData = calloc(1, sizeof(BM_BufferPool));
-    if (rel->mgmtData == NULL) {
-        free(rel->schema);
-        return RC_ERROR;
+    int numAttr = *(int *)pageHandle;
+    pageHandle += sizeof(int);
+    int keySize = *(int *)pageHandle;
+    pageHandle += sizeof(int);
+
+    char **attrNames = (char **)malloc(sizeof(char *) * numAttr);
+    DataType *dataTypes = (DataType *)malloc(sizeof(DataType) * numAttr);
+    int *typeLength = (int *)malloc(sizeof(int) * numAttr);
+    for (int k = 0; k < numAttr; k++) {
+        attrNames[k] = strndup(pageHandle, ATTRIBUTE_SIZE);
+        pageHandle += ATTRIBUTE_SIZE;
+        dataTypes[k] = (DataType) *(int *)pageHandle;
+        pageHandle += sizeof(int);
+        typeLength[k] = *(int *)pageHandle;
+        pageHandle += sizeof(int);
     }
+    unpinPage(&rm->bufferPool, &rm->pageHandle);
 
-    initBufferPool((BM_BufferPool *)rel->mgmtData, name, MAX_NUMBER_OF_PAGES, RS_LRU, NULL);
+    // The key attributes are not stored with the table
+    rel->schema = createSchema(numAttr, attrNames, dataTypes, typeLength, keySize, NULL);
+    initAccessStrategy(&rm->bulkInsert, &rm->bufferPool, BM_DEFAULT_RING_SIZE);
 
+    rel->mgmtData = rm;
     rel->name = strdup(name);  // Asegurarse de liberar esto en closeTable
+    rm->name = rel->name;
+    rm->next = openTables;
+    openTables = rm;
     return RC_OK;
 }
 extern RC closeTable(RM_TableData *rel) {
     // Asegurar que rel no es NULL
-    if (rel == NULL) {
+    if (rel == NULL || rel->mgmtData == NULL) {
         return RC_ERROR;
     }
+    RecordManager *rm = (RecordManager *)rel->mgmtData;
+    RecordManager **link = &openTables;
+    while (*link != NULL && *link != rm)
+        link = &(*link)->next;
+
+    // A table deleteTable removed while open is detached already, its file gone
+    RC result = RC_OK;
+    freeAccessStrategy(&rm->bulkInsert);
+    if (*link == rm) {
+        *link = rm->next;
+
+        // Guardando el número de tuplas y la primera página libre en la página 0
+        if (pinPage(&rm->bufferPool, &rm->pageHandle, 0) == RC_OK) {
+            *(int *)rm->pageHandle.data = rm->tuplesCount;
+            *(int *)(rm->pageHandle.data + sizeof(int)) = rm->freePage;
+            markDirty(&rm->bufferPool, &rm->pageHandle);
+            unpinPage(&rm->bufferPool, &rm->pageHandle);
+        }
 
-    // Cerrar el buffer pool asociado con la tabla
-    shutdownBufferPool((BM_BufferPool *)rel->mgmtData);
-    free(rel->mgmtData);
+        // Separar la tabla del buffer pool compartido, escribiendo las páginas modificadas
+        result = shutdownBufferPool(&rm->bufferPool);
+    }
+    free(rm);
+    rel->mgmtData = NULL;
 
     // Liberar el esquema
     freeSchema(rel->schema);
@@ -172,13 +291,13 @@ extern RC closeTable(RM_TableData *rel) {
     // Liberar el nombre de la tabla
     free(rel->name);
     
-    return RC_OK;
+    return result;
 }
 
 
 
 int getNumTuples(RM_TableData *rel) {
-    return RC_OK; // You may need to change this to a relevant return type, as this function returns an int.
+    return ((RecordManager *)rel->mgmtData)->tuplesCount;
 }
 
 #pragma endregion 
@@ -198,7 +317,8 @@ extern RC insertRecord(RM_TableData *rel, Record *record) {
     BM_PageHandle *pageHandle = MAKE_PAGE_HANDLE();
     char *data;
     int recordSize = getRecordSize(rel->schema);
-    int numSlots = PAGE_SIZE / recordSize; // Assuming each record fits in a slot and PAGE_SIZE is a constant
+    int slotSize = recordSize + 1; // The '+' marker, then the record
+    int numSlots = getPoolPageSize(&rm->bufferPool) / slotSize; // Assuming each record fits in a slot of the table's page size
  
     // Set to the first available page
     RID *rid = &record->id;
@@ -207,23 +327,29 @@ extern RC insertRecord(RM_TableData *rel, Record *record) {
 
     // Iterate through pages to find a free slot
     bool isRecordInserted = false;
+    RC rc = RC_OK;
    
     while (!isRecordInserted) {
-        CHECK(pinPage(&rm->bufferPool, pageHandle, rid->page));
+        // Inserts go through the table's ring, so appending many records recycles a few frames
+        rc = pinPageWithStrategy(&rm->bufferPool, pageHandle, rid->page, &rm->bulkInsert);
+        if (rc != RC_OK) {
+            break; // The page could not be read, or every frame is pinned
+        }
         data = pageHandle->data;
 
         for (int slot = 0; slot < numSlots; slot++) {
-            if (data[slot * recordSize] != '+') { // Assuming '+' denotes a filled slot
+            if (data[slot * slotSize] != '+') { // Assuming '+' denotes a filled slot
                 rid->slot = slot;
-                data += slot * recordSize;
+                data += slot * slotSize;
 
                 // Marking the page as dirty and updating record info
                 data[0] = '+'; // Mark as filled
-                memcpy(data + 1, record->data + 1, recordSize - 1);
+                memcpy(data + 1, record->data, recordSize);
                 markDirty(&rm->bufferPool, pageHandle);
-                CHECK(unpinPage(&rm->bufferPool, pageHandle));
+                rc = unpinPage(&rm->bufferPool, pageHandle);
 
                 rm->tuplesCount++; // Update tuples count
+                rm->freePage = rid->page; // Earlier pages are full
                 isRecordInserted = true;
                 break;
             }
@@ -231,13 +357,16 @@ extern RC insertRecord(RM_TableData *rel, Record *record) {
 
         if (!isRecordInserted) {
             // No free slot in the current page
-            CHECK(unpinPage(&rm->bufferPool, pageHandle));
+            rc = unpinPage(&rm->bufferPool, pageHandle);
+            if (rc != RC_OK) {
+                break;
+            }
             rid->page++; // Move to the next page
         }
     }
  
     free(pageHandle);
-    return RC_OK;
+    return rc;
 }
 
 
@@ -264,7 +393,7 @@ extern RC getRecord(RM_TableData *rel, RID id, Record *record) {
 
     // Calculate the start position of the record in the page
     int sizeOfRecord = getRecordSize(rel->schema);
-    char *recordStart = rm->pageHandle.data + (id.slot * sizeOfRecord);
+    char *recordStart = rm->pageHandle.data + (id.slot * (sizeOfRecord + 1));
 
     // Check if the record is valid (assuming '+' indicates validity)
     if (*recordStart != '+') {
@@ -276,7 +405,7 @@ extern RC getRecord(RM_TableData *rel, RID id, Record *record) {
     record->id = id;
 
     // Copy the record's content from the page to the output parameter
-    memcpy(record->data, recordStart + 1, sizeOfRecord - 1);
+    memcpy(record->data, recordStart + 1, sizeOfRecord);
 
     // Release the page as it's no longer needed in memory
     rc = unpinPage(&rm->bufferPool, &rm->pageHandle);
@@ -288,14 +417,96 @@ extern RC getRecord(RM_TableData *rel, RID id, Record *record) {
 
 #pragma region Scans
 RC startScan(RM_TableData *rel, RM_ScanHandle *scan, Expr *cond) {
+    if (rel == NULL || rel->mgmtData == NULL || scan == NULL) {
+        return RC_ERROR;
+    }
+    RecordManager *rm = (RecordManager *)rel->mgmtData;
+
+    ScanManager *sm = (ScanManager *)calloc(1, sizeof(ScanManager));
+    if (sm == NULL) {
+        return RC_ERROR;
+    }
+
+    // Records start on page 1; page 0 holds the schema
+    sm->recordID.page = 1;
+    sm->recordID.slot = 0;
+    sm->condition = cond;
+    RC result = initAccessStrategy(&sm->ring, &rm->bufferPool, BM_DEFAULT_RING_SIZE);
+    if (result != RC_OK) {
+        free(sm);
+        return result;
+    }
+
+    scan->rel = rel;
+    scan->mgmtData = sm;
     return RC_OK;
 }
 
+// Returns the next record of the table satisfying the scan's condition, reading the table's pages
+// in order through the scan's ring
 RC next(RM_ScanHandle *scan, Record *record) {
-    return RC_OK;
+    RecordManager *rm = (RecordManager *)scan->rel->mgmtData;
+    ScanManager *sm = (ScanManager *)scan->mgmtData;
+    Schema *schema = scan->rel->schema;
+    BM_PageHandle pageHandle;
+    int recordSize = getRecordSize(schema);
+    int slotSize = recordSize + 1; // The '+' marker, then the record
+    int numSlots = getPoolPageSize(&rm->bufferPool) / slotSize;
+
+    while (sm->scanCount < rm->tuplesCount) {
+        RID id = sm->recordID;
+
+        // Moving on to the next slot, and to the next page after the last slot
+        if (++sm->recordID.slot == numSlots) {
+            sm->recordID.page++;
+            sm->recordID.slot = 0;
+        }
+
+        RC rc = pinPageWithStrategy(&rm->bufferPool, &pageHandle, id.page, &sm->ring);
+        if (rc != RC_OK) {
+            sm->recordID = id; // The scan can go on from this slot
+            return rc;
+        }
+        char *recordStart = pageHandle.data + id.slot * slotSize;
+        bool filled = *recordStart == '+';
+        if (filled) {
+            sm->scanCount++;
+            record->id = id;
+            memcpy(record->data, recordStart + 1, recordSize);
+        }
+        rc = unpinPage(&rm->bufferPool, &pageHandle); // The record is copied out before it is checked
+        if (rc != RC_OK) {
+            return rc;
+        }
+        if (!filled) {
+            continue; // Empty slot
+        }
+
+        if (sm->condition == NULL) {
+            return RC_OK;
+        }
+        Value *result;
+        rc = evalExpr(record, schema, sm->condition, &result);
+        if (rc != RC_OK) {
+            return rc;
+        }
+        bool matches = result->v.boolV;
+        freeVal(result);
+        if (matches) {
+            return RC_OK;
+        }
+    }
+    return RC_RM_NO_MORE_TUPLES;
 }
 
 RC closeScan(RM_ScanHandle *scan) {
+    if (scan == NULL || scan->mgmtData == NULL) {
+        return RC_ERROR;
+    }
+    ScanManager *sm = (ScanManager *)scan->mgmtData;
+    freeAccessStrategy(&sm->ring);
+    free(sm);
+    scan->mgmtData = NULL;
     return RC_OK;
 }
 #pragma endregion
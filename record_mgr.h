@@ -12,10 +12,13 @@ typedef struct RM_ScanHandle
 	void *mgmtData;
 } RM_ScanHandle;
 
-// table and manager
+// table and manager. A table named "tablespace:table" is stored as a segment of the
+// tablespace file instead of a page file of its own, see createPageFile.
 extern RC initRecordManager (void *mgmtData);
 extern RC shutdownRecordManager ();
 extern RC createTable (char *name, Schema *schema);
+// like createTable, with pages of pageSize bytes (see createPageFileWithPageSize)
+extern RC createTableWithPageSize (char *name, Schema *schema, int pageSize);
 extern RC openTable (RM_TableData *rel, char *name);
 extern RC closeTable (RM_TableData *rel);
 extern RC deleteTable (char *name);
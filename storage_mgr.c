@@ -1,436 +1,1444 @@
+#define _GNU_SOURCE
 #include<stdio.h>
 #include<stdlib.h>
 #include<sys/stat.h>
 #include<sys/types.h>
+#include<sys/uio.h>
+#include<sys/mman.h>
 #include<unistd.h>
+#include<fcntl.h>
+#include<errno.h>
+#include<limits.h>
+#include<stdint.h>
 #include<string.h>
 #include<math.h>
 
 #include "storage_mgr.h"
 
-FILE *pageFile;
+/* Layout of a page file: a header page describing the file, followed by groups of
+   pages. Each group starts with a free-space bitmap page whose bits stand for the
+   PAGES_PER_MAP data pages after it; a set bit marks a page released with freePage.
+   All pages of a file have the size recorded in its header, see createPageFileWithPageSize.
+   Callers only ever see the data pages, numbered 0 .. totalNumPages-1; the header and
+   bitmap pages are skipped by physicalPage. Zero-filled bitmap pages mean "every page
+   in use", so growing the file never has to touch them. */
+#define SM_FILE_MAGIC "DBPGFILE"
+#define SM_FILE_VERSION 1
+#define HEADER_PAGES 1
+#define PAGES_PER_MAP(mgmt) ((mgmt)->pageSize * 8)
 
-extern void initStorageManager (void) {
-	// Initialising file pointer i.e. storage manager.
-	pageFile = NULL;
+typedef struct SM_FileHeader {
+	char magic[8];		// SM_FILE_MAGIC, without the terminating zero
+	int version;		// SM_FILE_VERSION
+	int pageSize;		// Size of every page in the file
+} SM_FileHeader;
+
+/* A tablespace is a page file holding many segments, each one standing in for a page
+   file of its own. Its data page 0 starts a chain of directory pages mapping segment
+   names to segment header pages; a header page lists the extents, runs of consecutive
+   tablespace pages, that hold the pages of its segment in order. Segments are named
+   "tablespace:segment" wherever a file name is expected. */
+#define SM_DIRECTORY_MAGIC "DBSEGDIR"
+#define SEGMENT_NAME_LENGTH 56
+#define MAX_SEGMENT_EXTENT_PAGES 1024
+
+typedef struct SM_DirectoryEntry {
+	char name[SEGMENT_NAME_LENGTH];	// Segment name, zero terminated
+	int headerPage;			// Tablespace page holding the segment header, 0 for an empty slot
+	int reserved;
+} SM_DirectoryEntry;
+
+typedef struct SM_DirectoryPage {
+	char magic[8];			// SM_DIRECTORY_MAGIC, without the terminating zero
+	int nextPage;			// Next directory page, 0 at the end of the chain
+	int reserved;
+	SM_DirectoryEntry entries[];
+} SM_DirectoryPage;
+
+#define DIRECTORY_ENTRIES(pageSize) ((int)(((pageSize) - sizeof(SM_DirectoryPage)) / sizeof(SM_DirectoryEntry)))
+
+typedef struct SM_Extent {
+	int start;		// First tablespace page of the extent
+	int length;		// Number of pages in the extent
+} SM_Extent;
+
+typedef struct SM_SegmentHeader {
+	int numPages;		// Pages of the segment, the totalNumPages of its handles
+	int numExtents;		// Extents in use; together they hold at least numPages pages
+	SM_Extent extents[];
+} SM_SegmentHeader;
+
+#define MAX_SEGMENT_EXTENTS(pageSize) ((int)(((pageSize) - sizeof(SM_SegmentHeader)) / sizeof(SM_Extent)))
+
+// An open tablespace, shared by the handles of all its open segments.
+typedef struct SM_TableSpace {
+	char *fileName;			// Page file of the tablespace
+	SM_FileHandle fHandle;		// The one handle on that page file
+	int refCount;			// Open segment handles, plus callers working on the directory
+	struct SM_TableSpace *next;
+} SM_TableSpace;
+
+// Tablespaces with at least one user, looked up by file name.
+static SM_TableSpace *openTableSpaces = NULL;
+
+/* Bookkeeping kept behind SM_FileHandle.mgmtInfo for as long as the handle is open.
+   The descriptor is opened once in openPageFile and released in closePageFile, so page
+   I/O is a single positional pread()/pwrite() without any stdio stream in between.
+   Handles opened with openPageFileMapped additionally keep a shared mapping of the
+   whole file and copy pages in and out of it instead of issuing system calls.
+   Handles opened with openPageFileDirect bypass the kernel page cache (O_DIRECT),
+   which requires SM_IO_ALIGNMENT aligned buffers; unaligned ones are bounced. */
+typedef struct SM_FileMgmt {
+	int fd;			// Open descriptor of the page file
+	int pageSize;		// Size of the file's pages, from its header
+	char *map;		// Start of the shared mapping, NULL for descriptor I/O
+	size_t mapLength;	// Bytes currently mapped, always the whole file
+	int mapped;		// Whether the handle was opened with openPageFileMapped
+	int direct;		// Whether the handle was opened with openPageFileDirect
+	int allocatedPages;	// Physical pages with disk space reserved, at least the file size
+	int extentPages;	// Pages reserved at a time when the file grows
+	unsigned char *freeMap;	// All bitmap pages back to back: bit n is set when page n is free
+	int numMaps;		// Bitmap pages held in freeMap
+	int numFree;		// Number of bits set in freeMap
+	int freeHint;		// No page below this one is free
+	SM_TableSpace *space;	// Tablespace holding the segment, NULL for a page file of its own
+	int headerPage;		// Tablespace page holding the segment header
+	SM_SegmentHeader *segment;	// Aligned copy of the segment header page
+	int readAheadWindow;	// Pages read at once by a sequential reader, 0 or 1 to disable
+	SM_PageHandle readAhead;	// readAheadWindow pages ahead of the reader, NULL until needed
+	SM_PageHandle *readAheadPages;	// The pages of readAhead, as transferBlocks takes them
+	int readAheadStart;	// First page held in readAhead
+	int readAheadCount;	// Pages held in readAhead, 0 when it is empty
+	int lastRead;		// Page last read through readBlock, to detect sequential access
+} SM_FileMgmt;
+
+// Ways of opening a handle, see openHandle.
+#define OPEN_MAPPED 1
+#define OPEN_DIRECT 2
+
+static int isAligned (const void *buffer) {
+	return ((uintptr_t)buffer % SM_IO_ALIGNMENT) == 0;
 }
 
-extern RC createPageFile (char *fileName) {
-	// Opening file stream in read & write mode. 'w+' mode creates an empty file for both reading and writing.
-	pageFile = fopen(fileName, "w+");
+// Returning the management info of an open handle or NULL if the handle was never opened.
+static SM_FileMgmt *getFileMgmt (SM_FileHandle *fHandle) {
+	if(fHandle == NULL)
+		return NULL;
+	return (SM_FileMgmt *)fHandle->mgmtInfo;
+}
 
-	// Checking if file was successfully opened.
-	if(pageFile == NULL) {
-		return RC_FILE_NOT_FOUND;
-	} else {
-		// Creating an empty page in memory.
-		SM_PageHandle emptyPage = (SM_PageHandle)calloc(PAGE_SIZE, sizeof(char));
-		
-		// Writing empty page to file.
-		if(fwrite(emptyPage, sizeof(char), PAGE_SIZE,pageFile) < PAGE_SIZE)
-			printf("write failed \n");
-		else
-			printf("write succeeded \n");
-		
-		// Closing file stream so that all the buffers are flushed. 
-		fclose(pageFile);
-		
-		// De-allocating the memory previously allocated to 'emptyPage'.
-		// This is optional but always better to do for proper memory management.
-		free(emptyPage);
-		
+static RC growSegment (SM_FileHandle *fHandle, SM_FileMgmt *mgmt, int newNumPages);
+
+// Tablespace page holding page pageNum of a segment. *contiguous receives the number of
+// pages from there on that follow each other in the tablespace.
+static int segmentPage (SM_SegmentHeader *segment, int pageNum, int *contiguous) {
+	int i, first = 0;
+
+	for(i = 0; i < segment->numExtents; i++) {
+		SM_Extent *extent = &segment->extents[i];
+		if(pageNum < first + extent->length) {
+			*contiguous = first + extent->length - pageNum;
+			return extent->start + pageNum - first;
+		}
+		first += extent->length;
+	}
+	return -1;
+}
+
+// Management info of the page file actually holding page *pageNum of the handle, with
+// *pageNum translated to that file; segments resolve to their tablespace.
+static SM_FileMgmt *resolvePage (SM_FileMgmt *mgmt, int *pageNum) {
+	if(mgmt->space == NULL)
+		return mgmt;
+
+	int contiguous;
+	*pageNum = segmentPage(mgmt->segment, *pageNum, &contiguous);
+	return getFileMgmt(&mgmt->space->fHandle);
+}
+
+// Physical page of the file holding data page pageNum.
+static off_t physicalPage (SM_FileMgmt *mgmt, int pageNum) {
+	int group = pageNum / PAGES_PER_MAP(mgmt);
+	return HEADER_PAGES + (off_t)group * (PAGES_PER_MAP(mgmt) + 1) + 1 + pageNum % PAGES_PER_MAP(mgmt);
+}
+
+// Physical page holding the bitmap of the given group of data pages.
+static off_t mapPage (SM_FileMgmt *mgmt, int group) {
+	return HEADER_PAGES + (off_t)group * (PAGES_PER_MAP(mgmt) + 1);
+}
+
+// Physical length, in pages, of a file holding numPages data pages.
+static off_t physicalLength (SM_FileMgmt *mgmt, int numPages) {
+	if(numPages == 0)
+		return HEADER_PAGES + 1;
+	return physicalPage(mgmt, numPages - 1) + 1;
+}
+
+// Number of data pages in a file of the given size; the inverse of physicalLength.
+static int logicalPages (SM_FileMgmt *mgmt, off_t fileSize) {
+	off_t pages = fileSize / mgmt->pageSize - HEADER_PAGES;
+	if(pages <= 0)
+		return 0;
+
+	off_t fullGroups = pages / (PAGES_PER_MAP(mgmt) + 1);
+	off_t rest = pages % (PAGES_PER_MAP(mgmt) + 1);
+	return fullGroups * PAGES_PER_MAP(mgmt) + (rest > 0 ? rest - 1 : 0);
+}
+
+// Page sizes are powers of two between SM_MIN_PAGE_SIZE and SM_MAX_PAGE_SIZE, which also
+// keeps every page aligned for O_DIRECT.
+static int isValidPageSize (int pageSize) {
+	return pageSize >= SM_MIN_PAGE_SIZE && pageSize <= SM_MAX_PAGE_SIZE && (pageSize & (pageSize - 1)) == 0;
+}
+
+// Reading exactly 'length' bytes at 'offset', retrying on short reads and signals.
+static ssize_t readFully (int fd, char *buffer, size_t length, off_t offset) {
+	size_t done = 0;
+	while(done < length) {
+		ssize_t n = pread(fd, buffer + done, length - done, offset + done);
+		if(n < 0) {
+			if(errno == EINTR)
+				continue;
+			return -1;
+		}
+		if(n == 0)
+			break;
+		done += n;
+	}
+	return done;
+}
+
+// Writing exactly 'length' bytes at 'offset', retrying on short writes and signals.
+static ssize_t writeFully (int fd, const char *buffer, size_t length, off_t offset) {
+	size_t done = 0;
+	while(done < length) {
+		ssize_t n = pwrite(fd, buffer + done, length - done, offset + done);
+		if(n < 0) {
+			if(errno == EINTR)
+				continue;
+			return -1;
+		}
+		done += n;
+	}
+	return done;
+}
+
+// Vectored counterpart of readFully/writeFully. The iovec array is consumed in place as
+// partial transfers advance, so callers must not reuse it afterwards.
+static ssize_t transferVectorFully (int fd, struct iovec *iov, int iovcnt, off_t offset, int isWrite) {
+	size_t done = 0;
+	while(iovcnt > 0) {
+		ssize_t n = isWrite ? pwritev(fd, iov, iovcnt, offset + done) : preadv(fd, iov, iovcnt, offset + done);
+		if(n < 0) {
+			if(errno == EINTR)
+				continue;
+			return -1;
+		}
+		if(n == 0)
+			break;
+		done += n;
+
+		// Skipping the buffers that were completely transferred and trimming a partial one.
+		while(iovcnt > 0 && (size_t)n >= iov->iov_len) {
+			n -= iov->iov_len;
+			iov++;
+			iovcnt--;
+		}
+		if(iovcnt > 0) {
+			iov->iov_base = (char *)iov->iov_base + n;
+			iov->iov_len -= n;
+		}
+	}
+	return done;
+}
+
+// Moving numPages consecutive pages starting at startPageNum between the file and the
+// scattered page buffers, at most IOV_MAX pages per system call. The pages must not
+// cross a bitmap page, so they are also consecutive in the file.
+static RC transferRun (int startPageNum, int numPages, SM_FileMgmt *mgmt, SM_PageHandle *memPages, int isWrite) {
+	off_t firstPage = physicalPage(mgmt, startPageNum);
+	int pageSize = mgmt->pageSize;
+	struct iovec iov[IOV_MAX];
+	int done = 0;
+
+	// A mapped file is just memory; the caller already checked the range against the mapping.
+	if(mgmt->map != NULL) {
+		int i;
+		for(i = 0; i < numPages; i++) {
+			char *pageInMap = mgmt->map + (size_t)(firstPage + i) * pageSize;
+			if(isWrite)
+				memcpy(pageInMap, memPages[i], pageSize);
+			else
+				memcpy(memPages[i], pageInMap, pageSize);
+		}
 		return RC_OK;
 	}
+
+	// O_DIRECT rejects unaligned buffers, so those pages go through an aligned copy one by one.
+	if(mgmt->direct) {
+		int i, allAligned = 1;
+		for(i = 0; i < numPages && allAligned; i++)
+			allAligned = isAligned(memPages[i]);
+
+		if(!allAligned) {
+			SM_PageHandle bounce = allocPageBuffersOfSize(1, pageSize);
+			RC rc = RC_OK;
+			if(bounce == NULL)
+				return RC_ERROR;
+
+			for(i = 0; i < numPages && rc == RC_OK; i++) {
+				off_t offset = (firstPage + i) * pageSize;
+				if(isWrite) {
+					memcpy(bounce, memPages[i], pageSize);
+					if(writeFully(mgmt->fd, bounce, pageSize, offset) != pageSize)
+						rc = RC_WRITE_FAILED;
+				} else {
+					if(readFully(mgmt->fd, bounce, pageSize, offset) != pageSize)
+						rc = RC_ERROR;
+					else
+						memcpy(memPages[i], bounce, pageSize);
+				}
+			}
+			freePageBuffers(bounce);
+			return rc;
+		}
+	}
+
+	while(done < numPages) {
+		int batch = numPages - done;
+		if(batch > IOV_MAX)
+			batch = IOV_MAX;
+
+		int i;
+		for(i = 0; i < batch; i++) {
+			iov[i].iov_base = memPages[done + i];
+			iov[i].iov_len = pageSize;
+		}
+
+		ssize_t expected = (ssize_t)batch * pageSize;
+		if(transferVectorFully(mgmt->fd, iov, batch, (firstPage + done) * pageSize, isWrite) != expected)
+			return isWrite ? RC_WRITE_FAILED : RC_ERROR;
+		done += batch;
+	}
+	return RC_OK;
 }
 
-extern RC openPageFile (char *fileName, SM_FileHandle *fHandle) {
-	// Opening file stream in read mode. 'r' mode creates an empty file for reading only.
-	pageFile = fopen(fileName, "r");
+// Moving numPages consecutive data pages, one run per group of pages between two bitmap pages.
+static RC transferBlocks (int startPageNum, int numPages, SM_FileMgmt *mgmt, SM_PageHandle *memPages, int isWrite) {
+	int done = 0;
 
-	// Checking if file was successfully opened.
-	if(pageFile == NULL) {
-		return RC_FILE_NOT_FOUND;
-	} else { 
-		// Updating file handle's filename and set the current position to the start of the page.
-		fHandle->fileName = fileName;
-		fHandle->curPagePos = 0;
-
-		/* In order to calculate the total size, we perform following steps -
-		   1. Move the position of the file stream to the end of file
-		   2. Check the file end position
-		   3. Move the position of the file stream to the beginning of file  
-		
-		fseek(pageFile, 0L, SEEK_END);
-		int totalSize = ftell(pageFile);
-		fseek(pageFile, 0L, SEEK_SET);
-		fHandle->totalNumPages = totalSize/ PAGE_SIZE;  */
-		
-		/* Using fstat() to get the file total size.
-		   fstat() is a system call that is used to determine information about a file based on its file descriptor.
-		   'st_size' member variable of the 'stat' structure gives the total size of the file in bytes.
-		*/
-
-		struct stat fileInfo;
-		if(fstat(fileno(pageFile), &fileInfo) < 0)    
-			return RC_ERROR;
-		fHandle->totalNumPages = fileInfo.st_size/ PAGE_SIZE;
+	// Pages read ahead must not outlive a write to them.
+	if(isWrite && mgmt->readAheadCount > 0 && startPageNum < mgmt->readAheadStart + mgmt->readAheadCount
+			&& startPageNum + numPages > mgmt->readAheadStart)
+		mgmt->readAheadCount = 0;
 
-		// Closing file stream so that all the buffers are flushed. 
-		fclose(pageFile);
+	// Segment pages go to the tablespace, one run per extent.
+	if(mgmt->space != NULL) {
+		SM_FileMgmt *spaceMgmt = getFileMgmt(&mgmt->space->fHandle);
+		while(done < numPages) {
+			int run;
+			int page = segmentPage(mgmt->segment, startPageNum + done, &run);
+			if(page < 0)
+				return isWrite ? RC_WRITE_FAILED : RC_READ_NON_EXISTING_PAGE;
+			if(run > numPages - done)
+				run = numPages - done;
+
+			RC rc = transferBlocks(page, run, spaceMgmt, memPages + done, isWrite);
+			if(rc != RC_OK)
+				return rc;
+			done += run;
+		}
 		return RC_OK;
 	}
+
+	while(done < numPages) {
+		int pageNum = startPageNum + done;
+		int run = PAGES_PER_MAP(mgmt) - pageNum % PAGES_PER_MAP(mgmt);
+		if(run > numPages - done)
+			run = numPages - done;
+
+		RC rc = transferRun(pageNum, run, mgmt, memPages + done, isWrite);
+		if(rc != RC_OK)
+			return rc;
+		done += run;
+	}
+	return RC_OK;
 }
 
-extern RC closePageFile (SM_FileHandle *fHandle) {
-	// Checking if file pointer or the storage manager is intialised. If initialised, then close.
-	if(pageFile != NULL)
-		pageFile = NULL;	
-	return RC_OK; 
+// Releasing the readahead buffer; it is allocated again by the next sequential reader.
+static void freeReadAhead (SM_FileMgmt *mgmt) {
+	freePageBuffers(mgmt->readAhead);
+	free(mgmt->readAheadPages);
+	mgmt->readAhead = NULL;
+	mgmt->readAheadPages = NULL;
+	mgmt->readAheadCount = 0;
 }
 
+// Hinting the kernel to start reading numPages pages from pageNum, so the next window is
+// already in the page cache when the reader gets there.
+static void adviseWillNeed (SM_FileMgmt *mgmt, int pageNum, int numPages) {
+	SM_FileMgmt *fileMgmt = mgmt;
+	int contiguous = numPages;
 
-extern RC destroyPageFile (char *fileName) {
-	// Opening file stream in read mode. 'r' mode creates an empty file for reading only.	
-	pageFile = fopen(fileName, "r");
-	
-	if(pageFile == NULL)
-		return RC_FILE_NOT_FOUND; 
-	
-	// Deleting the given filename so that it is no longer accessible.	
-	remove(fileName);
+	// Segments only advise the part of the window inside the current extent.
+	if(mgmt->space != NULL) {
+		pageNum = segmentPage(mgmt->segment, pageNum, &contiguous);
+		if(pageNum < 0)
+			return;
+		fileMgmt = getFileMgmt(&mgmt->space->fHandle);
+	}
+	if(contiguous > numPages)
+		contiguous = numPages;
+
+	posix_fadvise(fileMgmt->fd, physicalPage(fileMgmt, pageNum) * fileMgmt->pageSize,
+			(off_t)contiguous * fileMgmt->pageSize, POSIX_FADV_WILLNEED);
+}
+
+// Filling the readahead buffer with the window of pages starting at pageNum, or as many
+// of them as the file has, and advising the kernel about the window after it.
+static RC fillReadAhead (SM_FileHandle *fHandle, SM_FileMgmt *mgmt, int pageNum) {
+	int window = mgmt->readAheadWindow;
+
+	if(mgmt->readAhead == NULL) {
+		mgmt->readAhead = allocPageBuffersOfSize(window, mgmt->pageSize);
+		mgmt->readAheadPages = (SM_PageHandle *)malloc(window * sizeof(SM_PageHandle));
+		if(mgmt->readAhead == NULL || mgmt->readAheadPages == NULL) {
+			freeReadAhead(mgmt);
+			return RC_ERROR;
+		}
+
+		int i;
+		for(i = 0; i < window; i++)
+			mgmt->readAheadPages[i] = mgmt->readAhead + (size_t)i * mgmt->pageSize;
+	}
+
+	int count = fHandle->totalNumPages - pageNum;
+	if(count > window)
+		count = window;
+
+	mgmt->readAheadCount = 0;
+	RC rc = transferBlocks(pageNum, count, mgmt, mgmt->readAheadPages, 0);
+	if(rc != RC_OK)
+		return rc;
+	mgmt->readAheadStart = pageNum;
+	mgmt->readAheadCount = count;
+
+	if(pageNum + count < fHandle->totalNumPages)
+		adviseWillNeed(mgmt, pageNum + count, window);
 	return RC_OK;
 }
 
-extern RC readBlock (int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage) {
-	// Checking if the pageNumber parameter is less than Total number of pages and less than 0, then return respective error code
-	if (pageNum > fHandle->totalNumPages || pageNum < 0)
-        	return RC_READ_NON_EXISTING_PAGE;
+// Making sure freeMap has a bitmap page for every group holding one of numPages pages.
+// New bitmap pages start out zeroed, like the pages growth leaves in the file.
+static RC ensureMaps (SM_FileMgmt *mgmt, int numPages) {
+	int needed = (numPages + PAGES_PER_MAP(mgmt) - 1) / PAGES_PER_MAP(mgmt);
+	if(needed < 1)
+		needed = 1;
+	if(needed <= mgmt->numMaps)
+		return RC_OK;
 
-	// Opening file stream in read mode. 'r' mode opens file for reading only.	
-	pageFile = fopen(fHandle->fileName, "r");
+	// Keeping the bitmaps in aligned memory so they can be written to direct handles as they are.
+	unsigned char *maps = (unsigned char *)allocPageBuffersOfSize(needed, mgmt->pageSize);
+	if(maps == NULL)
+		return RC_ERROR;
+	if(mgmt->numMaps > 0)
+		memcpy(maps, mgmt->freeMap, (size_t)mgmt->numMaps * mgmt->pageSize);
+	memset(maps + (size_t)mgmt->numMaps * mgmt->pageSize, 0, (size_t)(needed - mgmt->numMaps) * mgmt->pageSize);
 
-	// Checking if file was successfully opened.
-	if(pageFile == NULL)
-		return RC_FILE_NOT_FOUND;
-	
-	// Setting the cursor(pointer) position of the file stream. Position is calculated by Page Number x Page Size
-	// And the seek is success if fseek() return 0
-	int isSeekSuccess = fseek(pageFile, (pageNum * PAGE_SIZE), SEEK_SET);
-	if(isSeekSuccess == 0) {
-		// We're reading the content and storing it in the location pointed out by memPage.
-		if(fread(memPage, sizeof(char), PAGE_SIZE, pageFile) < PAGE_SIZE)
+	freePageBuffers((SM_PageHandle)mgmt->freeMap);
+	mgmt->freeMap = maps;
+	mgmt->numMaps = needed;
+	return RC_OK;
+}
+
+// Writing the bitmap page covering pageNum back to the file.
+static RC writeMap (SM_FileMgmt *mgmt, int pageNum) {
+	int group = pageNum / PAGES_PER_MAP(mgmt);
+	char *bitmap = (char *)mgmt->freeMap + (size_t)group * mgmt->pageSize;
+
+	if(writeFully(mgmt->fd, bitmap, mgmt->pageSize, mapPage(mgmt, group) * mgmt->pageSize) != mgmt->pageSize)
+		return RC_WRITE_FAILED;
+	return RC_OK;
+}
+
+// Loading every bitmap page of a file with numPages data pages and counting the free pages.
+static RC loadMaps (SM_FileMgmt *mgmt, int numPages) {
+	RC rc = ensureMaps(mgmt, numPages);
+	if(rc != RC_OK)
+		return rc;
+
+	int group, i;
+	for(group = 0; group < mgmt->numMaps; group++) {
+		char *bitmap = (char *)mgmt->freeMap + (size_t)group * mgmt->pageSize;
+		// A bitmap page past the end of the file has never been written and stays zero.
+		if(readFully(mgmt->fd, bitmap, mgmt->pageSize, mapPage(mgmt, group) * mgmt->pageSize) < 0)
 			return RC_ERROR;
-	} else {
-		return RC_READ_NON_EXISTING_PAGE; 
 	}
-    	
-	// Setting the current page position to the cursor(pointer) position of the file stream
-	fHandle->curPagePos = ftell(pageFile); 
-	
-	// Closing file stream so that all the buffers are flushed.     	
-	fclose(pageFile);
-	
-    	return RC_OK;
-}
 
-extern int getBlockPos (SM_FileHandle *fHandle) {
-	// Returning the current page position retrieved from the file handle	
-	return fHandle->curPagePos;
+	mgmt->numFree = 0;
+	for(i = 0; i < mgmt->numMaps * mgmt->pageSize; i++)
+		mgmt->numFree += __builtin_popcount(mgmt->freeMap[i]);
+	mgmt->freeHint = 0;
+	return RC_OK;
 }
 
-extern RC readFirstBlock (SM_FileHandle *fHandle, SM_PageHandle memPage) {
-	// Opening file stream in read mode. 'r' mode opens the file for reading only.	
-	pageFile = fopen(fHandle->fileName, "r");
-	
-	// Checking if file was successfully opened.
-	if(pageFile == NULL)
-		return RC_FILE_NOT_FOUND;
+// Marking numPages pages from start free or in use, in memory and in the bitmap pages.
+static RC markPages (SM_FileMgmt *mgmt, int start, int numPages, int isFree) {
+	int pageNum, group;
 
-	int i;
-	for(i = 0; i < PAGE_SIZE; i++) {
-		// Reading a single character from the file
-		char c = fgetc(pageFile);
-	
-		// Checking if we have reached the end of file
-		if(feof(pageFile))
-			break;
+	for(pageNum = start; pageNum < start + numPages; pageNum++) {
+		unsigned char bit = 1 << (pageNum % 8);
+		if(isFree)
+			mgmt->freeMap[pageNum / 8] |= bit;
 		else
-			memPage[i] = c;
+			mgmt->freeMap[pageNum / 8] &= ~bit;
 	}
 
-	// Setting the current page position to the cursor(pointer) position of the file stream
-	fHandle->curPagePos = ftell(pageFile); 
+	// Writing every bitmap page the range touches; a failure leaves the bits as they were.
+	for(group = start / PAGES_PER_MAP(mgmt); group <= (start + numPages - 1) / PAGES_PER_MAP(mgmt); group++) {
+		if(writeMap(mgmt, group * PAGES_PER_MAP(mgmt)) != RC_OK) {
+			for(pageNum = start; pageNum < start + numPages; pageNum++)
+				mgmt->freeMap[pageNum / 8] ^= 1 << (pageNum % 8);
+			return RC_WRITE_FAILED;
+		}
+	}
 
-	// Closing file stream so that all the buffers are flushed.
-	fclose(pageFile);
+	mgmt->numFree += isFree ? numPages : -numPages;
+	if(isFree && start < mgmt->freeHint)
+		mgmt->freeHint = start;
 	return RC_OK;
 }
 
-extern RC readPreviousBlock (SM_FileHandle *fHandle, SM_PageHandle memPage) {
-	//printf("CURRENT PAGE POSITION = %d \n", fHandle->curPagePos);
-	//printf("TOTAL PAGES = %d \n", fHandle->totalNumPages)
-
-	// Checking if we are on the first block because there's no other previous block to read
-	if(fHandle->curPagePos <= PAGE_SIZE) {
-		printf("\n First block: Previous block not present.");
-		return RC_READ_NON_EXISTING_PAGE;	
-	} else {
-		// Calculating current page number by dividing page size by current page position	
-		int currentPageNumber = fHandle->curPagePos / PAGE_SIZE;
-		int startPosition = (PAGE_SIZE * (currentPageNumber - 2));
-
-		// Opening file stream in read mode. 'r' mode opens the file for reading only.	
-		pageFile = fopen(fHandle->fileName, "r");
-		
-		// Checking if file was successfully opened.
-		if(pageFile == NULL)
-			return RC_FILE_NOT_FOUND;
+// Overwriting numPages pages from start with zeros, so reused pages look freshly appended.
+static RC zeroPages (SM_FileMgmt *mgmt, int start, int numPages) {
+	SM_PageHandle emptyPage = allocPageBuffersOfSize(1, mgmt->pageSize);
+	SM_PageHandle *memPages = (SM_PageHandle *)malloc(numPages * sizeof(SM_PageHandle));
+	RC rc = RC_ERROR;
 
-		// Initializing file pointer position.
-		fseek(pageFile, startPosition, SEEK_SET);
-		
+	if(emptyPage != NULL && memPages != NULL) {
 		int i;
-		// Reading block character by character and storing it in memPage
-		for(i = 0; i < PAGE_SIZE; i++) {
-			memPage[i] = fgetc(pageFile);
-		}
+		memset(emptyPage, 0, mgmt->pageSize);
+		for(i = 0; i < numPages; i++)
+			memPages[i] = emptyPage;
+		rc = transferBlocks(start, numPages, mgmt, memPages, 1);
+	}
+	free(memPages);
+	freePageBuffers(emptyPage);
+	return rc;
+}
 
-		// Setting the current page position to the cursor(pointer) position of the file stream
-		fHandle->curPagePos = ftell(pageFile); 
+// Making sure disk space is reserved for the first numPages physical pages. Space is reserved a
+// whole extent at a time with fallocate(FALLOC_FL_KEEP_SIZE), which leaves the file size,
+// and with it the logical page count, untouched. File systems without fallocate simply
+// get their blocks allocated by the writes themselves.
+static void reserveExtents (SM_FileMgmt *mgmt, int numPages) {
+	if(numPages <= mgmt->allocatedPages)
+		return;
+
+	// Rounding the reservation up to the next extent boundary.
+	int target = ((numPages + mgmt->extentPages - 1) / mgmt->extentPages) * mgmt->extentPages;
+	off_t start = (off_t)mgmt->allocatedPages * mgmt->pageSize;
+	off_t length = (off_t)(target - mgmt->allocatedPages) * mgmt->pageSize;
+
+	if(fallocate(mgmt->fd, FALLOC_FL_KEEP_SIZE, start, length) == 0)
+		mgmt->allocatedPages = target;
+	else
+		mgmt->allocatedPages = numPages;
+}
 
-		// Closing file stream so that all the buffers are flushed.
-		fclose(pageFile);
+// Growing the file to newNumPages data pages of zeros with a single ftruncate() inside the
+// reserved extents; the new pages count as in use. Mapped handles follow it with mremap(),
+// which may move the mapping. Segments grow inside their tablespace instead.
+static RC growFile (SM_FileHandle *fHandle, SM_FileMgmt *mgmt, int newNumPages) {
+	if(newNumPages <= fHandle->totalNumPages)
 		return RC_OK;
+
+	if(mgmt->space != NULL)
+		return growSegment(fHandle, mgmt, newNumPages);
+
+	RC rc = ensureMaps(mgmt, newNumPages);
+	if(rc != RC_OK)
+		return rc;
+
+	off_t newPhysicalPages = physicalLength(mgmt, newNumPages);
+	reserveExtents(mgmt, newPhysicalPages);
+
+	size_t newLength = (size_t)newPhysicalPages * mgmt->pageSize;
+	if(ftruncate(mgmt->fd, newLength) != 0)
+		return RC_WRITE_FAILED;
+
+	if(mgmt->mapped) {
+		char *newMap;
+		if(mgmt->map == NULL)
+			newMap = mmap(NULL, newLength, PROT_READ | PROT_WRITE, MAP_SHARED, mgmt->fd, 0);
+		else
+			newMap = mremap(mgmt->map, mgmt->mapLength, newLength, MREMAP_MAYMOVE);
+		if(newMap == MAP_FAILED)
+			return RC_ERROR;
+
+		mgmt->map = newMap;
+		mgmt->mapLength = newLength;
 	}
+
+	fHandle->totalNumPages = newNumPages;
+	return RC_OK;
 }
 
-extern RC readCurrentBlock (SM_FileHandle *fHandle, SM_PageHandle memPage) {
-	// Calculating current page number by dividing page size by current page position	
-	int currentPageNumber = fHandle->curPagePos / PAGE_SIZE;
-	int startPosition = (PAGE_SIZE * (currentPageNumber - 2));
-	
-	// Opening file stream in read mode. 'r' mode opens the file for reading only.	
-	pageFile = fopen(fHandle->fileName, "r");
+// Opening fileName for reading and writing and, as openMode asks, mapping its pages
+// or bypassing the page cache.
+static RC openHandle (char *fileName, SM_FileHandle *fHandle, int openMode) {
+	int mapped = (openMode & OPEN_MAPPED) != 0;
+	int direct = (openMode & OPEN_DIRECT) != 0;
+
+	// A handle that failed to open must not look initialised to closePageFile.
+	fHandle->mgmtInfo = NULL;
+
+	// Opening the file for reading and writing; it stays open until closePageFile.
+	int fd = open(fileName, O_RDWR | (direct ? O_DIRECT : 0));
+
+	// File systems without O_DIRECT support refuse the flag rather than the file.
+	if(fd < 0 && direct && errno == EINVAL)
+		return RC_ERROR;
 
 	// Checking if file was successfully opened.
-	if(pageFile == NULL)
+	if(fd < 0)
 		return RC_FILE_NOT_FOUND;
 
-	// Initializing file pointer position.
-	fseek(pageFile, startPosition, SEEK_SET);
-	
-	int i;
-	// Reading block character by character and storing it in memPage.
-	// Also checking if we have reahed end of file.
-	for(i = 0; i < PAGE_SIZE; i++) {
-		char c = fgetc(pageFile);		
-		if(feof(pageFile))
-			break;
-		memPage[i] = c;
+	/* Using fstat() to get the file total size.
+	   'st_size' member variable of the 'stat' structure gives the total size of the file in bytes.
+	*/
+	struct stat fileInfo;
+	if(fstat(fd, &fileInfo) < 0) {
+		close(fd);
+		return RC_ERROR;
+	}
+
+	// Checking that this is a page file written by createPageFile. The header fits in the
+	// smallest page size, so that much can be read before the page size is known.
+	SM_FileHeader *header = (SM_FileHeader *)allocPageBuffersOfSize(1, SM_MIN_PAGE_SIZE);
+	int validHeader = header != NULL
+		&& readFully(fd, (char *)header, SM_MIN_PAGE_SIZE, 0) == SM_MIN_PAGE_SIZE
+		&& memcmp(header->magic, SM_FILE_MAGIC, sizeof(header->magic)) == 0
+		&& header->version == SM_FILE_VERSION
+		&& isValidPageSize(header->pageSize);
+	int pageSize = validHeader ? header->pageSize : 0;
+	freePageBuffers((SM_PageHandle)header);
+	if(!validHeader) {
+		close(fd);
+		return RC_INVALID_PAGE_FILE;
+	}
+
+	SM_FileMgmt *mgmt = (SM_FileMgmt *)calloc(1, sizeof(SM_FileMgmt));
+	if(mgmt == NULL) {
+		close(fd);
+		return RC_ERROR;
+	}
+	mgmt->fd = fd;
+	mgmt->pageSize = pageSize;
+	mgmt->mapped = mapped;
+	mgmt->direct = direct;
+	mgmt->extentPages = SM_DEFAULT_EXTENT_PAGES;
+	mgmt->readAheadWindow = SM_DEFAULT_READAHEAD_PAGES;
+	mgmt->lastRead = INT_MIN;	// No page read yet, so page 0 is not a continuation
+	mgmt->allocatedPages = fileInfo.st_size / pageSize;
+
+	int numPages = logicalPages(mgmt, fileInfo.st_size);
+	RC rc = loadMaps(mgmt, numPages);
+
+	// Mapping the whole file, header and bitmap pages included.
+	if(rc == RC_OK && mapped) {
+		mgmt->mapLength = (size_t)(fileInfo.st_size / pageSize) * pageSize;
+		mgmt->map = mmap(NULL, mgmt->mapLength, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		if(mgmt->map == MAP_FAILED) {
+			mgmt->map = NULL;
+			rc = RC_ERROR;
+		}
+	}
+	if(rc != RC_OK) {
+		close(fd);
+		freePageBuffers((SM_PageHandle)mgmt->freeMap);
+		free(mgmt);
+		return rc;
 	}
-	
-	// Setting the current page position to the cursor(pointer) position of the file stream
-	fHandle->curPagePos = ftell(pageFile); 
 
-	// Closing file stream so that all the buffers are flushed.
-	fclose(pageFile);
-	return RC_OK;		
+	// Updating file handle's filename and set the current position to the start of the file.
+	fHandle->fileName = fileName;
+	fHandle->curPagePos = 0;
+	fHandle->totalNumPages = numPages;
+	fHandle->mgmtInfo = mgmt;
+	return RC_OK;
 }
 
-extern RC readNextBlock (SM_FileHandle *fHandle, SM_PageHandle memPage){
-	// Checking if we are on the last block because there's no next block to read
-	if(fHandle->curPagePos == PAGE_SIZE) {
-		printf("\n Last block: Next block not present.");
-		return RC_READ_NON_EXISTING_PAGE;	
-	} else {
-		// Calculating current page number by dividing page size by current page position	
-		int currentPageNumber = fHandle->curPagePos / PAGE_SIZE;
-		int startPosition = (PAGE_SIZE * (currentPageNumber - 2));
-
-		// Opening file stream in read mode. 'r' mode opens the file for reading only.	
-		pageFile = fopen(fHandle->fileName, "r");
-		
-		// Checking if file was successfully opened.
-		if(pageFile == NULL)
-			return RC_FILE_NOT_FOUND;
-		
-		// Initializing file pointer position.
-		fseek(pageFile, startPosition, SEEK_SET);
-		
-		int i;
-		// Reading block character by character and storing it in memPage.
-		// Also checking if we have reahed end of file.
-		for(i = 0; i < PAGE_SIZE; i++) {
-			char c = fgetc(pageFile);		
-			if(feof(pageFile))
-				break;
-			memPage[i] = c;
+// Splitting "tablespace:segment" into its two parts. Returns 0 for plain file names.
+static int splitSegmentName (char *fileName, char **spaceName, char **segmentName) {
+	char *separator = strrchr(fileName, ':');
+	if(separator == NULL)
+		return 0;
+
+	*spaceName = strndup(fileName, separator - fileName);
+	*segmentName = separator + 1;
+	return 1;
+}
+
+// Writing an empty directory page as data page 0 of a freshly created page file.
+static RC initDirectory (char *spaceName) {
+	SM_FileHandle fHandle;
+	RC rc = openPageFile(spaceName, &fHandle);
+	if(rc != RC_OK)
+		return rc;
+
+	SM_PageHandle page = allocPageBuffersOfSize(1, getPageSize(&fHandle));
+	if(page == NULL)
+		rc = RC_ERROR;
+	else {
+		memset(page, 0, getPageSize(&fHandle));
+		memcpy(((SM_DirectoryPage *)page)->magic, SM_DIRECTORY_MAGIC, 8);
+		rc = writeBlock(0, &fHandle, page);
+	}
+	freePageBuffers(page);
+
+	RC closeRc = closePageFile(&fHandle);
+	return rc != RC_OK ? rc : closeRc;
+}
+
+// Taking a reference on the tablespace stored in spaceName, opening it in openMode if it is
+// not open yet. With a non-zero createPageSize, a missing tablespace is created first with
+// pages of that size.
+static RC acquireTableSpace (char *spaceName, int openMode, int createPageSize, SM_TableSpace **result) {
+	SM_TableSpace *space;
+	for(space = openTableSpaces; space != NULL; space = space->next) {
+		if(strcmp(space->fileName, spaceName) == 0) {
+			space->refCount++;
+			*result = space;
+			return RC_OK;
 		}
+	}
+
+	RC rc;
+	if(createPageSize != 0 && access(spaceName, F_OK) != 0) {
+		if((rc = createPageFileWithPageSize(spaceName, createPageSize)) != RC_OK || (rc = initDirectory(spaceName)) != RC_OK)
+			return rc;
+	}
 
-		// Setting the current page position to the cursor(pointer) position of the file stream
-		fHandle->curPagePos = ftell(pageFile); 
+	space = (SM_TableSpace *)calloc(1, sizeof(SM_TableSpace));
+	if(space == NULL)
+		return RC_ERROR;
+	space->fileName = strdup(spaceName);
+	if((rc = openHandle(space->fileName, &space->fHandle, openMode)) != RC_OK) {
+		free(space->fileName);
+		free(space);
+		return rc;
+	}
+
+	// Only page files starting with a directory page are tablespaces.
+	SM_PageHandle page = allocPageBuffersOfSize(1, getPageSize(&space->fHandle));
+	if(page == NULL || readBlock(0, &space->fHandle, page) != RC_OK
+			|| memcmp(((SM_DirectoryPage *)page)->magic, SM_DIRECTORY_MAGIC, 8) != 0)
+		rc = RC_INVALID_PAGE_FILE;
+	freePageBuffers(page);
+	if(rc != RC_OK) {
+		closePageFile(&space->fHandle);
+		free(space->fileName);
+		free(space);
+		return rc;
+	}
+
+	space->refCount = 1;
+	space->next = openTableSpaces;
+	openTableSpaces = space;
+	*result = space;
+	return RC_OK;
+}
 
-		// Closing file stream so that all the buffers are flushed.
-		fclose(pageFile);
+// Dropping a reference on a tablespace and closing it with the last one.
+static RC releaseTableSpace (SM_TableSpace *space) {
+	if(--space->refCount > 0)
 		return RC_OK;
+
+	SM_TableSpace **link = &openTableSpaces;
+	while(*link != space)
+		link = &(*link)->next;
+	*link = space->next;
+
+	RC rc = closePageFile(&space->fHandle);
+	free(space->fileName);
+	free(space);
+	return rc;
+}
+
+// Looking a segment up in the directory. On success *dirPage and *slot locate its entry;
+// otherwise *dirPage and *slot locate the first empty entry, or *dirPage is the last
+// directory page and *slot is -1 when every entry is taken.
+static RC findSegment (SM_TableSpace *space, char *segmentName, SM_PageHandle page, int *dirPage, int *slot) {
+	SM_DirectoryPage *directory = (SM_DirectoryPage *)page;
+	int pageNum = 0, freePageNum = -1, freeSlot = -1;
+
+	while(1) {
+		RC rc = readBlock(pageNum, &space->fHandle, page);
+		if(rc != RC_OK)
+			return rc;
+
+		int i;
+		for(i = 0; i < DIRECTORY_ENTRIES(getPageSize(&space->fHandle)); i++) {
+			SM_DirectoryEntry *entry = &directory->entries[i];
+			if(entry->headerPage != 0 && strcmp(entry->name, segmentName) == 0) {
+				*dirPage = pageNum;
+				*slot = i;
+				return RC_OK;
+			}
+			if(entry->headerPage == 0 && freePageNum < 0) {
+				freePageNum = pageNum;
+				freeSlot = i;
+			}
+		}
+
+		if(directory->nextPage == 0)
+			break;
+		pageNum = directory->nextPage;
+	}
+
+	*dirPage = freePageNum >= 0 ? freePageNum : pageNum;
+	*slot = freeSlot;
+	return RC_FILE_NOT_FOUND;
+}
+
+// Finding numPages consecutive free tablespace pages, or -1 if there is no such run.
+static int findFreeRun (SM_FileMgmt *mgmt, int totalNumPages, int numPages) {
+	int pageNum, run = 0;
+
+	if(mgmt->numFree < numPages)
+		return -1;
+	for(pageNum = mgmt->freeHint; pageNum < totalNumPages; pageNum++) {
+		if(mgmt->freeMap[pageNum / 8] & (1 << (pageNum % 8))) {
+			if(++run == numPages)
+				return pageNum - numPages + 1;
+		} else
+			run = 0;
 	}
+	return -1;
 }
 
-extern RC readLastBlock (SM_FileHandle *fHandle, SM_PageHandle memPage){
-	// Opening file stream in read mode. 'r' mode opens the file for reading only.	
-	pageFile = fopen(fHandle->fileName, "r");
+// Giving a segment room for newNumPages pages. Extents start at the segment's extent size
+// and double with the segment up to MAX_SEGMENT_EXTENT_PAGES; each is taken from freed
+// tablespace pages if a long enough run exists, otherwise from the end of the tablespace.
+static RC growSegment (SM_FileHandle *fHandle, SM_FileMgmt *mgmt, int newNumPages) {
+	SM_FileHandle *spaceHandle = &mgmt->space->fHandle;
+	SM_FileMgmt *spaceMgmt = getFileMgmt(spaceHandle);
+	SM_SegmentHeader *segment = mgmt->segment;
+	int i, capacity = 0;
+	RC rc;
 
-	// Checking if file was successfully opened.
-	if(pageFile == NULL)
+	for(i = 0; i < segment->numExtents; i++)
+		capacity += segment->extents[i].length;
+
+	while(capacity < newNumPages) {
+		int length = capacity < MAX_SEGMENT_EXTENT_PAGES ? capacity : MAX_SEGMENT_EXTENT_PAGES;
+		if(length < mgmt->extentPages)
+			length = mgmt->extentPages;
+		if(length < newNumPages - capacity)
+			length = newNumPages - capacity;
+
+		int start = findFreeRun(spaceMgmt, spaceHandle->totalNumPages, length);
+		if(start >= 0) {
+			if((rc = zeroPages(spaceMgmt, start, length)) != RC_OK || (rc = markPages(spaceMgmt, start, length, 0)) != RC_OK)
+				return rc;
+		} else {
+			start = spaceHandle->totalNumPages;
+			if((rc = growFile(spaceHandle, spaceMgmt, start + length)) != RC_OK)
+				return rc;
+		}
+
+		// Extending the last extent when the new one follows it directly.
+		SM_Extent *last = segment->numExtents > 0 ? &segment->extents[segment->numExtents - 1] : NULL;
+		if(last != NULL && last->start + last->length == start)
+			last->length += length;
+		else if(segment->numExtents < MAX_SEGMENT_EXTENTS(spaceMgmt->pageSize)) {
+			segment->extents[segment->numExtents].start = start;
+			segment->extents[segment->numExtents].length = length;
+			segment->numExtents++;
+		} else {
+			markPages(spaceMgmt, start, length, 1);
+			return RC_WRITE_FAILED;
+		}
+		capacity += length;
+	}
+
+	segment->numPages = newNumPages;
+	rc = transferBlocks(mgmt->headerPage, 1, spaceMgmt, (SM_PageHandle *)&mgmt->segment, 1);
+	if(rc != RC_OK)
+		return rc;
+
+	fHandle->totalNumPages = newNumPages;
+	return RC_OK;
+}
+
+// Opening segment segmentName of tablespace spaceName; mapped and direct access follow
+// the mode the tablespace was first opened in.
+static RC openSegment (char *fileName, char *spaceName, char *segmentName, SM_FileHandle *fHandle, int openMode) {
+	SM_TableSpace *space;
+	RC rc = acquireTableSpace(spaceName, openMode, 0, &space);
+	if(rc != RC_OK)
+		return rc;
+
+	SM_PageHandle page = allocPageBuffersOfSize(1, getPageSize(&space->fHandle));
+	SM_FileMgmt *mgmt = (SM_FileMgmt *)calloc(1, sizeof(SM_FileMgmt));
+	int dirPage, slot;
+	if(page == NULL || mgmt == NULL)
+		rc = RC_ERROR;
+	else if((rc = findSegment(space, segmentName, page, &dirPage, &slot)) == RC_OK) {
+		mgmt->headerPage = ((SM_DirectoryPage *)page)->entries[slot].headerPage;
+		rc = readBlock(mgmt->headerPage, &space->fHandle, page);
+	}
+	if(rc != RC_OK) {
+		freePageBuffers(page);
+		free(mgmt);
+		releaseTableSpace(space);
+		return rc;
+	}
+
+	SM_FileMgmt *spaceMgmt = getFileMgmt(&space->fHandle);
+	mgmt->fd = spaceMgmt->fd;
+	mgmt->pageSize = spaceMgmt->pageSize;
+	mgmt->mapped = spaceMgmt->mapped;
+	mgmt->direct = spaceMgmt->direct;
+	mgmt->extentPages = SM_SEGMENT_EXTENT_PAGES;
+	mgmt->readAheadWindow = SM_DEFAULT_READAHEAD_PAGES;
+	mgmt->lastRead = INT_MIN;	// No page read yet, so page 0 is not a continuation
+	mgmt->space = space;
+	mgmt->segment = (SM_SegmentHeader *)page;
+
+	fHandle->fileName = fileName;
+	fHandle->curPagePos = 0;
+	fHandle->totalNumPages = mgmt->segment->numPages;
+	fHandle->mgmtInfo = mgmt;
+	return RC_OK;
+}
+
+// Releasing every page of a segment and its directory entry. The segment must not be open.
+static RC dropSegment (SM_TableSpace *space, char *segmentName) {
+	SM_FileMgmt *spaceMgmt = getFileMgmt(&space->fHandle);
+	SM_PageHandle page = allocPageBuffersOfSize(1, spaceMgmt->pageSize);
+	SM_PageHandle header = allocPageBuffersOfSize(1, spaceMgmt->pageSize);
+	int dirPage, slot, i;
+	RC rc = RC_ERROR;
+
+	if(page != NULL && header != NULL && (rc = findSegment(space, segmentName, page, &dirPage, &slot)) == RC_OK) {
+		SM_DirectoryEntry *entry = &((SM_DirectoryPage *)page)->entries[slot];
+		int headerPage = entry->headerPage;
+		SM_SegmentHeader *segment = (SM_SegmentHeader *)header;
+
+		// Removing the entry first: a crash then leaks the pages instead of sharing them.
+		memset(entry, 0, sizeof(SM_DirectoryEntry));
+		if((rc = writeBlock(dirPage, &space->fHandle, page)) == RC_OK
+				&& (rc = readBlock(headerPage, &space->fHandle, header)) == RC_OK) {
+			for(i = 0; i < segment->numExtents && rc == RC_OK; i++)
+				rc = markPages(spaceMgmt, segment->extents[i].start, segment->extents[i].length, 1);
+			if(rc == RC_OK)
+				rc = markPages(spaceMgmt, headerPage, 1, 1);
+		}
+	}
+
+	freePageBuffers(page);
+	freePageBuffers(header);
+	return rc;
+}
+
+// Creating segment segmentName in tablespace spaceName with one empty page, replacing a
+// segment of that name. A missing tablespace is created on the way with pages of pageSize;
+// an existing one must already have pages of that size.
+static RC createSegment (char *fileName, char *spaceName, char *segmentName, int pageSize) {
+	if(segmentName[0] == '\0' || strlen(segmentName) >= SEGMENT_NAME_LENGTH)
 		return RC_FILE_NOT_FOUND;
-	
-	int startPosition = (fHandle->totalNumPages - 1) * PAGE_SIZE;
-
-	// Initializing file pointer position.
-	fseek(pageFile, startPosition, SEEK_SET);
-	
-	int i;
-	// Reading block character by character and storing it in memPage.
-	// Also checking if we have reahed end of file.
-	for(i = 0; i < PAGE_SIZE; i++) {
-		char c = fgetc(pageFile);		
-		if(feof(pageFile))
-			break;
-		memPage[i] = c;
+
+	SM_TableSpace *space;
+	RC rc = acquireTableSpace(spaceName, 0, pageSize, &space);
+	if(rc != RC_OK)
+		return rc;
+	if(getPageSize(&space->fHandle) != pageSize) {
+		releaseTableSpace(space);
+		return RC_INVALID_PAGE_FILE;
+	}
+
+	SM_PageHandle page = allocPageBuffersOfSize(1, pageSize);
+	int dirPage, slot, headerPage;
+	if(page == NULL) {
+		releaseTableSpace(space);
+		return RC_ERROR;
 	}
-	
-	// Setting the current page position to the cursor(pointer) position of the file stream
-	fHandle->curPagePos = ftell(pageFile); 
 
-	// Closing file stream so that all the buffers are flushed.
-	fclose(pageFile);
-	return RC_OK;	
+	rc = dropSegment(space, segmentName);
+	if(rc == RC_OK || rc == RC_FILE_NOT_FOUND)
+		rc = allocatePage(&space->fHandle, &headerPage);
+
+	// An empty header page describes a segment without pages; it is written zeroed by allocatePage.
+	if(rc == RC_OK && findSegment(space, segmentName, page, &dirPage, &slot) == RC_FILE_NOT_FOUND) {
+		SM_DirectoryPage *directory = (SM_DirectoryPage *)page;
+
+		// Chaining a new directory page when every entry is taken.
+		if(slot < 0) {
+			int newDirPage = 0;
+			if((rc = allocatePage(&space->fHandle, &newDirPage)) == RC_OK) {
+				directory->nextPage = newDirPage;
+				rc = writeBlock(dirPage, &space->fHandle, page);
+			}
+			memset(page, 0, pageSize);
+			memcpy(directory->magic, SM_DIRECTORY_MAGIC, 8);
+			dirPage = newDirPage;
+			slot = 0;
+		}
+		if(rc == RC_OK) {
+			strcpy(directory->entries[slot].name, segmentName);
+			directory->entries[slot].headerPage = headerPage;
+			rc = writeBlock(dirPage, &space->fHandle, page);
+		}
+	}
+	freePageBuffers(page);
+
+	// Giving the segment its first page, like createPageFile does for a file.
+	if(rc == RC_OK) {
+		SM_FileHandle fHandle;
+		if((rc = openSegment(fileName, spaceName, segmentName, &fHandle, 0)) == RC_OK) {
+			rc = ensureCapacity(1, &fHandle);
+			RC closeRc = closePageFile(&fHandle);
+			if(rc == RC_OK)
+				rc = closeRc;
+		}
+	}
+
+	RC releaseRc = releaseTableSpace(space);
+	return rc != RC_OK ? rc : releaseRc;
 }
-/*
-extern RC writeBlock (int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage) {
-	// Checking if the pageNumber parameter is less than Total number of pages and less than 0, then return respective error code
-	if (pageNum > fHandle->totalNumPages || pageNum < 0)
-        	return RC_WRITE_FAILED;
-	
-	// Opening file stream in read & write mode. 'r+' mode opens the file for both reading and writing.	
-	pageFile = fopen(fHandle->fileName, "r+");
-	
+
+extern void initStorageManager (void) {
+	// Nothing to set up: every open handle carries its own descriptor in mgmtInfo.
+}
+
+extern RC createPageFile (char *fileName) {
+	return createPageFileWithPageSize(fileName, PAGE_SIZE);
+}
+
+extern RC createPageFileWithPageSize (char *fileName, int pageSize) {
+	if(!isValidPageSize(pageSize))
+		return RC_INVALID_PAGE_SIZE;
+
+	char *spaceName, *segmentName;
+	if(splitSegmentName(fileName, &spaceName, &segmentName)) {
+		RC rc = createSegment(fileName, spaceName, segmentName, pageSize);
+		free(spaceName);
+		return rc;
+	}
+
+	// Creating (or truncating) the file for reading and writing.
+	int fd = open(fileName, O_RDWR | O_CREAT | O_TRUNC, 0644);
+
 	// Checking if file was successfully opened.
-	if(pageFile == NULL)
+	if(fd < 0)
 		return RC_FILE_NOT_FOUND;
 
-	int startPosition = pageNum * PAGE_SIZE;
-
-	if(pageNum == 0) { 
-		//Writing data to non-first page
-		fseek(pageFile, startPosition, SEEK_SET);	
-		if (fwrite(memPage, sizeof(char), PAGE_SIZE, pageFile) != PAGE_SIZE) {
-        fclose(pageFile);
-        return RC_WRITE_FAILED;
-    }
-		// Setting the current page position to the cursor(pointer) position of the file stream
-		fHandle->curPagePos = ftell(pageFile); 
-
-		// Closing file stream so that all the buffers are flushed.
-		fclose(pageFile);	
-	} else {	
-		// Writing data to the first page.
-		fHandle->curPagePos = startPosition;
-		fclose(pageFile);
-		writeCurrentBlock(fHandle, memPage);
+	// Writing the header page, the first bitmap page and one empty data page.
+	int numPages = HEADER_PAGES + 2;
+	SM_PageHandle pages = allocPageBuffersOfSize(numPages, pageSize);
+	ssize_t written = -1;
+	if(pages != NULL) {
+		memset(pages, 0, (size_t)numPages * pageSize);
+		SM_FileHeader *header = (SM_FileHeader *)pages;
+		memcpy(header->magic, SM_FILE_MAGIC, sizeof(header->magic));
+		header->version = SM_FILE_VERSION;
+		header->pageSize = pageSize;
+		written = writeFully(fd, pages, (size_t)numPages * pageSize, 0);
 	}
+
+	// De-allocating the memory previously allocated to 'pages' and releasing the descriptor.
+	freePageBuffers(pages);
+	close(fd);
+
+	if(written != (ssize_t)numPages * pageSize)
+		return RC_WRITE_FAILED;
 	return RC_OK;
 }
-*/
-extern RC writeBlock(int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage) {
-    if (pageNum > fHandle->totalNumPages || pageNum < 0)
-        return RC_WRITE_FAILED;
-    
-    pageFile = fopen(fHandle->fileName, "r+");
-    if (pageFile == NULL)
-        return RC_FILE_NOT_FOUND;
 
-    int startPosition = pageNum * PAGE_SIZE;
-    fseek(pageFile, startPosition, SEEK_SET);
+// Opening a page file, or a segment when fileName names one.
+static RC openPageFileOrSegment (char *fileName, SM_FileHandle *fHandle, int openMode) {
+	char *spaceName, *segmentName;
+	if(!splitSegmentName(fileName, &spaceName, &segmentName))
+		return openHandle(fileName, fHandle, openMode);
 
-    // Escribir los datos en la página especificada.
-    if (fwrite(memPage, sizeof(char), PAGE_SIZE, pageFile) != PAGE_SIZE) {
-        fclose(pageFile);
-        return RC_WRITE_FAILED;
-    }
+	fHandle->mgmtInfo = NULL;
+	RC rc = openSegment(fileName, spaceName, segmentName, fHandle, openMode);
+	free(spaceName);
+	return rc;
+}
 
-    // Actualizar la posición actual de la página en el manejador de archivos.
-    fHandle->curPagePos = ftell(pageFile);
+extern RC openPageFile (char *fileName, SM_FileHandle *fHandle) {
+	return openPageFileOrSegment(fileName, fHandle, 0);
+}
 
-    // Cerrar el archivo.
-    fclose(pageFile);
-    return RC_OK;
+extern RC openPageFileMapped (char *fileName, SM_FileHandle *fHandle) {
+	return openPageFileOrSegment(fileName, fHandle, OPEN_MAPPED);
 }
 
-extern RC writeCurrentBlock (SM_FileHandle *fHandle, SM_PageHandle memPage) {
-	// Opening file stream in read & write mode. 'r+' mode opens the file for both reading and writing.	
-	pageFile = fopen(fHandle->fileName, "r+");
+extern RC openPageFileDirect (char *fileName, SM_FileHandle *fHandle) {
+	return openPageFileOrSegment(fileName, fHandle, OPEN_DIRECT);
+}
 
-	// Checking if file was successfully opened.
-	if(pageFile == NULL)
+extern RC closePageFile (SM_FileHandle *fHandle) {
+	SM_FileMgmt *mgmt = getFileMgmt(fHandle);
+
+	// Checking if the handle was opened. If opened, then release the descriptor.
+	if(mgmt == NULL)
+		return RC_FILE_HANDLE_NOT_INIT;
+
+	freeReadAhead(mgmt);
+
+	// A segment only gives up its share of the tablespace.
+	if(mgmt->space != NULL) {
+		SM_TableSpace *space = mgmt->space;
+		freePageBuffers((SM_PageHandle)mgmt->segment);
+		free(mgmt);
+		fHandle->mgmtInfo = NULL;
+		return releaseTableSpace(space);
+	}
+
+	if(mgmt->map != NULL)
+		munmap(mgmt->map, mgmt->mapLength);
+
+	int status = close(mgmt->fd);
+	freePageBuffers((SM_PageHandle)mgmt->freeMap);
+	free(mgmt);
+	fHandle->mgmtInfo = NULL;
+	return status == 0 ? RC_OK : RC_ERROR;
+}
+
+
+extern RC destroyPageFile (char *fileName) {
+	char *spaceName, *segmentName;
+	if(splitSegmentName(fileName, &spaceName, &segmentName)) {
+		SM_TableSpace *space;
+		RC rc = acquireTableSpace(spaceName, 0, 0, &space);
+		free(spaceName);
+		if(rc != RC_OK)
+			return RC_FILE_NOT_FOUND;
+
+		rc = dropSegment(space, segmentName);
+		RC releaseRc = releaseTableSpace(space);
+		return rc != RC_OK ? rc : releaseRc;
+	}
+
+	// Deleting the given filename so that it is no longer accessible.
+	if(unlink(fileName) != 0)
 		return RC_FILE_NOT_FOUND;
-	
-	// Appending an empty block to make some space for the new content.
-	appendEmptyBlock(fHandle);
-
-	// Initiliazing file pointer
-	fseek(pageFile, fHandle->curPagePos, SEEK_SET);
-	
-	// Writing memPage contents to the file.
-	fwrite(memPage, sizeof(char), strlen(memPage), pageFile);
-	
-	// Setting the current page position to the cursor(pointer) position of the file stream
-	fHandle->curPagePos = ftell(pageFile);
-
-	// Closing file stream so that all the buffers are flushed.     	
-	fclose(pageFile);
 	return RC_OK;
 }
 
+extern RC readBlock (int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage) {
+	SM_FileMgmt *mgmt = getFileMgmt(fHandle);
+	if(mgmt == NULL)
+		return RC_FILE_HANDLE_NOT_INIT;
 
-extern RC appendEmptyBlock (SM_FileHandle *fHandle) {
-	// Creating an empty page of size PAGE_SIZE bytes
-	SM_PageHandle emptyBlock = (SM_PageHandle)calloc(PAGE_SIZE, sizeof(char));
-	
-	// Moving the cursor (pointer) position to the begining of the file stream.
-	// And the seek is success if fseek() return 0
-	int isSeekSuccess = fseek(pageFile, 0, SEEK_END);
-	
-	if( isSeekSuccess == 0 ) {
-		// Writing an empty page to the file
-		fwrite(emptyBlock, sizeof(char), PAGE_SIZE, pageFile);
-	} else {
-		free(emptyBlock);
+	// Checking if the pageNumber parameter is within the file, then return respective error code
+	if (pageNum >= fHandle->totalNumPages || pageNum < 0)
+		return RC_READ_NON_EXISTING_PAGE;
+
+	// A reader continuing right after its last page gets the next window read at once;
+	// mapped handles leave readahead to the kernel.
+	int sequential = pageNum == mgmt->lastRead + 1 && mgmt->readAheadWindow > 1 && !mgmt->mapped;
+	int inReadAhead = pageNum >= mgmt->readAheadStart && pageNum < mgmt->readAheadStart + mgmt->readAheadCount;
+	RC rc = RC_OK;
+
+	if(!inReadAhead && sequential) {
+		rc = fillReadAhead(fHandle, mgmt, pageNum);
+		inReadAhead = rc == RC_OK;
+	}
+
+	// Copying the page out of the readahead buffer, or reading it at offset Page Number x Page Size
+	// into the location pointed out by memPage.
+	if(inReadAhead)
+		memcpy(memPage, mgmt->readAheadPages[pageNum - mgmt->readAheadStart], mgmt->pageSize);
+	else
+		rc = transferBlocks(pageNum, 1, mgmt, &memPage, 0);
+	if(rc != RC_OK)
+		return rc;
+
+	// Setting the current page position to the page just read
+	mgmt->lastRead = pageNum;
+	fHandle->curPagePos = pageNum;
+	return RC_OK;
+}
+
+extern RC readBlockMapped (int pageNum, SM_FileHandle *fHandle, SM_PageHandle *page) {
+	SM_FileMgmt *mgmt = getFileMgmt(fHandle);
+	if(mgmt == NULL || !mgmt->mapped)
+		return RC_FILE_HANDLE_NOT_INIT;
+
+	if (pageNum >= fHandle->totalNumPages || pageNum < 0)
+		return RC_READ_NON_EXISTING_PAGE;
+
+	// Handing out the page inside the mapping; no bytes are copied.
+	int filePageNum = pageNum;
+	SM_FileMgmt *fileMgmt = resolvePage(mgmt, &filePageNum);
+	*page = fileMgmt->map + (size_t)physicalPage(fileMgmt, filePageNum) * fileMgmt->pageSize;
+	fHandle->curPagePos = pageNum;
+	return RC_OK;
+}
+
+extern int getBlockPos (SM_FileHandle *fHandle) {
+	// Returning the current page position retrieved from the file handle
+	return fHandle->curPagePos;
+}
+
+extern int getPageSize (SM_FileHandle *fHandle) {
+	// Returning the page size recorded in the file header, 0 for a handle that is not open
+	SM_FileMgmt *mgmt = getFileMgmt(fHandle);
+	return mgmt == NULL ? 0 : mgmt->pageSize;
+}
+
+extern RC readFirstBlock (SM_FileHandle *fHandle, SM_PageHandle memPage) {
+	// Reading the first page of the file
+	return readBlock(0, fHandle, memPage);
+}
+
+extern RC readPreviousBlock (SM_FileHandle *fHandle, SM_PageHandle memPage) {
+	// Reading the page before the current position; readBlock rejects page -1
+	return readBlock(fHandle->curPagePos - 1, fHandle, memPage);
+}
+
+extern RC readCurrentBlock (SM_FileHandle *fHandle, SM_PageHandle memPage) {
+	// Reading the page at the current position
+	return readBlock(fHandle->curPagePos, fHandle, memPage);
+}
+
+extern RC readNextBlock (SM_FileHandle *fHandle, SM_PageHandle memPage){
+	// Reading the page after the current position; readBlock rejects reads past the last page
+	return readBlock(fHandle->curPagePos + 1, fHandle, memPage);
+}
+
+extern RC readLastBlock (SM_FileHandle *fHandle, SM_PageHandle memPage){
+	// Reading the last page of the file
+	return readBlock(fHandle->totalNumPages - 1, fHandle, memPage);
+}
+
+extern RC readBlocks (int startPageNum, int numPages, SM_FileHandle *fHandle, SM_PageHandle *memPages) {
+	SM_FileMgmt *mgmt = getFileMgmt(fHandle);
+	if(mgmt == NULL)
+		return RC_FILE_HANDLE_NOT_INIT;
+
+	// Checking that the whole range lies within the file.
+	if(numPages <= 0 || startPageNum < 0 || startPageNum > fHandle->totalNumPages - numPages)
+		return RC_READ_NON_EXISTING_PAGE;
+
+	RC rc = transferBlocks(startPageNum, numPages, mgmt, memPages, 0);
+	if(rc != RC_OK)
+		return rc;
+
+	// Setting the current page position to the last page read
+	fHandle->curPagePos = startPageNum + numPages - 1;
+	return RC_OK;
+}
+
+extern RC writeBlock(int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage) {
+	SM_FileMgmt *mgmt = getFileMgmt(fHandle);
+	if(mgmt == NULL)
+		return RC_FILE_HANDLE_NOT_INIT;
+
+	// Writing is allowed to any existing page or to the page directly after the last one.
+	if (pageNum > fHandle->totalNumPages || pageNum < 0)
 		return RC_WRITE_FAILED;
+
+	if(mgmt->mapped || mgmt->space != NULL) {
+		// The mapping, or the segment's extents, have to cover the page before it can be written.
+		RC rc = growFile(fHandle, mgmt, pageNum + 1);
+		if(rc != RC_OK)
+			return rc;
+	} else {
+		// Appending pages one write at a time still reserves space extent by extent.
+		if(ensureMaps(mgmt, pageNum + 1) != RC_OK)
+			return RC_WRITE_FAILED;
+		reserveExtents(mgmt, physicalPage(mgmt, pageNum) + 1);
 	}
-	
-	// De-allocating the memory previously allocated to 'emptyPage'.
-	// This is optional but always better to do for proper memory management.
-	free(emptyBlock);
-	
-	// Incrementing the total number of pages since we added an empty black.
-	fHandle->totalNumPages++;
+
+	// Writing the data to the specified page.
+	RC rc = transferBlocks(pageNum, 1, mgmt, &memPage, 1);
+	if(rc != RC_OK)
+		return rc;
+
+	// Writing right after the last page extends the file by one page.
+	if(pageNum == fHandle->totalNumPages)
+		fHandle->totalNumPages++;
+
+	// Updating the current page position in the file handle.
+	fHandle->curPagePos = pageNum;
 	return RC_OK;
 }
 
+extern RC writeBlocks (int startPageNum, int numPages, SM_FileHandle *fHandle, SM_PageHandle *memPages) {
+	SM_FileMgmt *mgmt = getFileMgmt(fHandle);
+	if(mgmt == NULL)
+		return RC_FILE_HANDLE_NOT_INIT;
+
+	// Like writeBlock, the range may start at most directly after the last page.
+	if(numPages <= 0 || startPageNum < 0 || startPageNum > fHandle->totalNumPages)
+		return RC_WRITE_FAILED;
+
+	RC rc = RC_OK;
+	if(mgmt->mapped || mgmt->space != NULL)
+		rc = growFile(fHandle, mgmt, startPageNum + numPages);
+	else if((rc = ensureMaps(mgmt, startPageNum + numPages)) == RC_OK)
+		reserveExtents(mgmt, physicalPage(mgmt, startPageNum + numPages - 1) + 1);
+	if(rc == RC_OK)
+		rc = transferBlocks(startPageNum, numPages, mgmt, memPages, 1);
+	if(rc != RC_OK)
+		return rc;
+
+	// Writing past the last page extends the file.
+	if(startPageNum + numPages > fHandle->totalNumPages)
+		fHandle->totalNumPages = startPageNum + numPages;
+
+	// Updating the current page position to the last page written.
+	fHandle->curPagePos = startPageNum + numPages - 1;
+	return RC_OK;
+}
+
+extern RC writeCurrentBlock (SM_FileHandle *fHandle, SM_PageHandle memPage) {
+	// Writing memPage contents to the page at the current position.
+	return writeBlock(fHandle->curPagePos, fHandle, memPage);
+}
+
+
+extern RC appendEmptyBlock (SM_FileHandle *fHandle) {
+	SM_FileMgmt *mgmt = getFileMgmt(fHandle);
+	if(mgmt == NULL)
+		return RC_FILE_HANDLE_NOT_INIT;
+
+	// Adding one empty page after the last page of the file.
+	return growFile(fHandle, mgmt, fHandle->totalNumPages + 1);
+}
+
 extern RC ensureCapacity (int numberOfPages, SM_FileHandle *fHandle) {
-	// Opening file stream in append mode. 'a' mode opens the file to append the data at the end of file.
-	pageFile = fopen(fHandle->fileName, "a");
-	
-	if(pageFile == NULL)
-		return RC_FILE_NOT_FOUND;
-	
+	SM_FileMgmt *mgmt = getFileMgmt(fHandle);
+	if(mgmt == NULL)
+		return RC_FILE_HANDLE_NOT_INIT;
+
 	// Checking if numberOfPages is greater than totalNumPages.
 	// If that is the case, then add empty pages till numberofPages = totalNumPages
-	while(numberOfPages > fHandle->totalNumPages)
-		appendEmptyBlock(fHandle);
-	
-	// Closing file stream so that all the buffers are flushed. 
-	fclose(pageFile);
+	return growFile(fHandle, mgmt, numberOfPages);
+}
+
+extern RC getBlockLocation (int pageNum, SM_FileHandle *fHandle, int *fd, off_t *offset) {
+	SM_FileMgmt *mgmt = getFileMgmt(fHandle);
+	if(mgmt == NULL)
+		return RC_FILE_HANDLE_NOT_INIT;
+
+	if (pageNum >= fHandle->totalNumPages || pageNum < 0)
+		return RC_READ_NON_EXISTING_PAGE;
+
+	// The caller is about to transfer the page itself, possibly writing it.
+	mgmt->readAheadCount = 0;
+
+	SM_FileMgmt *fileMgmt = resolvePage(mgmt, &pageNum);
+	*fd = fileMgmt->fd;
+	*offset = physicalPage(fileMgmt, pageNum) * fileMgmt->pageSize;
 	return RC_OK;
-}
\ No newline at end of file
+}
+
+extern SM_PageHandle allocPageBuffers (int numPages) {
+	return allocPageBuffersOfSize(numPages, PAGE_SIZE);
+}
+
+extern SM_PageHandle allocPageBuffersOfSize (int numPages, int pageSize) {
+	void *buffer = NULL;
+
+	if(numPages <= 0 || posix_memalign(&buffer, SM_IO_ALIGNMENT, (size_t)numPages * pageSize) != 0)
+		return NULL;
+	return (SM_PageHandle)buffer;
+}
+
+extern void freePageBuffers (SM_PageHandle buffer) {
+	free(buffer);
+}
+
+extern RC setAllocationExtent (int numPages, SM_FileHandle *fHandle) {
+	SM_FileMgmt *mgmt = getFileMgmt(fHandle);
+	if(mgmt == NULL)
+		return RC_FILE_HANDLE_NOT_INIT;
+	if(numPages <= 0)
+		return RC_ERROR;
+
+	mgmt->extentPages = numPages;
+	return RC_OK;
+}
+
+extern RC setReadAheadWindow (int numPages, SM_FileHandle *fHandle) {
+	SM_FileMgmt *mgmt = getFileMgmt(fHandle);
+	if(mgmt == NULL)
+		return RC_FILE_HANDLE_NOT_INIT;
+	if(numPages < 0)
+		return RC_ERROR;
+
+	// The buffer is sized for the window, so it is allocated again on the next sequential read.
+	freeReadAhead(mgmt);
+	mgmt->readAheadWindow = numPages;
+	return RC_OK;
+}
+
+extern RC allocatePage (SM_FileHandle *fHandle, int *pageNum) {
+	SM_FileMgmt *mgmt = getFileMgmt(fHandle);
+	if(mgmt == NULL)
+		return RC_FILE_HANDLE_NOT_INIT;
+
+	// Without freed pages the file grows by one page, which is empty already.
+	if(mgmt->numFree == 0) {
+		RC rc = growFile(fHandle, mgmt, fHandle->totalNumPages + 1);
+		if(rc == RC_OK)
+			*pageNum = fHandle->totalNumPages - 1;
+		return rc;
+	}
+
+	// Looking for the lowest free page, a 64-bit word of the bitmap at a time.
+	const uint64_t *words = (const uint64_t *)mgmt->freeMap;
+	int numWords = (fHandle->totalNumPages + 63) / 64;
+	int word = mgmt->freeHint / 64;
+	while(word < numWords && words[word] == 0)
+		word++;
+	if(word == numWords)
+		return RC_ERROR;
+
+	int byte = word * 8;
+	while(mgmt->freeMap[byte] == 0)
+		byte++;
+	int freePageNum = byte * 8 + __builtin_ctz(mgmt->freeMap[byte]);
+
+	// Handing out a reused page in the same state as a freshly appended one.
+	RC rc = zeroPages(mgmt, freePageNum, 1);
+	if(rc == RC_OK)
+		rc = markPages(mgmt, freePageNum, 1, 0);
+	if(rc != RC_OK)
+		return rc;
+
+	mgmt->freeHint = freePageNum + 1;
+	*pageNum = freePageNum;
+	return RC_OK;
+}
+
+extern RC freePage (int pageNum, SM_FileHandle *fHandle) {
+	SM_FileMgmt *mgmt = getFileMgmt(fHandle);
+	if(mgmt == NULL)
+		return RC_FILE_HANDLE_NOT_INIT;
+
+	if (pageNum >= fHandle->totalNumPages || pageNum < 0)
+		return RC_READ_NON_EXISTING_PAGE;
+
+	// Segments only ever grow; their pages go back to the tablespace when they are destroyed.
+	if(mgmt->space != NULL)
+		return RC_ERROR;
+
+	// Freeing a page twice would hand it out twice later on.
+	if(mgmt->freeMap[pageNum / 8] & (1 << (pageNum % 8)))
+		return RC_ERROR;
+
+	return markPages(mgmt, pageNum, 1, 1);
+}
+
+extern int getNumFreePages (SM_FileHandle *fHandle) {
+	SM_FileMgmt *mgmt = getFileMgmt(fHandle);
+	return mgmt == NULL ? 0 : mgmt->numFree;
+}
@@ -1,6 +1,8 @@
 #ifndef STORAGE_MGR_H
 #define STORAGE_MGR_H
 
+#include <sys/types.h>
+
 #include "dberror.h"
 
 /************************************************************
@@ -15,29 +17,88 @@ typedef struct SM_FileHandle {
 
 typedef char* SM_PageHandle;
 
+/* alignment of page buffers required by handles opened with openPageFileDirect */
+#define SM_IO_ALIGNMENT 4096
+
+/* pages of disk space reserved at a time when a file grows, see setAllocationExtent */
+#define SM_DEFAULT_EXTENT_PAGES 64
+
+/* page sizes accepted by createPageFileWithPageSize; createPageFile uses PAGE_SIZE */
+#define SM_MIN_PAGE_SIZE 4096
+#define SM_MAX_PAGE_SIZE 65536
+
+/* pages read at once when a handle reads its pages in order, see setReadAheadWindow */
+#define SM_DEFAULT_READAHEAD_PAGES 16
+
+/* smallest extent a segment grows by; extents double with the segment after that */
+#define SM_SEGMENT_EXTENT_PAGES 8
+
 /************************************************************
  *                    interface                             *
  ************************************************************/
-/* manipulating page files */
+/* manipulating page files. A file name of the form "tablespace:segment" names a
+   segment inside a tablespace file instead: createPageFile creates the tablespace if
+   needed, destroyPageFile returns the segment's pages to it, and all open segments of
+   a tablespace share one descriptor. */
 extern void initStorageManager (void);
 extern RC createPageFile (char *fileName);
+/* like createPageFile with pages of pageSize bytes, a power of two between SM_MIN_PAGE_SIZE
+   and SM_MAX_PAGE_SIZE. Every page of the file, and of the buffers passed to read and
+   write it, has that size. Segments take the page size of their tablespace. */
+extern RC createPageFileWithPageSize (char *fileName, int pageSize);
 extern RC openPageFile (char *fileName, SM_FileHandle *fHandle);
+/* like openPageFile, but pages are served from a shared mmap() of the file */
+extern RC openPageFileMapped (char *fileName, SM_FileHandle *fHandle);
+/* like openPageFile, but bypasses the kernel page cache with O_DIRECT */
+extern RC openPageFileDirect (char *fileName, SM_FileHandle *fHandle);
 extern RC closePageFile (SM_FileHandle *fHandle);
 extern RC destroyPageFile (char *fileName);
 
 /* reading blocks from disc */
 extern RC readBlock (int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage);
+/* mapped handles only: points *page into the mapping instead of copying the page.
+   The pointer stays valid until the file grows or the handle is closed. */
+extern RC readBlockMapped (int pageNum, SM_FileHandle *fHandle, SM_PageHandle *page);
 extern int getBlockPos (SM_FileHandle *fHandle);
+/* size of the pages of an open file, as chosen when it was created */
+extern int getPageSize (SM_FileHandle *fHandle);
 extern RC readFirstBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
 extern RC readPreviousBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
 extern RC readCurrentBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
 extern RC readNextBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
 extern RC readLastBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
+/* reads numPages consecutive pages into the buffers memPages[0..numPages-1] */
+extern RC readBlocks (int startPageNum, int numPages, SM_FileHandle *fHandle, SM_PageHandle *memPages);
 
 /* writing blocks to a page file */
 extern RC writeBlock (int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage);
 extern RC writeCurrentBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
+/* writes memPages[0..numPages-1] to consecutive pages, extending the file if needed */
+extern RC writeBlocks (int startPageNum, int numPages, SM_FileHandle *fHandle, SM_PageHandle *memPages);
 extern RC appendEmptyBlock (SM_FileHandle *fHandle);
 extern RC ensureCapacity (int numberOfPages, SM_FileHandle *fHandle);
+/* growth reserves disk space numPages at a time; the page count only grows as needed */
+extern RC setAllocationExtent (int numPages, SM_FileHandle *fHandle);
+
+/* readBlock calls continuing right after the previous page read the next numPages pages
+   into a buffer of the handle and ask the kernel for the window after that. Writes
+   through the handle drop the pages they overwrite from the buffer; writes through
+   other handles are not seen until the reader moves past the window. 0 turns
+   readahead off. */
+extern RC setReadAheadWindow (int numPages, SM_FileHandle *fHandle);
+
+/* page reuse: freed pages are handed out again, zeroed, before the file grows */
+extern RC allocatePage (SM_FileHandle *fHandle, int *pageNum);
+extern RC freePage (int pageNum, SM_FileHandle *fHandle);
+extern int getNumFreePages (SM_FileHandle *fHandle);
+
+/* page buffers aligned to SM_IO_ALIGNMENT, usable with every kind of handle */
+extern SM_PageHandle allocPageBuffers (int numPages);
+/* the same for files whose pages are not PAGE_SIZE bytes, see getPageSize */
+extern SM_PageHandle allocPageBuffersOfSize (int numPages, int pageSize);
+extern void freePageBuffers (SM_PageHandle buffer);
+
+/* low-level access for I/O engines: descriptor and byte offset holding page pageNum */
+extern RC getBlockLocation (int pageNum, SM_FileHandle *fHandle, int *fd, off_t *offset);
 
 #endif
@@ -0,0 +1,473 @@
+#define _GNU_SOURCE
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include<errno.h>
+#include<unistd.h>
+#include<pthread.h>
+#include<sys/mman.h>
+#include<sys/syscall.h>
+#include<sys/uio.h>
+#include<linux/io_uring.h>
+
+#include "storage_mgr_async.h"
+
+// Upper bound on worker threads of the thread engine, whatever the queue depth.
+#define ASYNC_MAX_WORKERS 16
+
+/* One slot per request that may be in flight. Slots are linked through 'next' on the
+   free list, and for the thread engine also on its work and done lists. */
+typedef struct AsyncRequest {
+	struct iovec iov;	// Page buffer and page size; io_uring reads it after submission
+	int fd;			// Descriptor and offset of the page, see getBlockLocation
+	off_t offset;
+	int isWrite;
+	void *tag;		// Caller's tag, handed back in the completion
+	RC rc;			// Result once the request completed
+	int next;		// Next slot on whichever list the request is on, -1 at the end
+} AsyncRequest;
+
+/* Rings shared with the kernel, set up with io_uring_setup() and mmap(). */
+typedef struct AsyncRing {
+	int ringFd;
+	void *sqRing, *cqRing;
+	size_t sqRingSize, cqRingSize;
+	struct io_uring_sqe *sqes;
+	size_t sqesSize;
+	unsigned *sqHead, *sqTail, *sqMask, *sqArray;
+	unsigned *cqHead, *cqTail, *cqMask;
+	struct io_uring_cqe *cqes;
+	unsigned pending;	// SQEs queued but not yet passed to io_uring_enter()
+} AsyncRing;
+
+/* Worker threads consuming the work list and producing the done list. */
+typedef struct AsyncThreads {
+	pthread_t workers[ASYNC_MAX_WORKERS];
+	int numWorkers;
+	pthread_mutex_t lock;
+	pthread_cond_t workReady;
+	pthread_cond_t workDone;
+	int workHead, workTail;
+	int doneHead, doneTail;
+	int stopping;
+} AsyncThreads;
+
+typedef struct AsyncMgmt {
+	AsyncRequest *requests;	// depth slots
+	int freeList;
+	AsyncRing ring;
+	AsyncThreads threads;
+} AsyncMgmt;
+
+// Finishing a transfer the kernel cut short, so callers only ever see whole pages.
+static RC completeTransfer (AsyncRequest *request, size_t done) {
+	char *buffer = (char *)request->iov.iov_base;
+	size_t length = request->iov.iov_len;
+
+	while(done < length) {
+		ssize_t n = request->isWrite
+			? pwrite(request->fd, buffer + done, length - done, request->offset + done)
+			: pread(request->fd, buffer + done, length - done, request->offset + done);
+		if(n < 0 && errno == EINTR)
+			continue;
+		if(n <= 0)
+			return request->isWrite ? RC_WRITE_FAILED : RC_ERROR;
+		done += n;
+	}
+	return RC_OK;
+}
+
+// Handing out a free request slot, or -1 when depth requests are in flight.
+static int takeRequest (AsyncMgmt *mgmt) {
+	int slot = mgmt->freeList;
+	if(slot >= 0)
+		mgmt->freeList = mgmt->requests[slot].next;
+	return slot;
+}
+
+// Returning a reaped slot to the free list and reporting it to the caller.
+static void finishRequest (SM_AsyncQueue *queue, AsyncMgmt *mgmt, int slot, SM_AsyncCompletion *completion) {
+	completion->tag = mgmt->requests[slot].tag;
+	completion->rc = mgmt->requests[slot].rc;
+	mgmt->requests[slot].next = mgmt->freeList;
+	mgmt->freeList = slot;
+	queue->inFlight--;
+}
+
+/************************************************************
+ *                    io_uring engine                       *
+ ************************************************************/
+
+static int ringEnter (AsyncRing *ring, unsigned toSubmit, unsigned minComplete) {
+	unsigned flags = minComplete > 0 ? IORING_ENTER_GETEVENTS : 0;
+	int submitted;
+
+	do {
+		submitted = syscall(__NR_io_uring_enter, ring->ringFd, toSubmit, minComplete, flags, NULL, 0);
+	} while(submitted < 0 && errno == EINTR);
+
+	if(submitted > 0)
+		ring->pending -= submitted;
+	return submitted;
+}
+
+static void ringDestroy (AsyncRing *ring) {
+	if(ring->sqes != NULL && ring->sqes != MAP_FAILED)
+		munmap(ring->sqes, ring->sqesSize);
+	if(ring->cqRing != NULL && ring->cqRing != MAP_FAILED && ring->cqRing != ring->sqRing)
+		munmap(ring->cqRing, ring->cqRingSize);
+	if(ring->sqRing != NULL && ring->sqRing != MAP_FAILED)
+		munmap(ring->sqRing, ring->sqRingSize);
+	if(ring->ringFd >= 0)
+		close(ring->ringFd);
+	ring->ringFd = -1;
+}
+
+static RC ringInit (AsyncRing *ring, int depth) {
+	struct io_uring_params params;
+
+	memset(ring, 0, sizeof(AsyncRing));
+	memset(&params, 0, sizeof(params));
+
+	ring->ringFd = syscall(__NR_io_uring_setup, depth, &params);
+	if(ring->ringFd < 0)
+		return RC_ERROR;
+
+	// Mapping the submission ring, the completion ring (possibly the same mapping) and the SQEs.
+	ring->sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+	ring->cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+	if(params.features & IORING_FEAT_SINGLE_MMAP) {
+		if(ring->cqRingSize > ring->sqRingSize)
+			ring->sqRingSize = ring->cqRingSize;
+		ring->cqRingSize = ring->sqRingSize;
+	}
+
+	ring->sqRing = mmap(NULL, ring->sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->ringFd, IORING_OFF_SQ_RING);
+	if(ring->sqRing == MAP_FAILED) {
+		ringDestroy(ring);
+		return RC_ERROR;
+	}
+
+	if(params.features & IORING_FEAT_SINGLE_MMAP)
+		ring->cqRing = ring->sqRing;
+	else
+		ring->cqRing = mmap(NULL, ring->cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->ringFd, IORING_OFF_CQ_RING);
+	if(ring->cqRing == MAP_FAILED) {
+		ringDestroy(ring);
+		return RC_ERROR;
+	}
+
+	ring->sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+	ring->sqes = mmap(NULL, ring->sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->ringFd, IORING_OFF_SQES);
+	if(ring->sqes == MAP_FAILED) {
+		ringDestroy(ring);
+		return RC_ERROR;
+	}
+
+	ring->sqHead = (unsigned *)((char *)ring->sqRing + params.sq_off.head);
+	ring->sqTail = (unsigned *)((char *)ring->sqRing + params.sq_off.tail);
+	ring->sqMask = (unsigned *)((char *)ring->sqRing + params.sq_off.ring_mask);
+	ring->sqArray = (unsigned *)((char *)ring->sqRing + params.sq_off.array);
+	ring->cqHead = (unsigned *)((char *)ring->cqRing + params.cq_off.head);
+	ring->cqTail = (unsigned *)((char *)ring->cqRing + params.cq_off.tail);
+	ring->cqMask = (unsigned *)((char *)ring->cqRing + params.cq_off.ring_mask);
+	ring->cqes = (struct io_uring_cqe *)((char *)ring->cqRing + params.cq_off.cqes);
+	return RC_OK;
+}
+
+static void ringSubmit (AsyncRing *ring, AsyncRequest *request, int slot) {
+	// Only this thread moves the SQ tail, so a plain read is enough.
+	unsigned tail = *ring->sqTail;
+	unsigned index = tail & *ring->sqMask;
+	struct io_uring_sqe *sqe = &ring->sqes[index];
+
+	memset(sqe, 0, sizeof(*sqe));
+	sqe->opcode = request->isWrite ? IORING_OP_WRITEV : IORING_OP_READV;
+	sqe->fd = request->fd;
+	sqe->addr = (unsigned long)&request->iov;
+	sqe->len = 1;
+	sqe->off = request->offset;
+	sqe->user_data = slot;
+	ring->sqArray[index] = index;
+
+	// Publishing the SQE before the kernel can see the new tail.
+	__atomic_store_n(ring->sqTail, tail + 1, __ATOMIC_RELEASE);
+	ring->pending++;
+}
+
+static int ringReap (SM_AsyncQueue *queue, AsyncMgmt *mgmt, SM_AsyncCompletion *completions, int maxCompletions) {
+	AsyncRing *ring = &mgmt->ring;
+	unsigned head = *ring->cqHead;
+	unsigned tail = __atomic_load_n(ring->cqTail, __ATOMIC_ACQUIRE);
+	int count = 0;
+
+	while(head != tail && count < maxCompletions) {
+		struct io_uring_cqe *cqe = &ring->cqes[head & *ring->cqMask];
+		int slot = (int)cqe->user_data;
+		AsyncRequest *request = &mgmt->requests[slot];
+
+		if(cqe->res < 0)
+			request->rc = request->isWrite ? RC_WRITE_FAILED : RC_ERROR;
+		else
+			request->rc = completeTransfer(request, cqe->res);
+
+		finishRequest(queue, mgmt, slot, &completions[count++]);
+		head++;
+	}
+
+	// Releasing the consumed CQEs back to the kernel.
+	__atomic_store_n(ring->cqHead, head, __ATOMIC_RELEASE);
+	return count;
+}
+
+/************************************************************
+ *                    thread engine                         *
+ ************************************************************/
+
+static void *threadWorker (void *arg) {
+	AsyncMgmt *mgmt = (AsyncMgmt *)arg;
+	AsyncThreads *threads = &mgmt->threads;
+
+	pthread_mutex_lock(&threads->lock);
+	while(1) {
+		while(threads->workHead < 0 && !threads->stopping)
+			pthread_cond_wait(&threads->workReady, &threads->lock);
+		if(threads->workHead < 0)
+			break;
+
+		// Taking the oldest request off the work list and doing it without the lock.
+		int slot = threads->workHead;
+		AsyncRequest *request = &mgmt->requests[slot];
+		threads->workHead = request->next;
+		if(threads->workHead < 0)
+			threads->workTail = -1;
+		pthread_mutex_unlock(&threads->lock);
+
+		request->rc = completeTransfer(request, 0);
+
+		pthread_mutex_lock(&threads->lock);
+		request->next = -1;
+		if(threads->doneTail < 0)
+			threads->doneHead = slot;
+		else
+			mgmt->requests[threads->doneTail].next = slot;
+		threads->doneTail = slot;
+		pthread_cond_signal(&threads->workDone);
+	}
+	pthread_mutex_unlock(&threads->lock);
+	return NULL;
+}
+
+static RC threadsInit (AsyncMgmt *mgmt, int depth) {
+	AsyncThreads *threads = &mgmt->threads;
+
+	threads->numWorkers = 0;
+	threads->workHead = threads->workTail = -1;
+	threads->doneHead = threads->doneTail = -1;
+	threads->stopping = 0;
+	pthread_mutex_init(&threads->lock, NULL);
+	pthread_cond_init(&threads->workReady, NULL);
+	pthread_cond_init(&threads->workDone, NULL);
+
+	int wanted = depth < ASYNC_MAX_WORKERS ? depth : ASYNC_MAX_WORKERS;
+	while(threads->numWorkers < wanted) {
+		if(pthread_create(&threads->workers[threads->numWorkers], NULL, threadWorker, mgmt) != 0)
+			break;
+		threads->numWorkers++;
+	}
+	return threads->numWorkers > 0 ? RC_OK : RC_ERROR;
+}
+
+static void threadsDestroy (AsyncThreads *threads) {
+	int i;
+
+	pthread_mutex_lock(&threads->lock);
+	threads->stopping = 1;
+	pthread_cond_broadcast(&threads->workReady);
+	pthread_mutex_unlock(&threads->lock);
+
+	for(i = 0; i < threads->numWorkers; i++)
+		pthread_join(threads->workers[i], NULL);
+
+	pthread_cond_destroy(&threads->workDone);
+	pthread_cond_destroy(&threads->workReady);
+	pthread_mutex_destroy(&threads->lock);
+}
+
+static void threadsSubmit (AsyncMgmt *mgmt, int slot) {
+	AsyncThreads *threads = &mgmt->threads;
+
+	pthread_mutex_lock(&threads->lock);
+	mgmt->requests[slot].next = -1;
+	if(threads->workTail < 0)
+		threads->workHead = slot;
+	else
+		mgmt->requests[threads->workTail].next = slot;
+	threads->workTail = slot;
+	pthread_cond_signal(&threads->workReady);
+	pthread_mutex_unlock(&threads->lock);
+}
+
+// Reaping finished requests; blocks until at least minCompletions are available.
+static int threadsReap (SM_AsyncQueue *queue, AsyncMgmt *mgmt, SM_AsyncCompletion *completions, int minCompletions, int maxCompletions) {
+	AsyncThreads *threads = &mgmt->threads;
+	int count = 0;
+
+	pthread_mutex_lock(&threads->lock);
+	while(1) {
+		while(threads->doneHead >= 0 && count < maxCompletions) {
+			int slot = threads->doneHead;
+			threads->doneHead = mgmt->requests[slot].next;
+			if(threads->doneHead < 0)
+				threads->doneTail = -1;
+			finishRequest(queue, mgmt, slot, &completions[count++]);
+		}
+		if(count >= minCompletions)
+			break;
+		pthread_cond_wait(&threads->workDone, &threads->lock);
+	}
+	pthread_mutex_unlock(&threads->lock);
+	return count;
+}
+
+/************************************************************
+ *                    interface                             *
+ ************************************************************/
+
+extern RC initAsyncQueue (SM_AsyncQueue *queue, int depth, SM_AsyncEngine engine) {
+	if(queue == NULL || depth <= 0)
+		return RC_ERROR;
+
+	AsyncMgmt *mgmt = (AsyncMgmt *)calloc(1, sizeof(AsyncMgmt));
+	if(mgmt == NULL)
+		return RC_ERROR;
+	mgmt->requests = (AsyncRequest *)calloc(depth, sizeof(AsyncRequest));
+	if(mgmt->requests == NULL) {
+		free(mgmt);
+		return RC_ERROR;
+	}
+
+	// Chaining all slots on the free list.
+	int i;
+	for(i = 0; i < depth; i++)
+		mgmt->requests[i].next = i + 1 < depth ? i + 1 : -1;
+	mgmt->freeList = 0;
+	mgmt->ring.ringFd = -1;
+
+	// Preferring io_uring and falling back to threads where the kernel refuses it.
+	RC rc = RC_ERROR;
+	if(engine != SM_ASYNC_THREADS) {
+		rc = ringInit(&mgmt->ring, depth);
+		if(rc == RC_OK)
+			queue->engine = SM_ASYNC_URING;
+	}
+	if(rc != RC_OK && engine != SM_ASYNC_URING) {
+		rc = threadsInit(mgmt, depth);
+		if(rc == RC_OK)
+			queue->engine = SM_ASYNC_THREADS;
+	}
+	if(rc != RC_OK) {
+		free(mgmt->requests);
+		free(mgmt);
+		return rc;
+	}
+
+	queue->depth = depth;
+	queue->inFlight = 0;
+	queue->mgmtInfo = mgmt;
+	return RC_OK;
+}
+
+extern RC shutdownAsyncQueue (SM_AsyncQueue *queue) {
+	if(queue == NULL || queue->mgmtInfo == NULL)
+		return RC_FILE_HANDLE_NOT_INIT;
+
+	AsyncMgmt *mgmt = (AsyncMgmt *)queue->mgmtInfo;
+	SM_AsyncCompletion completion;
+
+	// Letting every request in flight finish before its buffers are given up.
+	while(queue->inFlight > 0)
+		waitCompletions(queue, &completion, 1, 1);
+
+	if(queue->engine == SM_ASYNC_URING)
+		ringDestroy(&mgmt->ring);
+	else
+		threadsDestroy(&mgmt->threads);
+
+	free(mgmt->requests);
+	free(mgmt);
+	queue->mgmtInfo = NULL;
+	return RC_OK;
+}
+
+// Queueing one page transfer on whichever engine the queue runs.
+static RC submitBlock (SM_AsyncQueue *queue, int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage, void *tag, int isWrite) {
+	if(queue == NULL || queue->mgmtInfo == NULL)
+		return RC_FILE_HANDLE_NOT_INIT;
+
+	AsyncMgmt *mgmt = (AsyncMgmt *)queue->mgmtInfo;
+	int fd;
+	off_t offset;
+
+	RC rc = getBlockLocation(pageNum, fHandle, &fd, &offset);
+	if(rc != RC_OK)
+		return isWrite && rc == RC_READ_NON_EXISTING_PAGE ? RC_WRITE_FAILED : rc;
+
+	int slot = takeRequest(mgmt);
+	if(slot < 0)
+		return RC_IO_QUEUE_FULL;
+
+	AsyncRequest *request = &mgmt->requests[slot];
+	request->iov.iov_base = memPage;
+	request->iov.iov_len = getPageSize(fHandle);
+	request->fd = fd;
+	request->offset = offset;
+	request->isWrite = isWrite;
+	request->tag = tag;
+	request->rc = RC_OK;
+	queue->inFlight++;
+
+	if(queue->engine == SM_ASYNC_URING)
+		ringSubmit(&mgmt->ring, request, slot);
+	else
+		threadsSubmit(mgmt, slot);
+	return RC_OK;
+}
+
+extern RC submitReadBlock (SM_AsyncQueue *queue, int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage, void *tag) {
+	return submitBlock(queue, pageNum, fHandle, memPage, tag, 0);
+}
+
+extern RC submitWriteBlock (SM_AsyncQueue *queue, int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage, void *tag) {
+	return submitBlock(queue, pageNum, fHandle, memPage, tag, 1);
+}
+
+extern int pollCompletions (SM_AsyncQueue *queue, SM_AsyncCompletion *completions, int maxCompletions) {
+	return waitCompletions(queue, completions, 0, maxCompletions);
+}
+
+extern int waitCompletions (SM_AsyncQueue *queue, SM_AsyncCompletion *completions, int minCompletions, int maxCompletions) {
+	if(queue == NULL || queue->mgmtInfo == NULL || maxCompletions <= 0)
+		return 0;
+
+	AsyncMgmt *mgmt = (AsyncMgmt *)queue->mgmtInfo;
+
+	// Never waiting for more requests than are actually in flight.
+	if(minCompletions > queue->inFlight)
+		minCompletions = queue->inFlight;
+	if(minCompletions > maxCompletions)
+		minCompletions = maxCompletions;
+
+	if(queue->engine == SM_ASYNC_THREADS)
+		return threadsReap(queue, mgmt, completions, minCompletions, maxCompletions);
+
+	// Passing queued SQEs to the kernel and reaping until enough requests completed.
+	int count = ringReap(queue, mgmt, completions, maxCompletions);
+	while(count < minCompletions || mgmt->ring.pending > 0) {
+		unsigned wanted = count < minCompletions ? minCompletions - count : 0;
+		if(ringEnter(&mgmt->ring, mgmt->ring.pending, wanted) < 0)
+			break;
+		count += ringReap(queue, mgmt, completions + count, maxCompletions - count);
+	}
+	return count;
+}
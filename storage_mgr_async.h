@@ -0,0 +1,47 @@
+#ifndef STORAGE_MGR_ASYNC_H
+#define STORAGE_MGR_ASYNC_H
+
+#include "dberror.h"
+#include "storage_mgr.h"
+
+/************************************************************
+ *                    handle data structures                *
+ ************************************************************/
+typedef enum SM_AsyncEngine {
+  SM_ASYNC_AUTO = 0,      // io_uring if the kernel allows it, threads otherwise
+  SM_ASYNC_URING = 1,     // io_uring through raw system calls
+  SM_ASYNC_THREADS = 2    // worker threads issuing pread/pwrite
+} SM_AsyncEngine;
+
+typedef struct SM_AsyncQueue {
+  SM_AsyncEngine engine;  // engine actually in use, never SM_ASYNC_AUTO
+  int depth;              // maximum number of requests in flight
+  int inFlight;           // requests submitted but not yet reaped
+  void *mgmtInfo;
+} SM_AsyncQueue;
+
+typedef struct SM_AsyncCompletion {
+  void *tag;              // the tag passed when the request was submitted
+  RC rc;                  // RC_OK or the error the synchronous call would return
+} SM_AsyncCompletion;
+
+/************************************************************
+ *                    interface                             *
+ ************************************************************/
+/* creating and destroying queues; shutdown waits for requests in flight */
+extern RC initAsyncQueue (SM_AsyncQueue *queue, int depth, SM_AsyncEngine engine);
+extern RC shutdownAsyncQueue (SM_AsyncQueue *queue);
+
+/* submitting page I/O. Requests are handed to the engine at the latest by the next
+   poll or wait call. memPage must stay valid until the request completes, and the
+   file handle must stay open. Handles opened with openPageFileDirect need buffers
+   from allocPageBuffers. Writes only target existing pages. Returns
+   RC_IO_QUEUE_FULL when depth requests are already in flight. */
+extern RC submitReadBlock (SM_AsyncQueue *queue, int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage, void *tag);
+extern RC submitWriteBlock (SM_AsyncQueue *queue, int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage, void *tag);
+
+/* reaping completions; both return the number of entries stored in completions */
+extern int pollCompletions (SM_AsyncQueue *queue, SM_AsyncCompletion *completions, int maxCompletions);
+extern int waitCompletions (SM_AsyncQueue *queue, SM_AsyncCompletion *completions, int minCompletions, int maxCompletions);
+
+#endif
@@ -0,0 +1,686 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "storage_mgr.h"
+#include "storage_mgr_async.h"
+#include "dberror.h"
+#include "test_helper.h"
+
+// test name
+char *testName;
+
+/* test output files */
+#define TESTPF "test_pagefile.bin"
+#define TESTTS "test_tablespace.bin"
+
+/* prototypes for test functions */
+static void testCreateOpenClose(void);
+static void testSinglePageContent(void);
+static void testMultiPageContent(void);
+static void testVectoredIO(void);
+static void testMappedFile(void);
+static void testAsyncIO(SM_AsyncEngine engine);
+static void testDirectIO(void);
+static void testExtentGrowth(void);
+static void testPageReuse(void);
+static void testTableSpace(void);
+static void testPageSize(void);
+static void testReadAhead(void);
+
+/* main function running all tests */
+int
+main (void)
+{
+	testName = "";
+
+	initStorageManager();
+
+	testCreateOpenClose();
+	testSinglePageContent();
+	testMultiPageContent();
+	testVectoredIO();
+	testMappedFile();
+	testAsyncIO(SM_ASYNC_URING);
+	testAsyncIO(SM_ASYNC_THREADS);
+	testDirectIO();
+	testExtentGrowth();
+	testPageReuse();
+	testTableSpace();
+	testPageSize();
+	testReadAhead();
+
+	return 0;
+}
+
+
+/* check a return code. If it is not RC_OK then output a message, error description, and exit */
+/* Try to create, open, and close a page file */
+void
+testCreateOpenClose(void)
+{
+	SM_FileHandle fh;
+
+	testName = "test create open and close methods";
+
+	TEST_CHECK(createPageFile (TESTPF));
+
+	TEST_CHECK(openPageFile (TESTPF, &fh));
+	ASSERT_TRUE(strcmp(fh.fileName, TESTPF) == 0, "filename correct");
+	ASSERT_TRUE((fh.totalNumPages == 1), "expect 1 page in new file");
+	ASSERT_TRUE((fh.curPagePos == 0), "freshly opened file's page position should be 0");
+
+	TEST_CHECK(closePageFile (&fh));
+	TEST_CHECK(destroyPageFile (TESTPF));
+
+	// after destruction trying to open the file should cause an error
+	ASSERT_TRUE((openPageFile(TESTPF, &fh) != RC_OK), "opening non-existing file should return an error.");
+
+	TEST_DONE();
+}
+
+/* Try to create, open, and close a page file */
+void
+testSinglePageContent(void)
+{
+	SM_FileHandle fh;
+	SM_PageHandle ph;
+	int i;
+
+	testName = "test single page content";
+
+	ph = (SM_PageHandle) malloc(PAGE_SIZE);
+
+	// create a new page file
+	TEST_CHECK(createPageFile (TESTPF));
+	TEST_CHECK(openPageFile (TESTPF, &fh));
+	printf("created and opened file\n");
+
+	// read first page into handle
+	TEST_CHECK(readFirstBlock (&fh, ph));
+	// the page should be empty (zero bytes)
+	for (i=0; i < PAGE_SIZE; i++)
+		ASSERT_TRUE((ph[i] == 0), "expected zero byte in first page of freshly initialized page");
+	printf("first block was empty\n");
+
+	// change ph to be a string and write that one to disk
+	for (i=0; i < PAGE_SIZE; i++)
+		ph[i] = (i % 10) + '0';
+	TEST_CHECK(writeBlock (0, &fh, ph));
+	printf("writing first block\n");
+
+	// read back the page containing the string and check that it is correct
+	TEST_CHECK(readFirstBlock (&fh, ph));
+	for (i=0; i < PAGE_SIZE; i++)
+		ASSERT_TRUE((ph[i] == (i % 10) + '0'), "character in page read from disk is the one we expected.");
+	printf("reading first block\n");
+
+	// there is no page before or after the only page of the file
+	ASSERT_ERROR(readPreviousBlock(&fh, ph), "no page before the first one");
+	ASSERT_ERROR(readNextBlock(&fh, ph), "no page after the last one");
+
+	// destroy new page file
+	TEST_CHECK(closePageFile (&fh));
+	TEST_CHECK(destroyPageFile (TESTPF));
+
+	free(ph);
+	TEST_DONE();
+}
+
+/* Grow a page file and move through it with the relative read methods */
+void
+testMultiPageContent(void)
+{
+	SM_FileHandle fh;
+	SM_PageHandle ph;
+	int i;
+
+	testName = "test multi page content";
+
+	ph = (SM_PageHandle) malloc(PAGE_SIZE);
+
+	TEST_CHECK(createPageFile (TESTPF));
+	TEST_CHECK(openPageFile (TESTPF, &fh));
+
+	TEST_CHECK(ensureCapacity (4, &fh));
+	ASSERT_EQUALS_INT(4, fh.totalNumPages, "file grown to 4 pages");
+
+	// stamp every page with its own number
+	for (i = 0; i < 4; i++)
+	{
+		memset(ph, 'a' + i, PAGE_SIZE);
+		TEST_CHECK(writeBlock (i, &fh, ph));
+	}
+
+	// writing right after the last page appends it
+	memset(ph, 'e', PAGE_SIZE);
+	TEST_CHECK(writeBlock (4, &fh, ph));
+	ASSERT_EQUALS_INT(5, fh.totalNumPages, "write after last page appends");
+	ASSERT_ERROR(writeBlock (6, &fh, ph), "writing past the end of the file leaves no hole");
+
+	TEST_CHECK(readFirstBlock (&fh, ph));
+	ASSERT_TRUE(ph[0] == 'a', "first page");
+	TEST_CHECK(readNextBlock (&fh, ph));
+	ASSERT_TRUE(ph[0] == 'b', "next page");
+	TEST_CHECK(readNextBlock (&fh, ph));
+	ASSERT_TRUE(ph[PAGE_SIZE - 1] == 'c', "next page");
+	TEST_CHECK(readCurrentBlock (&fh, ph));
+	ASSERT_TRUE(ph[0] == 'c', "current page");
+	TEST_CHECK(readPreviousBlock (&fh, ph));
+	ASSERT_TRUE(ph[0] == 'b', "previous page");
+	ASSERT_EQUALS_INT(1, getBlockPos(&fh), "position follows the last read");
+	TEST_CHECK(readLastBlock (&fh, ph));
+	ASSERT_TRUE(ph[0] == 'e', "last page");
+
+	// the content survives closing and reopening the file
+	TEST_CHECK(closePageFile (&fh));
+	TEST_CHECK(openPageFile (TESTPF, &fh));
+	ASSERT_EQUALS_INT(5, fh.totalNumPages, "page count after reopen");
+	TEST_CHECK(readBlock (3, &fh, ph));
+	ASSERT_TRUE(ph[0] == 'd', "page 3 after reopen");
+	ASSERT_ERROR(readBlock (5, &fh, ph), "reading past the last page");
+
+	TEST_CHECK(closePageFile (&fh));
+	TEST_CHECK(destroyPageFile (TESTPF));
+
+	free(ph);
+	TEST_DONE();
+}
+
+/* Write and read back a run of pages with single vectored calls */
+void
+testVectoredIO(void)
+{
+	SM_FileHandle fh;
+	SM_PageHandle pages[8];
+	int i;
+
+	testName = "test vectored read and write";
+
+	for (i = 0; i < 8; i++)
+		pages[i] = (SM_PageHandle) malloc(PAGE_SIZE);
+
+	TEST_CHECK(createPageFile (TESTPF));
+	TEST_CHECK(openPageFile (TESTPF, &fh));
+
+	// write pages 1..8 in one call, starting right after the only existing page
+	for (i = 0; i < 8; i++)
+		memset(pages[i], 'A' + i, PAGE_SIZE);
+	TEST_CHECK(writeBlocks (1, 8, &fh, pages));
+	ASSERT_EQUALS_INT(9, fh.totalNumPages, "vectored write extends the file");
+	ASSERT_EQUALS_INT(8, getBlockPos(&fh), "position is the last page written");
+
+	// read back the middle of the run into the first four buffers
+	for (i = 0; i < 8; i++)
+		memset(pages[i], 0, PAGE_SIZE);
+	TEST_CHECK(readBlocks (3, 4, &fh, pages));
+	for (i = 0; i < 4; i++)
+		ASSERT_TRUE(pages[i][0] == 'C' + i && pages[i][PAGE_SIZE - 1] == 'C' + i, "page content of vectored read");
+
+	ASSERT_ERROR(readBlocks (6, 4, &fh, pages), "vectored read past the last page");
+	ASSERT_ERROR(writeBlocks (10, 1, &fh, pages), "vectored write leaving a hole");
+
+	TEST_CHECK(closePageFile (&fh));
+	TEST_CHECK(destroyPageFile (TESTPF));
+
+	for (i = 0; i < 8; i++)
+		free(pages[i]);
+	TEST_DONE();
+}
+
+/* Serve pages from a mapped file and grow it */
+void
+testMappedFile(void)
+{
+	SM_FileHandle fh;
+	SM_PageHandle ph, mp;
+
+	testName = "test memory mapped page file";
+
+	ph = (SM_PageHandle) malloc(PAGE_SIZE);
+
+	TEST_CHECK(createPageFile (TESTPF));
+	TEST_CHECK(openPageFileMapped (TESTPF, &fh));
+	ASSERT_EQUALS_INT(1, fh.totalNumPages, "expect 1 page in new file");
+
+	// writes go through the mapping and are visible to pointers handed out before
+	TEST_CHECK(readBlockMapped (0, &fh, &mp));
+	memset(ph, 'm', PAGE_SIZE);
+	TEST_CHECK(writeBlock (0, &fh, ph));
+	ASSERT_TRUE(mp[0] == 'm' && mp[PAGE_SIZE - 1] == 'm', "mapped page reflects the write");
+
+	// growing remaps the file; new pages are empty
+	TEST_CHECK(ensureCapacity (3, &fh));
+	TEST_CHECK(appendEmptyBlock (&fh));
+	ASSERT_EQUALS_INT(4, fh.totalNumPages, "mapped file grown to 4 pages");
+	TEST_CHECK(readBlockMapped (3, &fh, &mp));
+	ASSERT_TRUE(mp[0] == 0, "appended page is empty");
+	memset(ph, 'n', PAGE_SIZE);
+	TEST_CHECK(writeBlock (4, &fh, ph));
+	TEST_CHECK(readBlock (4, &fh, ph));
+	ASSERT_TRUE(ph[0] == 'n', "appended page read back");
+	ASSERT_ERROR(readBlockMapped (5, &fh, &mp), "no page past the end of the mapping");
+	TEST_CHECK(closePageFile (&fh));
+
+	// the content is in the file for a regular handle
+	TEST_CHECK(openPageFile (TESTPF, &fh));
+	ASSERT_EQUALS_INT(5, fh.totalNumPages, "page count after reopen");
+	TEST_CHECK(readFirstBlock (&fh, ph));
+	ASSERT_TRUE(ph[0] == 'm', "first page written through the mapping");
+	ASSERT_ERROR(readBlockMapped (0, &fh, &mp), "regular handles have no mapping");
+	TEST_CHECK(closePageFile (&fh));
+	TEST_CHECK(destroyPageFile (TESTPF));
+
+	free(ph);
+	TEST_DONE();
+}
+
+/* Write pages through an async queue, then read them back through it */
+void
+testAsyncIO(SM_AsyncEngine engine)
+{
+	SM_FileHandle fh;
+	SM_AsyncQueue queue;
+	SM_AsyncCompletion done[8];
+	SM_PageHandle pages[8];
+	int i, completed;
+
+	testName = engine == SM_ASYNC_URING ? "test async io with io_uring" : "test async io with threads";
+
+	if (initAsyncQueue(&queue, 4, engine) != RC_OK)
+	{
+		printf("engine not available, skipping\n");
+		return;
+	}
+	ASSERT_EQUALS_INT(engine, queue.engine, "requested engine in use");
+
+	for (i = 0; i < 8; i++)
+		pages[i] = (SM_PageHandle) malloc(PAGE_SIZE);
+
+	TEST_CHECK(createPageFile (TESTPF));
+	TEST_CHECK(openPageFile (TESTPF, &fh));
+	TEST_CHECK(ensureCapacity (8, &fh));
+
+	// only depth requests fit into the queue at once
+	for (i = 0; i < 4; i++)
+	{
+		memset(pages[i], 'p' + i, PAGE_SIZE);
+		TEST_CHECK(submitWriteBlock (&queue, i, &fh, pages[i], pages[i]));
+	}
+	ASSERT_EQUALS_INT(RC_IO_QUEUE_FULL, submitWriteBlock(&queue, 4, &fh, pages[4], NULL), "queue is full");
+	ASSERT_ERROR(submitWriteBlock(&queue, 8, &fh, pages[4], NULL), "async writes do not extend the file");
+
+	completed = waitCompletions(&queue, done, 4, 8);
+	ASSERT_EQUALS_INT(4, completed, "all writes completed");
+	for (i = 0; i < completed; i++)
+		TEST_CHECK(done[i].rc);
+	ASSERT_EQUALS_INT(0, queue.inFlight, "nothing left in flight");
+
+	// read the pages back in reverse order into fresh buffers
+	for (i = 0; i < 4; i++)
+	{
+		memset(pages[4 + i], 0, PAGE_SIZE);
+		TEST_CHECK(submitReadBlock (&queue, 3 - i, &fh, pages[4 + i], pages[4 + i]));
+	}
+	completed = 0;
+	while (completed < 4)
+		completed += waitCompletions(&queue, done + completed, 1, 8 - completed);
+	for (i = 0; i < 4; i++)
+	{
+		TEST_CHECK(done[i].rc);
+		ASSERT_TRUE(done[i].tag != NULL, "completion carries its tag");
+	}
+	for (i = 0; i < 4; i++)
+		ASSERT_TRUE(pages[4 + i][0] == 'p' + 3 - i && pages[4 + i][PAGE_SIZE - 1] == 'p' + 3 - i, "page read back asynchronously");
+	ASSERT_EQUALS_INT(0, pollCompletions(&queue, done, 8), "no further completions");
+
+	TEST_CHECK(shutdownAsyncQueue (&queue));
+	TEST_CHECK(closePageFile (&fh));
+	TEST_CHECK(destroyPageFile (TESTPF));
+
+	for (i = 0; i < 8; i++)
+		free(pages[i]);
+	TEST_DONE();
+}
+
+/* Bypass the page cache with aligned and unaligned buffers */
+void
+testDirectIO(void)
+{
+	SM_FileHandle fh;
+	SM_PageHandle aligned, unaligned, pages[2];
+	char *raw;
+
+	testName = "test direct io";
+
+	TEST_CHECK(createPageFile (TESTPF));
+	if (openPageFileDirect (TESTPF, &fh) != RC_OK)
+	{
+		printf("file system without O_DIRECT, skipping\n");
+		TEST_CHECK(destroyPageFile (TESTPF));
+		return;
+	}
+
+	aligned = allocPageBuffers(2);
+	ASSERT_TRUE(((unsigned long) aligned % SM_IO_ALIGNMENT) == 0, "page buffers are aligned");
+	raw = (char *) malloc(PAGE_SIZE + 1);
+	unaligned = raw + 1;
+
+	// aligned buffers go straight to the device, unaligned ones are bounced
+	memset(aligned, 'x', PAGE_SIZE);
+	TEST_CHECK(writeBlock (0, &fh, aligned));
+	memset(unaligned, 'y', PAGE_SIZE);
+	TEST_CHECK(writeBlock (1, &fh, unaligned));
+	TEST_CHECK(appendEmptyBlock (&fh));
+	ASSERT_EQUALS_INT(3, fh.totalNumPages, "direct file grown to 3 pages");
+
+	TEST_CHECK(readBlock (1, &fh, aligned));
+	ASSERT_TRUE(aligned[0] == 'y' && aligned[PAGE_SIZE - 1] == 'y', "unaligned write read back");
+	TEST_CHECK(readBlock (0, &fh, unaligned));
+	ASSERT_TRUE(unaligned[0] == 'x' && unaligned[PAGE_SIZE - 1] == 'x', "aligned write read into unaligned buffer");
+
+	pages[0] = unaligned;
+	pages[1] = aligned + PAGE_SIZE;
+	TEST_CHECK(readBlocks (1, 2, &fh, pages));
+	ASSERT_TRUE(pages[0][0] == 'y' && pages[1][0] == 0, "vectored read with a mix of buffers");
+
+	TEST_CHECK(closePageFile (&fh));
+	TEST_CHECK(destroyPageFile (TESTPF));
+
+	freePageBuffers(aligned);
+	free(raw);
+	TEST_DONE();
+}
+
+/* Grow a file inside preallocated extents */
+void
+testExtentGrowth(void)
+{
+	SM_FileHandle fh;
+	SM_PageHandle ph;
+	struct stat info;
+	off_t initialSize;
+
+	testName = "test extent based growth";
+
+	ph = (SM_PageHandle) malloc(PAGE_SIZE);
+
+	TEST_CHECK(createPageFile (TESTPF));
+	TEST_CHECK(openPageFile (TESTPF, &fh));
+	stat(TESTPF, &info);
+	initialSize = info.st_size;
+	TEST_CHECK(setAllocationExtent (16, &fh));
+	ASSERT_ERROR(setAllocationExtent (0, &fh), "extent must hold at least one page");
+
+	// the logical size follows the page count, the reserved space a whole extent
+	TEST_CHECK(ensureCapacity (5, &fh));
+	ASSERT_EQUALS_INT(5, fh.totalNumPages, "file grown to 5 pages");
+	stat(TESTPF, &info);
+	ASSERT_TRUE(info.st_size == initialSize + 4 * PAGE_SIZE, "file size is the logical page count");
+	ASSERT_TRUE(info.st_blocks * 512 >= 16 * PAGE_SIZE, "a whole extent is reserved");
+
+	// new pages read as zeros and appending writes stay inside the extent
+	TEST_CHECK(readBlock (4, &fh, ph));
+	ASSERT_TRUE(ph[0] == 0 && ph[PAGE_SIZE - 1] == 0, "grown page is empty");
+	memset(ph, 'g', PAGE_SIZE);
+	TEST_CHECK(writeBlock (5, &fh, ph));
+	TEST_CHECK(appendEmptyBlock (&fh));
+	ASSERT_EQUALS_INT(7, fh.totalNumPages, "appended inside the extent");
+	stat(TESTPF, &info);
+	ASSERT_TRUE(info.st_size == initialSize + 6 * PAGE_SIZE, "file size follows appends");
+
+	TEST_CHECK(closePageFile (&fh));
+	TEST_CHECK(openPageFile (TESTPF, &fh));
+	ASSERT_EQUALS_INT(7, fh.totalNumPages, "page count after reopen ignores reserved space");
+	TEST_CHECK(readBlock (5, &fh, ph));
+	ASSERT_TRUE(ph[0] == 'g', "appended page after reopen");
+
+	TEST_CHECK(closePageFile (&fh));
+	TEST_CHECK(destroyPageFile (TESTPF));
+
+	free(ph);
+	TEST_DONE();
+}
+
+/* freed pages are handed out again before the file grows, and survive a reopen */
+void
+testPageReuse(void)
+{
+	SM_FileHandle fh;
+	SM_PageHandle ph;
+	FILE *fp;
+	int pageNum;
+
+	testName = "test free page reuse";
+
+	ph = (SM_PageHandle) malloc(PAGE_SIZE);
+
+	TEST_CHECK(createPageFile (TESTPF));
+	TEST_CHECK(openPageFile (TESTPF, &fh));
+	TEST_CHECK(ensureCapacity (4, &fh));
+	ASSERT_EQUALS_INT(0, getNumFreePages(&fh), "no free pages in a new file");
+
+	// without free pages allocation appends
+	TEST_CHECK(allocatePage (&fh, &pageNum));
+	ASSERT_EQUALS_INT(4, pageNum, "allocation appends to a full file");
+	ASSERT_EQUALS_INT(5, fh.totalNumPages, "file grew by one page");
+
+	memset(ph, 'r', PAGE_SIZE);
+	TEST_CHECK(writeBlock (1, &fh, ph));
+	TEST_CHECK(writeBlock (3, &fh, ph));
+	TEST_CHECK(freePage (3, &fh));
+	TEST_CHECK(freePage (1, &fh));
+	ASSERT_ERROR(freePage (1, &fh), "freeing a page twice");
+	ASSERT_ERROR(freePage (5, &fh), "freeing a page past the end");
+	ASSERT_EQUALS_INT(2, getNumFreePages(&fh), "two free pages");
+
+	// the free map is persistent
+	TEST_CHECK(closePageFile (&fh));
+	TEST_CHECK(openPageFile (TESTPF, &fh));
+	ASSERT_EQUALS_INT(2, getNumFreePages(&fh), "free pages after reopen");
+
+	// the lowest free page comes first, zeroed, and the file does not grow
+	TEST_CHECK(allocatePage (&fh, &pageNum));
+	ASSERT_EQUALS_INT(1, pageNum, "lowest free page reused");
+	TEST_CHECK(readBlock (1, &fh, ph));
+	ASSERT_TRUE(ph[0] == 0 && ph[PAGE_SIZE - 1] == 0, "reused page is empty");
+	TEST_CHECK(allocatePage (&fh, &pageNum));
+	ASSERT_EQUALS_INT(3, pageNum, "next free page reused");
+	TEST_CHECK(allocatePage (&fh, &pageNum));
+	ASSERT_EQUALS_INT(5, pageNum, "appends again once the free pages are used");
+	ASSERT_EQUALS_INT(6, fh.totalNumPages, "file grew only once");
+
+	TEST_CHECK(closePageFile (&fh));
+	TEST_CHECK(destroyPageFile (TESTPF));
+
+	// files without a valid header are rejected
+	fp = fopen(TESTPF, "w");
+	memset(ph, 'x', PAGE_SIZE);
+	fwrite(ph, PAGE_SIZE, 2, fp);
+	fclose(fp);
+	ASSERT_EQUALS_INT(RC_INVALID_PAGE_FILE, openPageFile (TESTPF, &fh), "not a page file");
+	TEST_CHECK(destroyPageFile (TESTPF));
+
+	free(ph);
+	TEST_DONE();
+}
+
+/* segments of one tablespace behave like separate page files sharing one file */
+void
+testTableSpace(void)
+{
+	SM_FileHandle fh1, fh2;
+	SM_PageHandle ph;
+	struct stat info;
+	off_t sizeBefore;
+	int i;
+
+	testName = "test tablespace segments";
+
+	ph = (SM_PageHandle) malloc(PAGE_SIZE);
+
+	// creating the first segment creates the tablespace
+	TEST_CHECK(createPageFile (TESTTS ":first"));
+	TEST_CHECK(createPageFile (TESTTS ":second"));
+	ASSERT_ERROR(openPageFile (TESTTS ":missing", &fh1), "opening a missing segment");
+	TEST_CHECK(openPageFile (TESTTS ":first", &fh1));
+	TEST_CHECK(openPageFile (TESTTS ":second", &fh2));
+	ASSERT_EQUALS_INT(1, fh1.totalNumPages, "expect 1 page in new segment");
+
+	// growing both segments in turns interleaves their extents
+	for (i = 0; i < 40; i++)
+	{
+		memset(ph, 'a' + i % 26, PAGE_SIZE);
+		TEST_CHECK(writeBlock (i, &fh1, ph));
+		memset(ph, 'A' + i % 26, PAGE_SIZE);
+		TEST_CHECK(writeBlock (i, &fh2, ph));
+	}
+	ASSERT_EQUALS_INT(40, fh1.totalNumPages, "segment grew by appends");
+	TEST_CHECK(ensureCapacity (50, &fh2));
+
+	TEST_CHECK(closePageFile (&fh1));
+	TEST_CHECK(closePageFile (&fh2));
+
+	TEST_CHECK(openPageFile (TESTTS ":first", &fh1));
+	TEST_CHECK(openPageFile (TESTTS ":second", &fh2));
+	ASSERT_EQUALS_INT(40, fh1.totalNumPages, "segment size after reopen");
+	ASSERT_EQUALS_INT(50, fh2.totalNumPages, "grown segment size after reopen");
+	for (i = 0; i < 40; i++)
+	{
+		TEST_CHECK(readBlock (i, &fh1, ph));
+		ASSERT_TRUE(ph[0] == 'a' + i % 26 && ph[PAGE_SIZE - 1] == 'a' + i % 26, "first segment content");
+		TEST_CHECK(readBlock (i, &fh2, ph));
+		ASSERT_TRUE(ph[0] == 'A' + i % 26 && ph[PAGE_SIZE - 1] == 'A' + i % 26, "second segment content");
+	}
+	TEST_CHECK(readBlock (49, &fh2, ph));
+	ASSERT_TRUE(ph[0] == 0, "grown segment page is empty");
+	TEST_CHECK(closePageFile (&fh1));
+	TEST_CHECK(closePageFile (&fh2));
+
+	// a dropped segment's pages are reused by the next one without growing the file
+	stat(TESTTS, &info);
+	sizeBefore = info.st_size;
+	TEST_CHECK(destroyPageFile (TESTTS ":first"));
+	ASSERT_ERROR(openPageFile (TESTTS ":first", &fh1), "opening a destroyed segment");
+	TEST_CHECK(createPageFile (TESTTS ":third"));
+	TEST_CHECK(openPageFile (TESTTS ":third", &fh1));
+	TEST_CHECK(ensureCapacity (30, &fh1));
+	TEST_CHECK(readBlock (29, &fh1, ph));
+	ASSERT_TRUE(ph[0] == 0 && ph[PAGE_SIZE - 1] == 0, "reused segment page is empty");
+	TEST_CHECK(closePageFile (&fh1));
+	stat(TESTTS, &info);
+	ASSERT_TRUE(info.st_size == sizeBefore, "tablespace did not grow");
+
+	// plain page files are not tablespaces
+	TEST_CHECK(createPageFile (TESTPF));
+	ASSERT_EQUALS_INT(RC_INVALID_PAGE_FILE, openPageFile (TESTPF ":first", &fh1), "not a tablespace");
+	TEST_CHECK(destroyPageFile (TESTPF));
+
+	TEST_CHECK(destroyPageFile (TESTTS));
+
+	free(ph);
+	TEST_DONE();
+}
+
+/* the page size chosen at creation is kept in the file and used for all its pages */
+void
+testPageSize(void)
+{
+	SM_FileHandle fh;
+	SM_PageHandle ph;
+	int pageSize = 16384;
+
+	testName = "test page size per file";
+
+	ASSERT_EQUALS_INT(RC_INVALID_PAGE_SIZE, createPageFileWithPageSize (TESTPF, 3000), "page size must be a power of two");
+	ASSERT_EQUALS_INT(RC_INVALID_PAGE_SIZE, createPageFileWithPageSize (TESTPF, 2 * SM_MAX_PAGE_SIZE), "page size too large");
+
+	TEST_CHECK(createPageFileWithPageSize (TESTPF, pageSize));
+	TEST_CHECK(openPageFile (TESTPF, &fh));
+	ASSERT_EQUALS_INT(pageSize, getPageSize(&fh), "page size recorded in the file");
+	ASSERT_EQUALS_INT(1, fh.totalNumPages, "expect 1 page in new file");
+
+	// whole large pages are written and read back
+	ph = allocPageBuffersOfSize(1, pageSize);
+	memset(ph, 'p', pageSize);
+	TEST_CHECK(writeBlock (1, &fh, ph));
+	TEST_CHECK(closePageFile (&fh));
+
+	TEST_CHECK(openPageFile (TESTPF, &fh));
+	ASSERT_EQUALS_INT(pageSize, getPageSize(&fh), "page size after reopen");
+	ASSERT_EQUALS_INT(2, fh.totalNumPages, "2 pages after reopen");
+	memset(ph, 0, pageSize);
+	TEST_CHECK(readBlock (1, &fh, ph));
+	ASSERT_TRUE(ph[0] == 'p' && ph[pageSize - 1] == 'p', "large page content");
+	TEST_CHECK(closePageFile (&fh));
+	TEST_CHECK(destroyPageFile (TESTPF));
+
+	// segments have the page size of their tablespace
+	TEST_CHECK(createPageFileWithPageSize (TESTTS ":large", pageSize));
+	ASSERT_EQUALS_INT(RC_INVALID_PAGE_FILE, createPageFile (TESTTS ":small"), "segment page size differs from the tablespace");
+	TEST_CHECK(openPageFile (TESTTS ":large", &fh));
+	ASSERT_EQUALS_INT(pageSize, getPageSize(&fh), "segment page size");
+	TEST_CHECK(closePageFile (&fh));
+	TEST_CHECK(destroyPageFile (TESTTS));
+
+	freePageBuffers(ph);
+	TEST_DONE();
+}
+
+/* sequential reads are served from the readahead window and see the handle's own writes */
+void
+testReadAhead(void)
+{
+	SM_FileHandle fh;
+	SM_PageHandle ph;
+	int i;
+
+	testName = "test sequential readahead";
+
+	ph = (SM_PageHandle) malloc(PAGE_SIZE);
+
+	TEST_CHECK(createPageFile (TESTPF));
+	TEST_CHECK(openPageFile (TESTPF, &fh));
+	for (i = 0; i < 50; i++)
+	{
+		memset(ph, i, PAGE_SIZE);
+		TEST_CHECK(writeBlock (i, &fh, ph));
+	}
+	TEST_CHECK(closePageFile (&fh));
+
+	TEST_CHECK(openPageFile (TESTPF, &fh));
+	TEST_CHECK(setReadAheadWindow (8, &fh));
+	ASSERT_ERROR(setReadAheadWindow (-1, &fh), "negative readahead window");
+
+	// a full scan, crossing several windows and ending inside a partial one
+	TEST_CHECK(readFirstBlock (&fh, ph));
+	for (i = 1; i < 50; i++)
+	{
+		TEST_CHECK(readNextBlock (&fh, ph));
+		ASSERT_TRUE(ph[0] == i && ph[PAGE_SIZE - 1] == i, "scanned page content");
+	}
+	ASSERT_ERROR(readNextBlock (&fh, ph), "reading past the last page");
+
+	// a write inside the window is visible to the next read
+	TEST_CHECK(readBlock (10, &fh, ph));
+	TEST_CHECK(readBlock (11, &fh, ph));
+	memset(ph, 'w', PAGE_SIZE);
+	TEST_CHECK(writeBlock (12, &fh, ph));
+	TEST_CHECK(readBlock (12, &fh, ph));
+	ASSERT_TRUE(ph[0] == 'w', "written page read back inside the window");
+	TEST_CHECK(readNextBlock (&fh, ph));
+	ASSERT_TRUE(ph[0] == 13, "page after the written one");
+
+	// readahead off
+	TEST_CHECK(setReadAheadWindow (0, &fh));
+	TEST_CHECK(readBlock (20, &fh, ph));
+	TEST_CHECK(readNextBlock (&fh, ph));
+	ASSERT_TRUE(ph[0] == 21, "sequential read without readahead");
+
+	TEST_CHECK(closePageFile (&fh));
+	TEST_CHECK(destroyPageFile (TESTPF));
+
+	free(ph);
+	TEST_DONE();
+}
@@ -0,0 +1,1293 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "storage_mgr.h"
+#include "buffer_mgr.h"
+#include "buffer_mgr_stat.h"
+#include "dberror.h"
+#include "test_helper.h"
+
+// test name
+char *testName;
+
+/* test output files */
+#define TESTPF "test_pagefile.bin"
+#define TESTPF2 "test_pagefile2.bin"
+
+/* check the frame contents of a pool, printed with sprintPoolContent */
+#define ASSERT_EQUALS_POOL(expected,bm,message)				\
+		do {									\
+			char *real = sprintPoolContent(bm);				\
+			if (strcmp((expected), real) != 0)				\
+			{									\
+				printf("[%s-%s-L%i-%s] FAILED: expected <%s> but was <%s>: %s\n", TEST_INFO, (expected), real, message); \
+				free(real);						\
+				exit(1);							\
+			}									\
+			printf("[%s-%s-L%i-%s] OK: expected <%s> and was <%s>: %s\n", TEST_INFO, (expected), real, message); \
+			free(real);							\
+		} while(0)
+
+/* prototypes for test functions */
+static void createDummyPages(char *fileName, int num);
+static void checkDummyPage(BM_PageHandle *h, int pageNum);
+static void testPageTableFIFO(void);
+static void testPageTableManyPages(void);
+static void testIndependentPools(void);
+static void testThreadSafePool(void);
+static void testLRUK(void);
+static void testScanResistance(void);
+static void testUnpinnedLists(void);
+static void testFrameArena(void);
+static void testAccessStrategy(void);
+static void testPrefetch(void);
+static void testSortedFlush(void);
+static void testBackgroundWriter(void);
+static void testWarmStart(void);
+static void testResize(void);
+static void testSharedPool(void);
+static void testPoolStats(void);
+static void testFailedRead(void);
+static void testFailedPrefetch(void);
+
+/* main function running all tests */
+int
+main (void)
+{
+	initStorageManager();
+	testName = "";
+
+	testPageTableFIFO();
+	testPageTableManyPages();
+	testIndependentPools();
+	testThreadSafePool();
+	testLRUK();
+	testScanResistance();
+	testUnpinnedLists();
+	testFrameArena();
+	testAccessStrategy();
+	testPrefetch();
+	testSortedFlush();
+	testBackgroundWriter();
+	testWarmStart();
+	testResize();
+	testSharedPool();
+	testPoolStats();
+	testFailedRead();
+	testFailedPrefetch();
+
+	return 0;
+}
+
+/* create a page file with num pages, page i holding the string "Page-i" */
+void
+createDummyPages(char *fileName, int num)
+{
+	SM_FileHandle fh;
+	SM_PageHandle ph;
+	int i;
+
+	ph = (SM_PageHandle) calloc(PAGE_SIZE, 1);
+
+	TEST_CHECK(createPageFile(fileName));
+	TEST_CHECK(openPageFile(fileName, &fh));
+	for (i = 0; i < num; i++)
+	{
+		memset(ph, 0, PAGE_SIZE);
+		sprintf(ph, "%s-%i", "Page", i);
+		TEST_CHECK(writeBlock(i, &fh, ph));
+	}
+	TEST_CHECK(closePageFile(&fh));
+
+	free(ph);
+}
+
+/* check that a pinned page holds the content written by createDummyPages */
+void
+checkDummyPage(BM_PageHandle *h, int pageNum)
+{
+	char expected[32];
+
+	sprintf(expected, "%s-%i", "Page", pageNum);
+	ASSERT_TRUE(h->pageNum == pageNum && strcmp(h->data, expected) == 0, "pinned page has the expected content");
+}
+
+/* hits are found without reads, evicted pages are gone from the pool */
+void
+testPageTableFIFO(void)
+{
+	BM_BufferPool *bm = MAKE_POOL();
+	BM_PageHandle *h = MAKE_PAGE_HANDLE();
+	int readIO, i;
+
+	testName = "Page table lookups with FIFO";
+
+	createDummyPages(TESTPF, 10);
+	TEST_CHECK(initBufferPool(bm, TESTPF, 3, RS_FIFO, NULL));
+
+	for (i = 0; i < 3; i++)
+	{
+		TEST_CHECK(pinPage(bm, h, i));
+		checkDummyPage(h, i);
+		TEST_CHECK(unpinPage(bm, h));
+	}
+
+	// pinning resident pages reads nothing
+	readIO = getNumReadIO(bm);
+	TEST_CHECK(pinPage(bm, h, 1));
+	checkDummyPage(h, 1);
+	TEST_CHECK(unpinPage(bm, h));
+	TEST_CHECK(pinPage(bm, h, 2));
+	TEST_CHECK(unpinPage(bm, h));
+	ASSERT_EQUALS_INT(readIO, getNumReadIO(bm), "hits do not read from disk");
+
+	// page 3 replaces page 0, which is then unknown to the pool
+	TEST_CHECK(pinPage(bm, h, 3));
+	checkDummyPage(h, 3);
+	TEST_CHECK(unpinPage(bm, h));
+	ASSERT_EQUALS_INT(readIO + 1, getNumReadIO(bm), "miss reads from disk");
+
+	h->pageNum = 0;
+	ASSERT_ERROR(unpinPage(bm, h), "unpinning an evicted page");
+	ASSERT_ERROR(markDirty(bm, h), "marking an evicted page dirty");
+	ASSERT_ERROR(forcePage(bm, h), "forcing an evicted page");
+
+	// page 3 is found where the eviction put it, and page 0 comes back from disk
+	TEST_CHECK(pinPage(bm, h, 3));
+	checkDummyPage(h, 3);
+	TEST_CHECK(unpinPage(bm, h));
+	TEST_CHECK(pinPage(bm, h, 0));
+	checkDummyPage(h, 0);
+	TEST_CHECK(unpinPage(bm, h));
+	ASSERT_EQUALS_INT(readIO + 2, getNumReadIO(bm), "evicted page read again");
+
+	TEST_CHECK(shutdownBufferPool(bm));
+	TEST_CHECK(destroyPageFile(TESTPF));
+
+	free(bm);
+	free(h);
+	TEST_DONE();
+}
+
+/* many evictions through the page table keep every lookup pointing at the right frame */
+void
+testPageTableManyPages(void)
+{
+	BM_BufferPool *bm = MAKE_POOL();
+	BM_PageHandle *h = MAKE_PAGE_HANDLE();
+	int i, pageNum, wrong = 0;
+
+	testName = "Page table lookups with many evictions";
+
+	createDummyPages(TESTPF, 2000);
+	TEST_CHECK(initBufferPool(bm, TESTPF, 100, RS_LRU, NULL));
+
+	srand(7);
+	for (i = 0; i < 5000; i++)
+	{
+		pageNum = (i % 3 == 0) ? rand() % 2000 : rand() % 150;
+		TEST_CHECK(pinPage(bm, h, pageNum));
+		if (h->pageNum != pageNum || strncmp(h->data, "Page-", 5) != 0 || atoi(h->data + 5) != pageNum)
+			wrong++;
+		TEST_CHECK(unpinPage(bm, h));
+	}
+	ASSERT_EQUALS_INT(0, wrong, "every pinned page had the expected content");
+
+	// a dirty page is written back when it is evicted and read back with its changes
+	TEST_CHECK(pinPage(bm, h, 1999));
+	sprintf(h->data, "%s-%i", "Page", 1999);
+	strcat(h->data, "-changed");
+	TEST_CHECK(markDirty(bm, h));
+	TEST_CHECK(unpinPage(bm, h));
+	for (i = 0; i < 100; i++)
+	{
+		TEST_CHECK(pinPage(bm, h, i));
+		TEST_CHECK(unpinPage(bm, h));
+	}
+	TEST_CHECK(pinPage(bm, h, 1999));
+	ASSERT_EQUALS_STRING("Page-1999-changed", h->data, "dirty page survived eviction");
+	TEST_CHECK(unpinPage(bm, h));
+
+	TEST_CHECK(shutdownBufferPool(bm));
+	TEST_CHECK(destroyPageFile(TESTPF));
+
+	free(bm);
+	free(h);
+	TEST_DONE();
+}
+
+/* two pools keep their own frames, replacement state and I/O counters */
+void
+testIndependentPools(void)
+{
+	BM_BufferPool *bm1 = MAKE_POOL();
+	BM_BufferPool *bm2 = MAKE_POOL();
+	BM_PageHandle *h = MAKE_PAGE_HANDLE();
+	PageNumber *contents;
+	int i;
+
+	testName = "Independent buffer pools";
+
+	createDummyPages(TESTPF, 10);
+	createDummyPages(TESTPF2, 10);
+	TEST_CHECK(initBufferPool(bm1, TESTPF, 3, RS_FIFO, NULL));
+	TEST_CHECK(initBufferPool(bm2, TESTPF2, 2, RS_CLOCK, NULL));
+
+	// interleaving misses on both pools
+	for (i = 0; i < 6; i++)
+	{
+		TEST_CHECK(pinPage(bm1, h, i));
+		checkDummyPage(h, i);
+		TEST_CHECK(unpinPage(bm1, h));
+		if (i % 2 == 0)
+		{
+			TEST_CHECK(pinPage(bm2, h, 9 - i));
+			checkDummyPage(h, 9 - i);
+			TEST_CHECK(unpinPage(bm2, h));
+		}
+	}
+
+	ASSERT_EQUALS_INT(6, getNumReadIO(bm1), "first pool counts only its own reads");
+	ASSERT_EQUALS_INT(3, getNumReadIO(bm2), "second pool counts only its own reads");
+
+	// FIFO replaced pages 0-2 in order, unaffected by the other pool's misses
+	contents = getFrameContents(bm1);
+	ASSERT_TRUE(contents[0] == 3 && contents[1] == 4 && contents[2] == 5, "first pool frames follow FIFO");
+	free(contents);
+
+	// a dirty page of one pool goes to that pool's file
+	TEST_CHECK(pinPage(bm2, h, 5));
+	strcpy(h->data, "Pool-2");
+	TEST_CHECK(markDirty(bm2, h));
+	TEST_CHECK(unpinPage(bm2, h));
+	TEST_CHECK(forcePage(bm2, h));
+	ASSERT_EQUALS_INT(0, getNumWriteIO(bm1), "first pool wrote nothing");
+	ASSERT_EQUALS_INT(1, getNumWriteIO(bm2), "second pool wrote its page");
+
+	TEST_CHECK(shutdownBufferPool(bm1));
+	TEST_CHECK(shutdownBufferPool(bm2));
+
+	TEST_CHECK(initBufferPool(bm1, TESTPF, 3, RS_FIFO, NULL));
+	TEST_CHECK(pinPage(bm1, h, 5));
+	checkDummyPage(h, 5);
+	TEST_CHECK(unpinPage(bm1, h));
+	TEST_CHECK(shutdownBufferPool(bm1));
+
+	TEST_CHECK(destroyPageFile(TESTPF));
+	TEST_CHECK(destroyPageFile(TESTPF2));
+
+	free(bm1);
+	free(bm2);
+	free(h);
+	TEST_DONE();
+}
+
+#define NUM_THREADS 4
+#define PINS_PER_THREAD 5000
+
+typedef struct PinWorker {
+	BM_BufferPool *bm;
+	int id;
+	int wrong;     // pins that returned the wrong page
+	int failed;    // calls that returned an error
+} PinWorker;
+
+/* pins random pages, sometimes two at a time, and rewrites the pages it owns */
+static void *
+pinWorker(void *arg)
+{
+	PinWorker *w = (PinWorker *) arg;
+	BM_PageHandle h1, h2;
+	unsigned int seed = w->id + 1;
+	int i, p1, p2;
+
+	for (i = 0; i < PINS_PER_THREAD; i++)
+	{
+		p1 = rand_r(&seed) % 200;
+		p2 = rand_r(&seed) % 200;
+		if (pinPage(w->bm, &h1, p1) != RC_OK || pinPage(w->bm, &h2, p2) != RC_OK)
+		{
+			w->failed++;
+			continue;
+		}
+		if (h1.pageNum != p1 || atoi(h1.data + 5) != p1 || h2.pageNum != p2 || atoi(h2.data + 5) != p2)
+			w->wrong++;
+
+		// pages are owned by thread pageNum % NUM_THREADS, so only the owner writes them
+		if (p1 % NUM_THREADS == w->id)
+		{
+			sprintf(h1.data, "%s-%i", "Page", p1);
+			if (markDirty(w->bm, &h1) != RC_OK)
+				w->failed++;
+		}
+		if (unpinPage(w->bm, &h2) != RC_OK || unpinPage(w->bm, &h1) != RC_OK)
+			w->failed++;
+	}
+	return NULL;
+}
+
+/* several threads pin, dirty and unpin pages of one small thread-safe pool */
+void
+testThreadSafePool(void)
+{
+	BM_BufferPool *bm = MAKE_POOL();
+	BM_PageHandle *h = MAKE_PAGE_HANDLE();
+	BM_PoolOptions options;
+	PinWorker workers[NUM_THREADS];
+	pthread_t threads[NUM_THREADS];
+	int i, wrong = 0, failed = 0, pinned = 0;
+	int *fixCounts;
+
+	testName = "Thread-safe buffer pool";
+
+	createDummyPages(TESTPF, 200);
+	initPoolOptions(&options);
+	options.threadSafe = true;
+	options.latchPartitions = 4;
+	TEST_CHECK(initBufferPoolWithOptions(bm, TESTPF, 32, RS_LRU, NULL, &options));
+
+	for (i = 0; i < NUM_THREADS; i++)
+	{
+		workers[i].bm = bm;
+		workers[i].id = i;
+		workers[i].wrong = workers[i].failed = 0;
+		ASSERT_TRUE(pthread_create(&threads[i], NULL, pinWorker, &workers[i]) == 0, "worker started");
+	}
+	for (i = 0; i < NUM_THREADS; i++)
+	{
+		pthread_join(threads[i], NULL);
+		wrong += workers[i].wrong;
+		failed += workers[i].failed;
+	}
+	ASSERT_EQUALS_INT(0, failed, "no call failed");
+	ASSERT_EQUALS_INT(0, wrong, "every pin returned its own page");
+
+	fixCounts = getFixCounts(bm);
+	for (i = 0; i < 32; i++)
+		pinned += fixCounts[i];
+	free(fixCounts);
+	ASSERT_EQUALS_INT(0, pinned, "every pin was released");
+
+	// all written pages reach the file intact
+	TEST_CHECK(shutdownBufferPool(bm));
+	TEST_CHECK(initBufferPool(bm, TESTPF, 10, RS_FIFO, NULL));
+	for (i = 0; i < 200; i++)
+	{
+		TEST_CHECK(pinPage(bm, h, i));
+		if (atoi(h->data + 5) != i)
+			wrong++;
+		TEST_CHECK(unpinPage(bm, h));
+	}
+	ASSERT_EQUALS_INT(0, wrong, "pages written by the threads are intact");
+	TEST_CHECK(shutdownBufferPool(bm));
+	TEST_CHECK(destroyPageFile(TESTPF));
+
+	free(bm);
+	free(h);
+	TEST_DONE();
+}
+
+/* pin and unpin a page, checking its content */
+static void
+touchPage(BM_BufferPool *bm, BM_PageHandle *h, int pageNum)
+{
+	TEST_CHECK(pinPage(bm, h, pageNum));
+	checkDummyPage(h, pageNum);
+	TEST_CHECK(unpinPage(bm, h));
+}
+
+/* LRU-K keeps pages referenced K times over pages of a one-off scan */
+void
+testLRUK(void)
+{
+	BM_BufferPool *bm = MAKE_POOL();
+	BM_PageHandle *h = MAKE_PAGE_HANDLE();
+	PageNumber *contents;
+	int i, k = 2, badK = 0, hot = 0;
+
+	testName = "LRU-K replacement";
+
+	createDummyPages(TESTPF, 20);
+	ASSERT_ERROR(initBufferPool(bm, TESTPF, 4, RS_LRU_K, &badK), "K must be positive");
+	TEST_CHECK(initBufferPool(bm, TESTPF, 4, RS_LRU_K, &k));
+
+	// pages 0 and 1 are referenced twice, then a scan reads pages 10-19 once each
+	touchPage(bm, h, 0);
+	touchPage(bm, h, 1);
+	touchPage(bm, h, 0);
+	touchPage(bm, h, 1);
+	for (i = 10; i < 20; i++)
+		touchPage(bm, h, i);
+
+	contents = getFrameContents(bm);
+	for (i = 0; i < 4; i++)
+		if (contents[i] == 0 || contents[i] == 1)
+			hot++;
+	free(contents);
+	ASSERT_EQUALS_INT(2, hot, "hot pages survived the scan");
+
+	// page 17 was referenced once before its eviction; read again it has two references and
+	// outlives pages referenced once
+	touchPage(bm, h, 17);
+	touchPage(bm, h, 5);
+	touchPage(bm, h, 6);
+	touchPage(bm, h, 7);
+	contents = getFrameContents(bm);
+	for (i = 0; i < 4; i++)
+		if (contents[i] == 0 || contents[i] == 1 || contents[i] == 17)
+			hot++;
+	free(contents);
+	ASSERT_EQUALS_INT(5, hot, "retained history kept the re-read page");
+
+	TEST_CHECK(shutdownBufferPool(bm));
+
+	// without stratData K defaults to 2
+	TEST_CHECK(initBufferPool(bm, TESTPF, 3, RS_LRU_K, NULL));
+	for (i = 0; i < 20; i++)
+		touchPage(bm, h, i % 5);
+	TEST_CHECK(shutdownBufferPool(bm));
+	TEST_CHECK(destroyPageFile(TESTPF));
+
+	free(bm);
+	free(h);
+	TEST_DONE();
+}
+
+/* hot pages read again and again between a few new pages, then one long scan of new pages;
+   returns how many hot pages are still resident after the scan */
+static int
+hotPagesAfterScan(ReplacementStrategy strategy)
+{
+	BM_BufferPool *bm = MAKE_POOL();
+	BM_PageHandle *h = MAKE_PAGE_HANDLE();
+	PageNumber *contents;
+	int round, i, hot = 0;
+
+	TEST_CHECK(initBufferPool(bm, TESTPF, 8, strategy, NULL));
+	for (round = 0; round < 3; round++)
+	{
+		for (i = 0; i < 4; i++)
+			touchPage(bm, h, i);
+		for (i = 0; i < 4; i++)
+			touchPage(bm, h, 10 + round * 4 + i);
+	}
+	for (i = 0; i < 16; i++)
+		touchPage(bm, h, 30 + i);
+
+	contents = getFrameContents(bm);
+	for (i = 0; i < 8; i++)
+		if (contents[i] >= 0 && contents[i] < 4)
+			hot++;
+	free(contents);
+	TEST_CHECK(shutdownBufferPool(bm));
+
+	free(bm);
+	free(h);
+	return hot;
+}
+
+/* ARC and 2Q keep reused pages through a scan that flushes them out of an LRU pool */
+void
+testScanResistance(void)
+{
+	testName = "ARC and 2Q scan resistance";
+
+	createDummyPages(TESTPF, 50);
+	ASSERT_EQUALS_INT(0, hotPagesAfterScan(RS_LRU), "the scan pushes the hot pages out of LRU");
+	ASSERT_EQUALS_INT(4, hotPagesAfterScan(RS_ARC), "ARC keeps the hot pages");
+	ASSERT_EQUALS_INT(4, hotPagesAfterScan(RS_2Q), "2Q keeps the hot pages");
+	TEST_CHECK(destroyPageFile(TESTPF));
+
+	TEST_DONE();
+}
+
+/* LRU and LFU pick their victim among the unpinned pages only */
+void
+testUnpinnedLists(void)
+{
+	BM_BufferPool *bm = MAKE_POOL();
+	BM_PageHandle *h = MAKE_PAGE_HANDLE();
+	BM_PageHandle *pinned = MAKE_PAGE_HANDLE();
+	int i;
+
+	testName = "LRU list and LFU buckets";
+
+	createDummyPages(TESTPF, 10);
+
+	// LRU: page 0 stays pinned, page 2 is the one unpinned longest ago
+	TEST_CHECK(initBufferPool(bm, TESTPF, 3, RS_LRU, NULL));
+	TEST_CHECK(pinPage(bm, pinned, 0));
+	touchPage(bm, h, 1);
+	touchPage(bm, h, 2);
+	touchPage(bm, h, 1);
+	touchPage(bm, h, 3);
+	ASSERT_EQUALS_POOL("[0 1],[1 0],[3 0]", bm, "LRU replaced the page unpinned longest ago");
+	touchPage(bm, h, 4);
+	ASSERT_EQUALS_POOL("[0 1],[4 0],[3 0]", bm, "LRU skipped the pinned page");
+	TEST_CHECK(unpinPage(bm, pinned));
+	TEST_CHECK(shutdownBufferPool(bm));
+
+	// LFU: page 1 is pinned three times, page 2 once
+	TEST_CHECK(initBufferPool(bm, TESTPF, 3, RS_LFU, NULL));
+	TEST_CHECK(pinPage(bm, pinned, 0));
+	for (i = 0; i < 3; i++)
+		touchPage(bm, h, 1);
+	touchPage(bm, h, 2);
+	touchPage(bm, h, 3);
+	ASSERT_EQUALS_POOL("[0 1],[1 0],[3 0]", bm, "LFU replaced the page pinned least");
+	touchPage(bm, h, 4);
+	ASSERT_EQUALS_POOL("[0 1],[1 0],[4 0]", bm, "LFU replaced the new page before the often used one");
+
+	// every page pinned
+	TEST_CHECK(pinPage(bm, h, 1));
+	TEST_CHECK(pinPage(bm, h, 4));
+	ASSERT_EQUALS_INT(RC_BUFFER_POOL_FULL, pinPage(bm, h, 5), "no frame is free when every page is pinned");
+	TEST_CHECK(unpinPage(bm, h));
+	touchPage(bm, h, 5);
+	ASSERT_EQUALS_POOL("[0 1],[1 1],[5 0]", bm, "the unpinned page was replaced");
+	TEST_CHECK(shutdownBufferPool(bm));
+	TEST_CHECK(destroyPageFile(TESTPF));
+
+	free(bm);
+	free(h);
+	free(pinned);
+	TEST_DONE();
+}
+
+/* every frame keeps its own slot of one arena, with and without huge pages */
+void
+testFrameArena(void)
+{
+	BM_BufferPool *bm = MAKE_POOL();
+	BM_PageHandle *h = MAKE_PAGE_HANDLE();
+	BM_PoolOptions options;
+	char *frameData[4];
+	int huge, i;
+
+	testName = "Frame arena";
+
+	createDummyPages(TESTPF, 20);
+	for (huge = 0; huge < 2; huge++)
+	{
+		initPoolOptions(&options);
+		options.hugePages = huge;
+		TEST_CHECK(initBufferPoolWithOptions(bm, TESTPF, 4, RS_FIFO, NULL, &options));
+
+		// the frames lie one after the other
+		for (i = 0; i < 4; i++)
+		{
+			TEST_CHECK(pinPage(bm, h, i));
+			frameData[i] = h->data;
+			TEST_CHECK(unpinPage(bm, h));
+		}
+		for (i = 1; i < 4; i++)
+			ASSERT_TRUE(frameData[i] == frameData[0] + i * getPoolPageSize(bm), "frame data is contiguous");
+
+		// a miss reads the page into the victim's frame, writing the dirty victim back first
+		TEST_CHECK(pinPage(bm, h, 0));
+		sprintf(h->data, "%s-%i", "Page", 100);
+		TEST_CHECK(markDirty(bm, h));
+		TEST_CHECK(unpinPage(bm, h));
+		TEST_CHECK(pinPage(bm, h, 4));
+		ASSERT_TRUE(h->data == frameData[0], "the new page took the victim's frame");
+		checkDummyPage(h, 4);
+		TEST_CHECK(unpinPage(bm, h));
+		ASSERT_EQUALS_INT(1, getNumWriteIO(bm), "the dirty victim was written back");
+		TEST_CHECK(shutdownBufferPool(bm));
+
+		// restoring page 0
+		TEST_CHECK(initBufferPool(bm, TESTPF, 1, RS_FIFO, NULL));
+		TEST_CHECK(pinPage(bm, h, 0));
+		ASSERT_TRUE(strcmp(h->data, "Page-100") == 0, "the victim reached the file");
+		sprintf(h->data, "%s-%i", "Page", 0);
+		TEST_CHECK(markDirty(bm, h));
+		TEST_CHECK(unpinPage(bm, h));
+		TEST_CHECK(shutdownBufferPool(bm));
+	}
+	TEST_CHECK(destroyPageFile(TESTPF));
+
+	free(bm);
+	free(h);
+	TEST_DONE();
+}
+
+/* a scan through a ring of two frames leaves the other pages of the pool alone */
+void
+testAccessStrategy(void)
+{
+	BM_BufferPool *bm = MAKE_POOL();
+	BM_BufferPool *other = MAKE_POOL();
+	BM_PageHandle *h = MAKE_PAGE_HANDLE();
+	BM_AccessStrategy ring;
+	PageNumber *contents;
+	int i, hot = 0;
+
+	testName = "Ring access strategy";
+
+	createDummyPages(TESTPF, 60);
+	TEST_CHECK(initBufferPool(bm, TESTPF, 8, RS_LRU, NULL));
+	ASSERT_ERROR(initAccessStrategy(&ring, bm, 0), "a ring needs a frame");
+	TEST_CHECK(initAccessStrategy(&ring, bm, 2));
+
+	for (i = 0; i < 6; i++)
+		touchPage(bm, h, i);
+	for (i = 10; i < 60; i++)
+	{
+		TEST_CHECK(pinPageWithStrategy(bm, h, i, &ring));
+		checkDummyPage(h, i);
+		TEST_CHECK(unpinPage(bm, h));
+	}
+
+	contents = getFrameContents(bm);
+	for (i = 0; i < 8; i++)
+		if (contents[i] >= 0 && contents[i] < 6)
+			hot++;
+	free(contents);
+	ASSERT_EQUALS_INT(6, hot, "the scan kept to its ring");
+	ASSERT_EQUALS_INT(56, getNumReadIO(bm), "every page was read once");
+
+	// hits through the strategy do not touch the ring
+	TEST_CHECK(pinPageWithStrategy(bm, h, 3, &ring));
+	checkDummyPage(h, 3);
+	TEST_CHECK(unpinPage(bm, h));
+
+	// pinned ring pages are left to their client, the pool's strategy picks another frame
+	TEST_CHECK(pinPage(bm, h, 58));
+	TEST_CHECK(pinPageWithStrategy(bm, h, 20, &ring));
+	checkDummyPage(h, 20);
+	TEST_CHECK(unpinPage(bm, h));
+	h->pageNum = 58;
+	TEST_CHECK(unpinPage(bm, h));
+
+	// a ring only serves the pool it was made for
+	TEST_CHECK(initBufferPool(other, TESTPF, 2, RS_LRU, NULL));
+	ASSERT_ERROR(pinPageWithStrategy(other, h, 0, &ring), "the strategy belongs to another pool");
+	TEST_CHECK(shutdownBufferPool(other));
+
+	TEST_CHECK(freeAccessStrategy(&ring));
+	TEST_CHECK(shutdownBufferPool(bm));
+	TEST_CHECK(destroyPageFile(TESTPF));
+
+	free(bm);
+	free(other);
+	free(h);
+	TEST_DONE();
+}
+
+/* prefetched pages are read once, without being pinned, and later pins find them in the pool */
+void
+testPrefetch(void)
+{
+	BM_BufferPool *bm = MAKE_POOL();
+	BM_PageHandle *h = MAKE_PAGE_HANDLE();
+	BM_PageHandle pinned[4];
+	PageNumber first[] = { 0, 1, 2, 3 };
+	PageNumber next[] = { 3, 10, 11 };
+	PageNumber blocked[] = { 15 };
+	PageNumber last[] = { 16, 17 };
+	PageNumber bad[] = { -1 };
+	int i;
+
+	testName = "Prefetching pages";
+
+	createDummyPages(TESTPF, 20);
+	TEST_CHECK(initBufferPool(bm, TESTPF, 4, RS_LRU, NULL));
+
+	TEST_CHECK(prefetchPages(bm, first, 4));
+	for (i = 0; i < 4; i++)
+		touchPage(bm, h, i);
+	ASSERT_EQUALS_POOL("[0 0],[1 0],[2 0],[3 0]", bm, "prefetched pages are not left pinned");
+	ASSERT_EQUALS_INT(4, getNumReadIO(bm), "pins of prefetched pages read nothing more");
+
+	// resident pages are skipped, the others replace the least recently used ones
+	TEST_CHECK(prefetchPages(bm, next, 3));
+	touchPage(bm, h, 10);
+	touchPage(bm, h, 11);
+	ASSERT_EQUALS_POOL("[10 0],[11 0],[2 0],[3 0]", bm, "prefetch replaces like a miss");
+	ASSERT_EQUALS_INT(6, getNumReadIO(bm), "only the missing pages were read");
+
+	// with every page pinned there is no frame to read into
+	for (i = 0; i < 4; i++)
+		TEST_CHECK(pinPage(bm, &pinned[i], i < 2 ? 10 + i : i));
+	TEST_CHECK(prefetchPages(bm, blocked, 1));
+	ASSERT_EQUALS_INT(6, getNumReadIO(bm), "nothing is prefetched into pinned frames");
+	for (i = 0; i < 4; i++)
+		TEST_CHECK(unpinPage(bm, &pinned[i]));
+
+	ASSERT_ERROR(prefetchPages(bm, bad, 1), "negative page number");
+
+	// forcing a page waits for its read, and writes nothing while the page is clean
+	TEST_CHECK(prefetchPages(bm, last, 2));
+	h->pageNum = 16;
+	TEST_CHECK(forcePage(bm, h));
+	ASSERT_EQUALS_INT(0, getNumWriteIO(bm), "a clean page is not written");
+	TEST_CHECK(pinPage(bm, h, 16));
+	checkDummyPage(h, 16);
+	TEST_CHECK(unpinPage(bm, h));
+
+	// shutting down waits for reads still in flight
+	TEST_CHECK(prefetchPages(bm, last, 2));
+	TEST_CHECK(shutdownBufferPool(bm));
+	TEST_CHECK(destroyPageFile(TESTPF));
+
+	free(bm);
+	free(h);
+	TEST_DONE();
+}
+
+/* flushing writes every unpinned dirty page, whatever frames they sit in, and leaves pinned ones dirty */
+void
+testSortedFlush(void)
+{
+	BM_BufferPool *bm = MAKE_POOL();
+	BM_PageHandle *h = MAKE_PAGE_HANDLE();
+	SM_FileHandle fh;
+	SM_PageHandle ph = (SM_PageHandle) calloc(PAGE_SIZE, 1);
+	PageNumber pages[] = { 7, 3, 5, 4, 0, 6, 9 };
+	char expected[32];
+	int i;
+
+	testName = "Sorted flush of dirty pages";
+
+	createDummyPages(TESTPF, 10);
+	TEST_CHECK(initBufferPool(bm, TESTPF, 8, RS_FIFO, NULL));
+
+	// pages in frames out of file order, runs 3-7 and 0 apart; page 9 stays pinned
+	for (i = 0; i < 7; i++)
+	{
+		TEST_CHECK(pinPage(bm, h, pages[i]));
+		sprintf(h->data, "%s-%i", "Flushed", pages[i]);
+		TEST_CHECK(markDirty(bm, h));
+		if (pages[i] != 9)
+			TEST_CHECK(unpinPage(bm, h));
+	}
+	TEST_CHECK(forceFlushPool(bm));
+	ASSERT_EQUALS_POOL("[7 0],[3 0],[5 0],[4 0],[0 0],[6 0],[9x1],[-1 0]", bm, "unpinned pages are clean");
+	ASSERT_EQUALS_INT(6, getNumWriteIO(bm), "one write counted per page");
+
+	// every page reached its own place in the file
+	TEST_CHECK(openPageFile(TESTPF, &fh));
+	for (i = 0; i < 10; i++)
+	{
+		TEST_CHECK(readBlock(i, &fh, ph));
+		sprintf(expected, "%s-%i", i == 9 || i == 1 || i == 2 || i == 8 ? "Page" : "Flushed", i);
+		ASSERT_EQUALS_STRING(expected, ph, "page on disk after the flush");
+	}
+	TEST_CHECK(closePageFile(&fh));
+
+	h->pageNum = 9;
+	TEST_CHECK(unpinPage(bm, h));
+	TEST_CHECK(shutdownBufferPool(bm));
+	TEST_CHECK(destroyPageFile(TESTPF));
+
+	free(ph);
+	free(bm);
+	free(h);
+	TEST_DONE();
+}
+
+/* number of dirty frames of a pool */
+static int
+countDirty(BM_BufferPool *bm)
+{
+	bool *dirty = getDirtyFlags(bm);
+	int i, n = 0;
+
+	for (i = 0; i < bm->numPages; i++)
+		n += dirty[i];
+	free(dirty);
+	return n;
+}
+
+/* once dirty frames reach the high watermark the writer cleans unpinned ones down to the low one */
+void
+testBackgroundWriter(void)
+{
+	BM_BufferPool *bm = MAKE_POOL();
+	BM_PageHandle *h = MAKE_PAGE_HANDLE();
+	BM_PageHandle pinned;
+	BM_PoolOptions options;
+	SM_FileHandle fh;
+	SM_PageHandle ph = (SM_PageHandle) calloc(PAGE_SIZE, 1);
+	char *expectedPool = "[0x1],[1 0],[2 0],[3 0],[-1 0],[-1 0],[-1 0],[-1 0],[-1 0],[-1 0]";
+	int i, waited;
+
+	testName = "Background writer";
+
+	createDummyPages(TESTPF, 20);
+	initPoolOptions(&options);
+	options.backgroundWriter = true;
+	options.writerHighWatermark = 10;
+	options.writerLowWatermark = 10;
+	ASSERT_ERROR(initBufferPoolWithOptions(bm, TESTPF, 10, RS_LRU, NULL, &options), "the low watermark is below the high one");
+	options.writerHighWatermark = 40;
+	options.writerLowWatermark = 10;
+	TEST_CHECK(initBufferPoolWithOptions(bm, TESTPF, 10, RS_LRU, NULL, &options));
+
+	// page 0 stays pinned and dirty, pages 1 to 3 are dirtied and unpinned: 40% dirty
+	TEST_CHECK(pinPage(bm, &pinned, 0));
+	sprintf(pinned.data, "%s-%i", "Written", 0);
+	TEST_CHECK(markDirty(bm, &pinned));
+	for (i = 1; i < 4; i++)
+	{
+		TEST_CHECK(pinPage(bm, h, i));
+		sprintf(h->data, "%s-%i", "Written", i);
+		TEST_CHECK(markDirty(bm, h));
+		TEST_CHECK(unpinPage(bm, h));
+	}
+
+	// waiting for the writer to write the pages and give up its fixes
+	for (waited = 0; waited < 2000; waited += 10)
+	{
+		char *content = sprintPoolContent(bm);
+		bool done = strcmp(content, expectedPool) == 0;
+		free(content);
+		if (done)
+			break;
+		usleep(10000);
+	}
+	ASSERT_EQUALS_INT(1, countDirty(bm), "the writer cleaned down to the low watermark");
+	ASSERT_EQUALS_INT(3, getNumWriteIO(bm), "the unpinned pages were written");
+	ASSERT_EQUALS_POOL(expectedPool, bm, "the pinned page is left dirty");
+
+	TEST_CHECK(openPageFile(TESTPF, &fh));
+	for (i = 1; i < 4; i++)
+	{
+		char expected[32];
+		sprintf(expected, "%s-%i", "Written", i);
+		TEST_CHECK(readBlock(i, &fh, ph));
+		ASSERT_EQUALS_STRING(expected, ph, "page written by the background writer");
+	}
+	TEST_CHECK(closePageFile(&fh));
+
+	// a page changed again after its write is written again
+	TEST_CHECK(pinPage(bm, h, 1));
+	TEST_CHECK(markDirty(bm, h));
+	TEST_CHECK(unpinPage(bm, h));
+	TEST_CHECK(unpinPage(bm, &pinned));
+	TEST_CHECK(shutdownBufferPool(bm));
+	TEST_CHECK(destroyPageFile(TESTPF));
+
+	free(ph);
+	free(bm);
+	free(h);
+	TEST_DONE();
+}
+
+/* a warm start pool reads the hottest pages of its last run back, in page order, most recent last */
+void
+testWarmStart(void)
+{
+	BM_BufferPool *bm = MAKE_POOL();
+	BM_PageHandle *h = MAKE_PAGE_HANDLE();
+	BM_PoolOptions options;
+	char manifest[64];
+
+	testName = "Warm start";
+
+	createDummyPages(TESTPF, 20);
+	sprintf(manifest, "%s%s", TESTPF, BM_WARM_START_SUFFIX);
+	initPoolOptions(&options);
+	options.warmStart = true;
+
+	// the pages by recency: 2 7 9 5
+	TEST_CHECK(initBufferPoolWithOptions(bm, TESTPF, 4, RS_LRU, NULL, &options));
+	touchPage(bm, h, 5);
+	touchPage(bm, h, 2);
+	touchPage(bm, h, 9);
+	touchPage(bm, h, 7);
+	touchPage(bm, h, 2);
+	TEST_CHECK(shutdownBufferPool(bm));
+
+	// a smaller pool takes the three hottest
+	TEST_CHECK(initBufferPoolWithOptions(bm, TESTPF, 3, RS_LRU, NULL, &options));
+	ASSERT_EQUALS_POOL("[2 0],[7 0],[9 0]", bm, "hottest pages read back in page order");
+	ASSERT_EQUALS_INT(3, getNumReadIO(bm), "one read per page");
+	touchPage(bm, h, 7);
+	ASSERT_EQUALS_INT(3, getNumReadIO(bm), "warm pages are hits");
+
+	// 9 was the coldest of the three, then 2 as 7 was just pinned
+	touchPage(bm, h, 1);
+	touchPage(bm, h, 3);
+	ASSERT_EQUALS_POOL("[3 0],[7 0],[1 0]", bm, "recency survives the restart");
+	TEST_CHECK(shutdownBufferPool(bm));
+
+	// without the option the pool starts cold
+	TEST_CHECK(initBufferPool(bm, TESTPF, 3, RS_LRU, NULL));
+	ASSERT_EQUALS_POOL("[-1 0],[-1 0],[-1 0]", bm, "cold start");
+	TEST_CHECK(shutdownBufferPool(bm));
+
+	// without a manifest the pool starts cold as well
+	ASSERT_TRUE(remove(manifest) == 0, "manifest written at shutdown");
+	TEST_CHECK(initBufferPoolWithOptions(bm, TESTPF, 3, RS_LRU, NULL, &options));
+	ASSERT_EQUALS_POOL("[-1 0],[-1 0],[-1 0]", bm, "no manifest, cold start");
+	TEST_CHECK(shutdownBufferPool(bm));
+
+	remove(manifest);
+	TEST_CHECK(destroyPageFile(TESTPF));
+
+	free(bm);
+	free(h);
+	TEST_DONE();
+}
+
+/* shrinking keeps pinned and hot pages and writes back dirty ones that leave, growing keeps all */
+void
+testResize(void)
+{
+	BM_BufferPool *bm = MAKE_POOL();
+	BM_PageHandle *h = MAKE_PAGE_HANDLE();
+	BM_PageHandle *pinned = MAKE_PAGE_HANDLE();
+	ReplacementStrategy strategies[] = { RS_FIFO, RS_LRU, RS_CLOCK, RS_LFU, RS_LRU_K, RS_ARC, RS_2Q };
+	int readIO, i, s;
+
+	testName = "Resizing a buffer pool";
+
+	createDummyPages(TESTPF, 20);
+
+	// by recency: 3 2 1, with 0 pinned and 2 dirty
+	TEST_CHECK(initBufferPool(bm, TESTPF, 4, RS_LRU, NULL));
+	for (i = 0; i < 4; i++)
+		touchPage(bm, h, i);
+	TEST_CHECK(pinPage(bm, h, 2));
+	TEST_CHECK(markDirty(bm, h));
+	TEST_CHECK(unpinPage(bm, h));
+	touchPage(bm, h, 3);
+	TEST_CHECK(pinPage(bm, pinned, 0));
+
+	TEST_CHECK(resizeBufferPool(bm, 2));
+	ASSERT_EQUALS_POOL("[0 1],[3 0]", bm, "pinned and most recent pages kept");
+	ASSERT_EQUALS_INT(2, bm->numPages, "pool has two frames");
+	ASSERT_EQUALS_INT(1, getNumWriteIO(bm), "evicted dirty page written");
+	checkDummyPage(pinned, 0);
+	ASSERT_ERROR(resizeBufferPool(bm, 0), "a pool needs a frame");
+
+	// no room for two pinned pages in one frame
+	TEST_CHECK(pinPage(bm, h, 5));
+	ASSERT_EQUALS_INT(RC_BUFFER_POOL_FULL, resizeBufferPool(bm, 1), "shrinking below the pinned pages");
+	ASSERT_EQUALS_POOL("[0 1],[5 1]", bm, "failed resize leaves the pool");
+	TEST_CHECK(unpinPage(bm, h));
+
+	// growing adds free frames, then replacement goes on by recency
+	readIO = getNumReadIO(bm);
+	TEST_CHECK(resizeBufferPool(bm, 4));
+	ASSERT_EQUALS_POOL("[0 1],[5 0],[-1 0],[-1 0]", bm, "resident pages stay in their frames");
+	touchPage(bm, h, 6);
+	touchPage(bm, h, 7);
+	touchPage(bm, h, 8);
+	ASSERT_EQUALS_POOL("[0 1],[8 0],[6 0],[7 0]", bm, "free frames filled before the oldest page is replaced");
+	ASSERT_EQUALS_INT(readIO + 3, getNumReadIO(bm), "resize reads nothing");
+	checkDummyPage(pinned, 0);
+	TEST_CHECK(unpinPage(bm, pinned));
+	TEST_CHECK(shutdownBufferPool(bm));
+
+	// every strategy keeps working across a shrink and a growth
+	for (s = 0; s < 7; s++)
+	{
+		TEST_CHECK(initBufferPool(bm, TESTPF, 6, strategies[s], NULL));
+		for (i = 0; i < 6; i++)
+			touchPage(bm, h, i % 2 == 0 ? i : 0);
+		TEST_CHECK(resizeBufferPool(bm, 3));
+		for (i = 0; i < 20; i++)
+			touchPage(bm, h, (i * 7) % 20);
+		TEST_CHECK(resizeBufferPool(bm, 8));
+		for (i = 0; i < 20; i++)
+		{
+			TEST_CHECK(pinPage(bm, h, i));
+			checkDummyPage(h, i);
+			TEST_CHECK(unpinPage(bm, h));
+		}
+		TEST_CHECK(shutdownBufferPool(bm));
+	}
+
+	TEST_CHECK(destroyPageFile(TESTPF));
+
+	free(bm);
+	free(h);
+	free(pinned);
+	TEST_DONE();
+}
+
+/* the files of a shared pool keep their pages apart and compete for its frames */
+void
+testSharedPool(void)
+{
+	BM_BufferPool *shared = MAKE_POOL();
+	BM_BufferPool *a = MAKE_POOL();
+	BM_BufferPool *b = MAKE_POOL();
+	BM_PageHandle *h = MAKE_PAGE_HANDLE();
+
+	testName = "Shared buffer pool";
+
+	createDummyPages(TESTPF, 10);
+	createDummyPages(TESTPF2, 10);
+	TEST_CHECK(initSharedBufferPool(shared, 4, PAGE_SIZE, RS_LRU, NULL, NULL));
+	TEST_CHECK(attachBufferPool(a, shared, TESTPF));
+	TEST_CHECK(attachBufferPool(b, shared, TESTPF2));
+	ASSERT_EQUALS_INT(RC_FILE_HANDLE_NOT_INIT, pinPage(shared, h, 0), "pages are pinned through the files");
+
+	// page 0 of each file, one of them changed
+	touchPage(a, h, 0);
+	TEST_CHECK(pinPage(b, h, 0));
+	strcpy(h->data, "B-0");
+	TEST_CHECK(markDirty(b, h));
+	TEST_CHECK(unpinPage(b, h));
+	TEST_CHECK(pinPage(a, h, 0));
+	checkDummyPage(h, 0);
+	TEST_CHECK(unpinPage(a, h));
+	ASSERT_EQUALS_POOL("[0 0],[-1 0],[-1 0],[-1 0]", a, "a file sees its own page");
+	ASSERT_EQUALS_POOL("[-1 0],[0x0],[-1 0],[-1 0]", b, "the other file sees its own page");
+
+	// a busy file takes the frames of the other one
+	touchPage(b, h, 1);
+	touchPage(b, h, 2);
+	touchPage(b, h, 3);
+	ASSERT_EQUALS_INT(1, getNumWriteIO(b), "evicted dirty page written to its file");
+	touchPage(b, h, 4);
+	ASSERT_EQUALS_POOL("[-1 0],[-1 0],[-1 0],[-1 0]", a, "idle file evicted");
+	ASSERT_EQUALS_POOL("[4 0],[3 0],[1 0],[2 0]", b, "busy file holds every frame");
+	TEST_CHECK(pinPage(b, h, 0));
+	ASSERT_TRUE(strcmp(h->data, "B-0") == 0, "changed page read back from its file");
+	TEST_CHECK(unpinPage(b, h));
+
+	// detaching writes back the file's pages and frees their frames
+	touchPage(a, h, 5);
+	TEST_CHECK(pinPage(a, h, 6));
+	strcpy(h->data, "A-6");
+	TEST_CHECK(markDirty(a, h));
+	TEST_CHECK(unpinPage(a, h));
+	ASSERT_EQUALS_POOL("[4 0],[6x0],[0 0],[5 0]", shared, "the pool sees every file");
+	TEST_CHECK(shutdownBufferPool(a));
+	ASSERT_EQUALS_INT(2, getNumWriteIO(shared), "detached file flushed");
+	ASSERT_EQUALS_POOL("[4 0],[0 0],[-1 0],[-1 0]", shared, "detached file's pages dropped");
+	touchPage(b, h, 7);
+	ASSERT_EQUALS_POOL("[4 0],[0 0],[7 0],[-1 0]", b, "freed frames are used again");
+
+	// attached again, the file finds its changes
+	TEST_CHECK(attachBufferPool(a, shared, TESTPF));
+	TEST_CHECK(pinPage(a, h, 6));
+	ASSERT_TRUE(strcmp(h->data, "A-6") == 0, "changed page written at detach");
+	TEST_CHECK(unpinPage(a, h));
+	TEST_CHECK(pinPage(a, h, 0));
+	checkDummyPage(h, 0);
+	TEST_CHECK(unpinPage(a, h));
+	ASSERT_EQUALS_POOL("[0 0],[-1 0],[-1 0],[6 0]", a, "file attached again");
+
+	// shutting the shared pool down closes the files still attached
+	TEST_CHECK(shutdownBufferPool(shared));
+	TEST_CHECK(destroyPageFile(TESTPF));
+	TEST_CHECK(destroyPageFile(TESTPF2));
+
+	free(shared);
+	free(a);
+	free(b);
+	free(h);
+	TEST_DONE();
+}
+
+/* the pool counts hits, misses, evictions and write-backs by cause, and a reset starts them again */
+void
+testPoolStats(void)
+{
+	BM_BufferPool *bm = MAKE_POOL();
+	BM_PageHandle *h = MAKE_PAGE_HANDLE();
+	BM_PageHandle pinned[3];
+	BM_AccessStrategy ring;
+	BM_PoolStats stats;
+	char *json;
+	long pins;
+	RC rc;
+	int i;
+
+	testName = "Buffer pool statistics";
+
+	createDummyPages(TESTPF, 10);
+	TEST_CHECK(initBufferPool(bm, TESTPF, 3, RS_LRU, NULL));
+	TEST_CHECK(getPoolStats(bm, &stats));
+	ASSERT_EQUALS_INT(0, (int) (stats.hits + stats.misses), "a new pool has no pins");
+	ASSERT_EQUALS_INT(0, getNumReadIO(bm), "a new pool has read nothing");
+
+	// three misses and two hits, one of them dirtying page 1
+	touchPage(bm, h, 0);
+	touchPage(bm, h, 1);
+	touchPage(bm, h, 2);
+	touchPage(bm, h, 0);
+	TEST_CHECK(pinPage(bm, h, 1));
+	TEST_CHECK(markDirty(bm, h));
+	TEST_CHECK(unpinPage(bm, h));
+
+	// 2, 0 and the dirty 1 are evicted in turn
+	touchPage(bm, h, 3);
+	touchPage(bm, h, 4);
+	touchPage(bm, h, 5);
+
+	// a forced page and a flush
+	TEST_CHECK(pinPage(bm, h, 3));
+	TEST_CHECK(markDirty(bm, h));
+	TEST_CHECK(forcePage(bm, h));
+	TEST_CHECK(unpinPage(bm, h));
+	TEST_CHECK(pinPage(bm, h, 4));
+	TEST_CHECK(markDirty(bm, h));
+	TEST_CHECK(unpinPage(bm, h));
+	TEST_CHECK(forceFlushPool(bm));
+
+	// no frame for a fourth page while three are pinned
+	for (i = 0; i < 3; i++)
+		TEST_CHECK(pinPage(bm, &pinned[i], 3 + i));
+	rc = pinPage(bm, h, 6);
+	ASSERT_EQUALS_INT(RC_BUFFER_POOL_FULL, rc, "every frame pinned");
+	for (i = 0; i < 3; i++)
+		TEST_CHECK(unpinPage(bm, &pinned[i]));
+
+	TEST_CHECK(getPoolStats(bm, &stats));
+	ASSERT_EQUALS_INT(RS_LRU, stats.strategy, "strategy reported");
+	ASSERT_EQUALS_INT(3, stats.numPages, "frames reported");
+	ASSERT_EQUALS_INT(7, (int) stats.hits, "hits counted");
+	ASSERT_EQUALS_INT(6, (int) stats.misses, "misses counted");
+	ASSERT_EQUALS_INT(1, (int) stats.pinFailures, "failed pin counted");
+	ASSERT_EQUALS_INT(0, (int) stats.pinWaits, "a single client never waits");
+	ASSERT_EQUALS_INT(6, (int) stats.pagesRead, "reads counted");
+	ASSERT_EQUALS_INT(6, getNumReadIO(bm), "read count is the number of reads");
+	ASSERT_EQUALS_INT(3, (int) stats.evictions, "evictions counted");
+	ASSERT_EQUALS_INT(1, (int) stats.evictionWrites, "write-back of an evicted page");
+	ASSERT_EQUALS_INT(2, (int) stats.flushWrites, "write-backs of forced and flushed pages");
+	ASSERT_EQUALS_INT(0, (int) stats.writerWrites, "no background writer");
+	for (pins = 0, i = 0; i < BM_LATENCY_BUCKETS; i++)
+		pins += stats.pinLatency[i];
+	ASSERT_EQUALS_INT(14, (int) pins, "every pin in the latency histogram");
+
+	json = sprintPoolStats(bm);
+	ASSERT_TRUE(json[0] == '{' && json[strlen(json) - 1] == '}', "statistics dumped as a JSON object");
+	ASSERT_TRUE(strstr(json, "\"strategy\":\"LRU\",\"numPages\":3,\"hits\":7,\"misses\":6") != NULL, "pin counts in JSON");
+	ASSERT_TRUE(strstr(json, "\"writes\":{\"eviction\":1,\"flush\":2,\"writer\":0}") != NULL, "write-backs in JSON");
+	free(json);
+
+	// after a reset only new activity counts: two misses through a ring of two frames, then a third
+	// replacing the ring's oldest page
+	TEST_CHECK(resetPoolStats(bm));
+	TEST_CHECK(getPoolStats(bm, &stats));
+	ASSERT_EQUALS_INT(0, (int) (stats.hits + stats.misses + stats.evictions + stats.flushWrites), "reset counts");
+	TEST_CHECK(initAccessStrategy(&ring, bm, 2));
+	for (i = 7; i < 10; i++)
+	{
+		TEST_CHECK(pinPageWithStrategy(bm, h, i, &ring));
+		TEST_CHECK(unpinPage(bm, h));
+	}
+	TEST_CHECK(freeAccessStrategy(&ring));
+	TEST_CHECK(getPoolStats(bm, &stats));
+	ASSERT_EQUALS_INT(3, (int) stats.misses, "misses since the reset");
+	ASSERT_EQUALS_INT(3, (int) stats.evictions, "evictions since the reset");
+	ASSERT_EQUALS_INT(1, (int) stats.ringEvictions, "one through the ring");
+	ASSERT_EQUALS_INT(9, getNumReadIO(bm), "read count goes on across resets");
+	TEST_CHECK(shutdownBufferPool(bm));
+
+	TEST_CHECK(destroyPageFile(TESTPF));
+
+	free(bm);
+	free(h);
+	TEST_DONE();
+}
+
+/* a pin whose read fails returns the error and leaves no page behind, for every strategy */
+void
+testFailedRead(void)
+{
+	BM_BufferPool *bm = MAKE_POOL();
+	BM_PageHandle *h = MAKE_PAGE_HANDLE();
+	BM_PageHandle pinned[3];
+	ReplacementStrategy strategies[] = { RS_FIFO, RS_LRU, RS_CLOCK, RS_LFU, RS_LRU_K, RS_ARC, RS_2Q };
+	RC rc;
+	int s, i;
+
+	testName = "Failed page reads";
+
+	createDummyPages(TESTPF, 10);
+	for (s = 0; s < 7; s++)
+	{
+		TEST_CHECK(initBufferPool(bm, TESTPF, 3, strategies[s], NULL));
+
+		// into a free frame
+		rc = pinPage(bm, h, -1);
+		ASSERT_EQUALS_INT(RC_READ_NON_EXISTING_PAGE, rc, "read error of a free frame returned");
+		ASSERT_EQUALS_INT(0, getNumReadIO(bm), "failed read not counted");
+
+		// into a replaced frame, which is free afterwards
+		for (i = 0; i < 3; i++)
+			touchPage(bm, h, i);
+		rc = pinPage(bm, h, -1);
+		ASSERT_EQUALS_INT(RC_READ_NON_EXISTING_PAGE, rc, "read error of a replaced frame returned");
+		ASSERT_EQUALS_INT(3, getNumReadIO(bm), "failed read not counted");
+		rc = pinPage(bm, h, -1);
+		ASSERT_EQUALS_INT(RC_READ_NON_EXISTING_PAGE, rc, "failed page not in the pool");
+
+		// every frame still takes a page
+		for (i = 0; i < 3; i++)
+		{
+			TEST_CHECK(pinPage(bm, &pinned[i], 3 + i));
+			checkDummyPage(&pinned[i], 3 + i);
+		}
+		rc = pinPage(bm, h, 6);
+		ASSERT_EQUALS_INT(RC_BUFFER_POOL_FULL, rc, "every frame pinned");
+		for (i = 0; i < 3; i++)
+			TEST_CHECK(unpinPage(bm, &pinned[i]));
+		touchPage(bm, h, 6);
+		TEST_CHECK(shutdownBufferPool(bm));
+	}
+
+	TEST_CHECK(destroyPageFile(TESTPF));
+
+	free(bm);
+	free(h);
+	TEST_DONE();
+}
+
+/* a prefetch read that fails leaves its frame free and its error to the pin that waits for it */
+void
+testFailedPrefetch(void)
+{
+	BM_BufferPool *bm = MAKE_POOL();
+	BM_PageHandle *h = MAKE_PAGE_HANDLE();
+	BM_PageHandle pinned[3];
+	ReplacementStrategy strategies[] = { RS_FIFO, RS_LRU, RS_CLOCK, RS_LFU, RS_LRU_K, RS_ARC, RS_2Q };
+	PageNumber gone[] = { 5, 6, 7 };
+	RC rc;
+	int s, i;
+
+	testName = "Failed prefetch reads";
+
+	for (s = 0; s < 7; s++)
+	{
+		createDummyPages(TESTPF, 10);
+		TEST_CHECK(initBufferPool(bm, TESTPF, 3, strategies[s], NULL));
+
+		// the file loses every page after page 2 behind the pool's back; the header and bitmap
+		// pages, then pages 0-2 stay
+		ASSERT_TRUE(truncate(TESTPF, 5 * PAGE_SIZE) == 0, "page file truncated");
+		TEST_CHECK(prefetchPages(bm, gone, 3));
+		rc = pinPage(bm, h, 5);
+		ASSERT_TRUE(rc != RC_OK, "read error of a prefetched page returned");
+		rc = pinPage(bm, h, 6);
+		ASSERT_TRUE(rc != RC_OK, "failed page not in the pool");
+
+		// every frame still takes a page, and the failed reads are not counted
+		for (i = 0; i < 3; i++)
+		{
+			TEST_CHECK(pinPage(bm, &pinned[i], i));
+			checkDummyPage(&pinned[i], i);
+		}
+		rc = pinPage(bm, h, 8);
+		ASSERT_EQUALS_INT(RC_BUFFER_POOL_FULL, rc, "every frame pinned");
+		ASSERT_EQUALS_INT(3, getNumReadIO(bm), "failed reads not counted");
+		for (i = 0; i < 3; i++)
+			TEST_CHECK(unpinPage(bm, &pinned[i]));
+		TEST_CHECK(shutdownBufferPool(bm));
+		TEST_CHECK(destroyPageFile(TESTPF));
+	}
+
+	free(bm);
+	free(h);
+	TEST_DONE();
+}
@@ -55,6 +55,8 @@ static void testScans (void);
 static void testScansTwo (void);
 static void testInsertManyRecords(void);
 static void testMultipleScans(void);
+static void testTrailingString(void);
+static void testDeleteOpenTable(void);
 
 // struct for test records
 typedef struct TestRecord {
@@ -78,11 +80,13 @@ main (void)
 	testName = "";
     
 	testInsertManyRecords();
+	testScans();
+	testTrailingString();
+	testDeleteOpenTable();
 	/*
 	testRecords();
 	testCreateTableAndInsert();
 	testUpdateTable();
-	testScans();
 	testScansTwo();
 	testMultipleScans();
     */
@@ -383,7 +387,6 @@ testInsertManyRecords(void)
 	
 	TEST_CHECK(openTable(table, "test_table_t"));
 	
-  printf("llegamos 384");
 	// insert rows into table
 	for(i = 0; i < numInserts; i++)
 	{
@@ -391,13 +394,13 @@ testInsertManyRecords(void)
 		realInserts[i].a = i;
 		r = fromTestRecord(schema, realInserts[i]);
 		 
-		//TEST_CHECK(insertRecord(table,r));
+		TEST_CHECK(insertRecord(table,r));
 		rids[i] = r->id;
 	}
-	printf("llegamos");
 	TEST_CHECK(closeTable(table));
 	TEST_CHECK(openTable(table, "test_table_t"));
- /*
+	ASSERT_EQUALS_INT(numInserts, getNumTuples(table), "number of tuples after reopening");
+
 	// retrieve records from the table and compare to expected final stage
 	for(i = 0; i < numInserts; i++)
 	{
@@ -405,7 +408,7 @@ testInsertManyRecords(void)
 		TEST_CHECK(getRecord(table, rid, r));
 		ASSERT_EQUALS_RECORDS(fromTestRecord(schema, realInserts[i]), r, schema, "compare records");
 	}
-
+ /*
 	r = fromTestRecord(schema, updates[0]);
 	r->id = rids[randomRec];
 	TEST_CHECK(updateRecord(table,r));
@@ -625,6 +628,147 @@ void testScansTwo (void)
 }
 
 
+// every byte of a record survives, up to the end of a string that is the last attribute
+void
+testTrailingString(void)
+{
+	RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+	RM_ScanHandle *sc = (RM_ScanHandle *) malloc(sizeof(RM_ScanHandle));
+	char *names[] = { "a", "b" };
+	DataType dt[] = { DT_INT, DT_STRING };
+	int sizes[] = { 0, 8 };
+	char **cpNames = (char **) malloc(sizeof(char*) * 2);
+	DataType *cpDt = (DataType *) malloc(sizeof(DataType) * 2);
+	int *cpSizes = (int *) malloc(sizeof(int) * 2);
+	int *cpKeys = (int *) malloc(sizeof(int));
+	char expected[9];
+	int numInserts = 1000, i, rc;
+	Record *r, *found;
+	RID *rids;
+	Schema *schema;
+	Value *value;
+
+	testName = "test records whose last attribute is a string";
+	for(i = 0; i < 2; i++)
+	{
+		cpNames[i] = (char *) malloc(2);
+		strcpy(cpNames[i], names[i]);
+	}
+	memcpy(cpDt, dt, sizeof(DataType) * 2);
+	memcpy(cpSizes, sizes, sizeof(int) * 2);
+	cpKeys[0] = 0;
+	schema = createSchema(2, cpNames, cpDt, cpSizes, 1, cpKeys);
+	rids = (RID *) malloc(sizeof(RID) * numInserts);
+
+	TEST_CHECK(initRecordManager(NULL));
+	TEST_CHECK(createTable("test_table_s",schema));
+	TEST_CHECK(openTable(table, "test_table_s"));
+
+	// strings filling their whole 8 bytes
+	for(i = 0; i < numInserts; i++)
+	{
+		TEST_CHECK(createRecord(&r, schema));
+		MAKE_VALUE(value, DT_INT, i);
+		TEST_CHECK(setAttr(r, schema, 0, value));
+		freeVal(value);
+		sprintf(expected, "str%05d", i);
+		MAKE_STRING_VALUE(value, expected);
+		TEST_CHECK(setAttr(r, schema, 1, value));
+		freeVal(value);
+		TEST_CHECK(insertRecord(table, r));
+		rids[i] = r->id;
+		freeRecord(r);
+	}
+	TEST_CHECK(closeTable(table));
+	TEST_CHECK(openTable(table, "test_table_s"));
+
+	TEST_CHECK(createRecord(&found, schema));
+	for(i = 0; i < numInserts; i++)
+	{
+		TEST_CHECK(getRecord(table, rids[i], found));
+		TEST_CHECK(getAttr(found, schema, 1, &value));
+		sprintf(expected, "str%05d", i);
+		ASSERT_EQUALS_STRING(expected, value->v.stringV, "last attribute read back whole");
+		freeVal(value);
+	}
+
+	// a scan reads them whole as well
+	TEST_CHECK(startScan(table, sc, NULL));
+	for(i = 0; (rc = next(sc, found)) == RC_OK; i++)
+	{
+		TEST_CHECK(getAttr(found, schema, 0, &value));
+		sprintf(expected, "str%05d", value->v.intV);
+		freeVal(value);
+		TEST_CHECK(getAttr(found, schema, 1, &value));
+		ASSERT_EQUALS_STRING(expected, value->v.stringV, "last attribute scanned whole");
+		freeVal(value);
+	}
+	ASSERT_EQUALS_INT(RC_RM_NO_MORE_TUPLES, rc, "no more tuples after scan");
+	ASSERT_EQUALS_INT(numInserts, i, "every record scanned");
+	TEST_CHECK(closeScan(sc));
+
+	TEST_CHECK(closeTable(table));
+	TEST_CHECK(deleteTable("test_table_s"));
+	TEST_CHECK(shutdownRecordManager());
+	freeRecord(found);
+	freeSchema(schema);
+	free(rids);
+	free(sc);
+	free(table);
+	TEST_DONE();
+}
+
+// deleting an open table detaches it from the shared pool, so a new table of that name starts empty
+void
+testDeleteOpenTable(void)
+{
+	RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+	RM_ScanHandle *sc = (RM_ScanHandle *) malloc(sizeof(RM_ScanHandle));
+	TestRecord inserts[] = {
+			{1, "aaaa", 3},
+			{2, "bbbb", 2},
+			{3, "cccc", 1},
+	};
+	int numInserts = 3, i, rc;
+	Record *r;
+	Schema *schema;
+
+	testName = "test deleting an open table";
+	schema = testSchema();
+
+	TEST_CHECK(initRecordManager(NULL));
+	TEST_CHECK(createTable("test_table_d",schema));
+	TEST_CHECK(openTable(table, "test_table_d"));
+	for(i = 0; i < numInserts; i++)
+	{
+		r = fromTestRecord(schema, inserts[i]);
+		TEST_CHECK(insertRecord(table,r));
+		freeRecord(r);
+	}
+	TEST_CHECK(deleteTable("test_table_d"));
+	TEST_CHECK(closeTable(table));
+
+	// none of the deleted table's pages are left in the pool
+	TEST_CHECK(createTable("test_table_d",schema));
+	TEST_CHECK(openTable(table, "test_table_d"));
+	rc = getNumTuples(table);
+	ASSERT_EQUALS_INT(0, rc, "new table is empty");
+	TEST_CHECK(createRecord(&r, schema));
+	TEST_CHECK(startScan(table, sc, NULL));
+	rc = next(sc, r);
+	ASSERT_EQUALS_INT(RC_RM_NO_MORE_TUPLES, rc, "no tuples in the new table");
+	TEST_CHECK(closeScan(sc));
+	freeRecord(r);
+
+	TEST_CHECK(closeTable(table));
+	TEST_CHECK(deleteTable("test_table_d"));
+	TEST_CHECK(shutdownRecordManager());
+	freeSchema(schema);
+	free(sc);
+	free(table);
+	TEST_DONE();
+}
+
 Schema *
 testSchema (void)
 {